@@ -15,7 +15,14 @@ limitations under the License.
 
 #include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
 #include <ostream>
 #include <sstream>
 
@@ -24,14 +31,20 @@ limitations under the License.
 #include <io.h>
 #endif
 
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
+#include "azure/core/base64.hpp"
+#include "azure/core/io/body_stream.hpp"
 #include "azure/storage/blobs/blob_container_client.hpp"
 #include "azure/storage/blobs/block_blob_client.hpp"
 #include "tensorflow/c/logging.h"
 #include "tensorflow/c/tf_status.h"
 #include "tensorflow_io/core/filesystems/filesystem_plugins.h"
+#include "tensorflow_io/core/filesystems/ram_file_block_cache.h"
+#include "tensorflow_io/core/filesystems/thread_pool.h"
 
 namespace tensorflow {
 namespace io {
@@ -260,13 +273,145 @@ void ListResources(const std::string& dir, const std::string& delimiter,
   TF_SetStatus(status, TF_OK, "");
 }
 
+constexpr size_t kReadCacheBlockSize = 4 * 1024 * 1024;
+// Disabled unless TF_AZURE_READ_CACHE_MAX_SIZE_MB is set.
+constexpr size_t kReadCacheMaxSize = 0;
+constexpr uint64_t kReadAheadMax = 32 * 1024 * 1024;
+constexpr size_t kParallelReadChunkSize = 8 * 1024 * 1024;
+constexpr int kNumThreads = 8;
+
+// A blob whose blocks are in the read cache.
+typedef struct CachedBlob {
+  uint64_t size;
+  std::shared_ptr<const Azure::Storage::Blobs::BlobClient> blob_client;
+  // The number of open files of the blob.
+  int open_files = 0;
+} CachedBlob;
+
+typedef struct AzBlobFileSystem {
+  // Blocks of blobs read through random access files, shared by all of them.
+  // Declared first so that it outlives `thread_pool`, which runs the
+  // read-ahead fetches. Disabled unless TF_AZURE_READ_CACHE_MAX_SIZE_MB is
+  // set.
+  std::unique_ptr<RamFileBlockCache> read_cache;
+  // Runs the read-ahead fetches and the chunks of large reads.
+  std::unique_ptr<ThreadPool> thread_pool;
+  // Reads of at least twice this size are split into chunks downloaded
+  // concurrently.
+  size_t parallel_read_chunk_size;
+  uint64_t read_ahead_max;
+  absl::Mutex mu;
+  // Blobs in `read_cache` by path, recorded while they are open. The block
+  // fetcher needs their size, since `DownloadTo` fails past the end.
+  std::map<std::string, CachedBlob> cached_blobs ABSL_GUARDED_BY(mu);
+} AzBlobFileSystem;
+
+// Downloads `n` bytes of the blob at `offset`, which must be within the
+// blob. Ranges of at least twice `chunk_size` are split into chunks
+// downloaded concurrently on `thread_pool`, if not null.
+void DownloadRange(const Azure::Storage::Blobs::BlobClient& blob_client,
+                   uint64_t offset, size_t n, char* buffer,
+                   ThreadPool* thread_pool, size_t chunk_size,
+                   TF_Status* status) {
+  size_t count = 1;
+  if (thread_pool != nullptr && chunk_size > 0 && n >= 2 * chunk_size) {
+    count = n / chunk_size;
+  }
+  const size_t part_size = (n + count - 1) / count;
+
+  absl::Mutex mu;
+  std::string error_message;
+  auto download = [&](size_t i) {
+    size_t start = i * part_size;
+    if (start >= n) return;
+    Azure::Storage::Blobs::DownloadBlobToOptions download_options;
+    download_options.Range = Azure::Core::Http::HttpRange();
+    download_options.Range.Value().Offset = offset + start;
+    download_options.Range.Value().Length = (std::min)(part_size, n - start);
+    try {
+      blob_client.DownloadTo(reinterpret_cast<uint8_t*>(buffer + start),
+                             download_options.Range.Value().Length.Value(),
+                             download_options);
+    } catch (const Azure::Storage::StorageException& e) {
+      absl::MutexLock l(&mu);
+      if (error_message.empty()) error_message = StorageExceptionInfo(e);
+    } catch (const std::exception& e) {
+      // Nothing may escape a worker of `thread_pool`.
+      absl::MutexLock l(&mu);
+      if (error_message.empty()) {
+        error_message = absl::StrCat(" (", e.what(), ")");
+      }
+    }
+  };
+  if (count == 1) {
+    download(0);
+  } else {
+    thread_pool->ParallelFor(count, 0, download);
+  }
+  if (!error_message.empty()) {
+    TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
+    return;
+  }
+  TF_SetStatus(status, TF_OK, "");
+}
+
 class AzBlobRandomAccessFile {
  public:
-  AzBlobRandomAccessFile(const std::string& account,
+  // `filesystem` is not owned and may be null, in which case reads go
+  // straight to the blob and are not split.
+  AzBlobRandomAccessFile(const std::string& path, const std::string& account,
                          const std::string& container,
-                         const std::string& object)
-      : account_(account), container_(container), object_(object) {}
-  ~AzBlobRandomAccessFile() {}
+                         const std::string& object,
+                         AzBlobFileSystem* filesystem)
+      : path_(path),
+        account_(account),
+        container_(container),
+        object_(object),
+        filesystem_(filesystem),
+        blob_client_(std::make_shared<Azure::Storage::Blobs::BlobClient>(
+            CreateAzBlobClientWrapper(account, container)
+                ->GetBlobClient(object))),
+        read_cache_(nullptr),
+        file_size_(-1),
+        next_offset_(0),
+        read_ahead_(0) {}
+  ~AzBlobRandomAccessFile() {
+    if (read_cache_ == nullptr) return;
+    absl::MutexLock l(&filesystem_->mu);
+    auto it = filesystem_->cached_blobs.find(path_);
+    if (it != filesystem_->cached_blobs.end() &&
+        --it->second.open_files == 0) {
+      filesystem_->cached_blobs.erase(it);
+    }
+  }
+
+  // Fetches the properties of the blob, kept for the lifetime of the file,
+  // and reads it through the filesystem's cache if it has one. Errors are
+  // left to be reported on read.
+  void Open() {
+    TF_Status* status = TF_NewStatus();
+    Azure::ETag etag;
+    Azure::DateTime last_modified;
+    int64_t file_size = GetFileSize(&etag, &last_modified, status);
+    TF_DeleteStatus(status);
+    if (file_size < 0 || filesystem_ == nullptr ||
+        filesystem_->read_cache == nullptr) {
+      return;
+    }
+    int64_t signature = static_cast<int64_t>(std::hash<std::string>()(
+        absl::StrCat(etag.ToString(), "@", last_modified.ToString(), "@",
+                     file_size)));
+    {
+      absl::MutexLock l(&filesystem_->mu);
+      CachedBlob& blob = filesystem_->cached_blobs[path_];
+      blob.size = static_cast<uint64_t>(file_size);
+      blob.blob_client = blob_client_;
+      blob.open_files++;
+    }
+    filesystem_->read_cache->ValidateAndUpdateFileSignature(path_, signature);
+    read_cache_ = filesystem_->read_cache.get();
+  }
+
   int64_t Read(uint64_t offset, size_t n, char* buffer,
                TF_Status* status) const {
     TF_VLog(1, "ReadFileFromAz az://%s/%s/%s from %u for n: %u\n",
@@ -277,20 +422,8 @@ class AzBlobRandomAccessFile {
       TF_SetStatus(status, TF_OK, "");
       return 0;
     }
-    auto blob_container_client =
-        CreateAzBlobClientWrapper(account_, container_);
-    auto blob_client = blob_container_client->GetBlobClient(object_);
-    int64_t file_size;
-    try {
-      auto blob_property = blob_client.GetProperties();
-      file_size = blob_property.Value.BlobSize;
-    } catch (const Azure::Storage::StorageException& e) {
-      const std::string error_message =
-          absl::StrCat("Failed to get properties of az://", account_, "/",
-                       container_, "/", object_, StorageExceptionInfo(e));
-      TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
-      return 0;
-    }
+    int64_t file_size = GetFileSize(nullptr, nullptr, status);
+    if (TF_GetCode(status) != TF_OK) return 0;
 
     size_t bytes_to_read = n;
     if (offset >= file_size) {
@@ -300,20 +433,32 @@ class AzBlobRandomAccessFile {
     }
 
     if (bytes_to_read > 0) {
-      Azure::Storage::Blobs::DownloadBlobToOptions download_options;
-      download_options.Range = Azure::Core::Http::HttpRange();
-      download_options.Range.Value().Offset = offset;
-      download_options.Range.Value().Length = bytes_to_read;
-
-      try {
-        blob_client.DownloadTo(reinterpret_cast<uint8_t*>(buffer),
-                               bytes_to_read, download_options);
-      } catch (const Azure::Storage::StorageException& e) {
-        const std::string error_message =
-            absl::StrCat("Failed to get contents of az://", account_, "/",
-                         container_, "/", object_, StorageExceptionInfo(e));
-        TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
-        return 0;
+      if (read_cache_ != nullptr && bytes_to_read <= read_cache_->max_bytes()) {
+        // The blocks of a read spanning several of them are fetched
+        // concurrently.
+        if (bytes_to_read > read_cache_->block_size()) {
+          read_cache_->Prefetch(path_, offset, bytes_to_read);
+        }
+        int64_t read =
+            read_cache_->Read(path_, offset, bytes_to_read, buffer, status);
+        if (TF_GetCode(status) != TF_OK) return 0;
+        MaybeReadAhead(offset, read);
+        // Less is read if the blob shrank and another file of it was opened
+        // since.
+        bytes_to_read = read;
+      } else {
+        DownloadRange(
+            *blob_client_, offset, bytes_to_read, buffer,
+            filesystem_ != nullptr ? filesystem_->thread_pool.get() : nullptr,
+            filesystem_ != nullptr ? filesystem_->parallel_read_chunk_size : 0,
+            status);
+        if (TF_GetCode(status) != TF_OK) {
+          const std::string error_message =
+              absl::StrCat("Failed to get contents of az://", account_, "/",
+                           container_, "/", object_, TF_Message(status));
+          TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
+          return 0;
+        }
       }
     }
 
@@ -326,11 +471,71 @@ class AzBlobRandomAccessFile {
   }
 
  private:
+  // Returns the size of the blob, which is fetched once with its other
+  // properties.
+  int64_t GetFileSize(Azure::ETag* etag, Azure::DateTime* last_modified,
+                      TF_Status* status) const {
+    absl::MutexLock l(&mu_);
+    if (file_size_ < 0) {
+      try {
+        auto blob_property = blob_client_->GetProperties();
+        file_size_ = blob_property.Value.BlobSize;
+        if (etag != nullptr) *etag = blob_property.Value.ETag;
+        if (last_modified != nullptr) {
+          *last_modified = blob_property.Value.LastModified;
+        }
+      } catch (const Azure::Storage::StorageException& e) {
+        const std::string error_message =
+            absl::StrCat("Failed to get properties of az://", account_, "/",
+                         container_, "/", object_, StorageExceptionInfo(e));
+        TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
+        return -1;
+      }
+    }
+    TF_SetStatus(status, TF_OK, "");
+    return file_size_;
+  }
+
+  // Prefetches the blocks after a sequential read. The window doubles on
+  // every read which starts where the previous one ended, up to
+  // `read_ahead_max`, and collapses on a random access.
+  void MaybeReadAhead(uint64_t offset, size_t read) const {
+    size_t block_size = read_cache_->block_size();
+    uint64_t window, file_size;
+    {
+      absl::MutexLock l(&mu_);
+      if (offset == next_offset_) {
+        read_ahead_ = (std::min)((std::max)(read_ahead_ * 2,
+                                            static_cast<uint64_t>(block_size)),
+                                 filesystem_->read_ahead_max);
+      } else {
+        read_ahead_ = 0;
+      }
+      next_offset_ = offset + read;
+      window = read_ahead_;
+      file_size = file_size_;
+    }
+    uint64_t start = offset + read;
+    if (window == 0 || start >= file_size) return;
+    read_cache_->Prefetch(path_, start, (std::min)(window, file_size - start));
+  }
+
+  std::string path_;
   std::string account_;
   std::string container_;
   std::string object_;
+  AzBlobFileSystem* filesystem_;
+  std::shared_ptr<const Azure::Storage::Blobs::BlobClient> blob_client_;
+  RamFileBlockCache* read_cache_;
+  mutable absl::Mutex mu_;
+  mutable int64_t file_size_ ABSL_GUARDED_BY(mu_);
+  mutable uint64_t next_offset_ ABSL_GUARDED_BY(mu_);
+  mutable uint64_t read_ahead_ ABSL_GUARDED_BY(mu_);
 };
 
+constexpr size_t kStreamingUploadBlockSize = 8 * 1024 * 1024;
+constexpr size_t kStreamingUploadMaxPendingBlocks = 4;
+
 class AzBlobWritableFile {
  public:
   AzBlobWritableFile(const std::string& account, const std::string& container,
@@ -338,7 +543,31 @@ class AzBlobWritableFile {
       : account_(account),
         container_(container),
         object_(object),
-        sync_needed_(true) {
+        sync_needed_(true),
+        streaming_(false),
+        closed_(false) {
+    const char* streaming = std::getenv("TF_AZURE_STREAMING_UPLOAD");
+    if (streaming != nullptr && streaming[0] == '1') {
+      streaming_ = true;
+      block_size_ = kStreamingUploadBlockSize;
+      if (const char* size_mb =
+              std::getenv("TF_AZURE_STREAMING_UPLOAD_BLOCK_SIZE_MB")) {
+        size_t value = std::strtoull(size_mb, nullptr, 10);
+        if (value > 0) block_size_ = value * 1024 * 1024;
+      }
+      max_pending_blocks_ = kStreamingUploadMaxPendingBlocks;
+      if (const char* pending =
+              std::getenv("TF_AZURE_STREAMING_UPLOAD_MAX_PENDING_BLOCKS")) {
+        size_t value = std::strtoull(pending, nullptr, 10);
+        if (value > 0) max_pending_blocks_ = value;
+      }
+      block_client_ =
+          std::make_shared<Azure::Storage::Blobs::BlockBlobClient>(
+              CreateAzBlobClientWrapper(account_, container_)
+                  ->GetBlockBlobClient(object_));
+      block_.reserve(block_size_);
+      return;
+    }
     if (GetTmpFilename(&tmp_content_filename_)) {
       outfile_.open(tmp_content_filename_,
                     std::ofstream::binary | std::ofstream::app);
@@ -352,6 +581,7 @@ class AzBlobWritableFile {
   }
 
   void Append(const char* buffer, size_t n, TF_Status* status) {
+    if (streaming_) return StreamingAppend(buffer, n, status);
     if (!outfile_.is_open()) {
       TF_SetStatus(status, TF_FAILED_PRECONDITION,
                    "The internal temporary file is not writable");
@@ -368,7 +598,23 @@ class AzBlobWritableFile {
     }
     TF_SetStatus(status, TF_OK, "");
   }
+  // In streaming mode, the partial block is kept until it is full or the
+  // file is synced: a blob has at most 50,000 blocks, and writers may flush
+  // after every record.
+  void Flush(TF_Status* status) {
+    if (streaming_) {
+      if (!error_message_.empty()) {
+        TF_SetStatus(status, TF_INTERNAL, error_message_.c_str());
+        return;
+      }
+      TF_SetStatus(status, TF_OK, "");
+      return;
+    }
+    Sync(status);
+  }
+
   void Sync(TF_Status* status) {
+    if (streaming_) return StreamingSync(status);
     if (!outfile_.is_open()) {
       TF_SetStatus(status, TF_FAILED_PRECONDITION,
                    "The internal temporary file is not writable");
@@ -405,6 +651,7 @@ class AzBlobWritableFile {
   }
 
   void Close(TF_Status* status) {
+    if (streaming_) return StreamingClose(status);
     if (outfile_.is_open()) {
       Sync(status);
       if (TF_GetCode(status) != TF_OK) {
@@ -417,12 +664,153 @@ class AzBlobWritableFile {
   }
 
  private:
+  // In streaming mode, appended data is cut into blocks that are staged
+  // (`StageBlock`) concurrently as soon as they are full, with at most
+  // `max_pending_blocks_` in flight. Sync and close commit the list of
+  // staged blocks, which makes the data visible.
+  void StreamingAppend(const char* buffer, size_t n, TF_Status* status) {
+    if (closed_) {
+      TF_SetStatus(status, TF_FAILED_PRECONDITION,
+                   "Cannot append to a closed file");
+      return;
+    }
+    if (!error_message_.empty()) {
+      TF_SetStatus(status, TF_INTERNAL, error_message_.c_str());
+      return;
+    }
+    sync_needed_ = true;
+    while (n > 0) {
+      size_t append_n = (std::min)(n, block_size_ - block_.size());
+      block_.append(buffer, append_n);
+      buffer += append_n;
+      n -= append_n;
+      if (block_.size() == block_size_) {
+        StageBlock(status);
+        if (TF_GetCode(status) != TF_OK) return;
+      }
+    }
+    TF_SetStatus(status, TF_OK, "");
+  }
+
+  void StageBlock(TF_Status* status) {
+    WaitForBlocks(max_pending_blocks_ - 1, status);
+    if (TF_GetCode(status) != TF_OK) return;
+
+    // Block ids must be base64 and of the same length within a blob.
+    char id[16];
+    snprintf(id, sizeof(id), "%08zu", block_ids_.size());
+    std::string block_id = Azure::Core::Convert::Base64Encode(
+        std::vector<uint8_t>(id, id + strlen(id)));
+    block_ids_.push_back(block_id);
+
+    auto data = std::make_shared<std::string>();
+    data->swap(block_);
+    block_.reserve(block_size_);
+    auto block_client = block_client_;
+    pending_blocks_.push_back(
+        std::async(std::launch::async, [block_client, block_id, data]() {
+          Azure::Core::IO::MemoryBodyStream stream(
+              reinterpret_cast<const uint8_t*>(data->data()), data->size());
+          block_client->StageBlock(block_id, stream);
+        }));
+  }
+
+  // Waits until at most `max_pending` blocks are being staged.
+  void WaitForBlocks(size_t max_pending, TF_Status* status) {
+    while (pending_blocks_.size() > max_pending) {
+      auto pending = std::move(pending_blocks_.front());
+      pending_blocks_.pop_front();
+      std::string error_message;
+      try {
+        pending.get();
+      } catch (const Azure::Storage::StorageException& e) {
+        error_message = StorageExceptionInfo(e);
+      } catch (const std::exception& e) {
+        error_message = absl::StrCat(" (", e.what(), ")");
+      }
+      if (!error_message.empty() && error_message_.empty()) {
+        error_message_ =
+            absl::StrCat("Failed to upload to az://", account_, "/",
+                         container_, "/", object_, error_message);
+      }
+    }
+    if (!error_message_.empty()) {
+      TF_SetStatus(status, TF_INTERNAL, error_message_.c_str());
+      return;
+    }
+    TF_SetStatus(status, TF_OK, "");
+  }
+
+  void StreamingSync(TF_Status* status) {
+    if (closed_ || !sync_needed_) {
+      WaitForBlocks(0, status);
+      return;
+    }
+    if (!block_.empty()) {
+      StageBlock(status);
+      if (TF_GetCode(status) != TF_OK) return;
+    }
+    WaitForBlocks(0, status);
+    if (TF_GetCode(status) != TF_OK) return;
+
+    TF_VLog(1, "WriteFileToAz: az://%s/%s/%s with %u blocks\n",
+            account_.c_str(), container_.c_str(), object_.c_str(),
+            block_ids_.size());
+    try {
+      block_client_->CommitBlockList(block_ids_);
+    } catch (const Azure::Storage::StorageException& e) {
+      error_message_ =
+          absl::StrCat("Failed to upload to az://", account_, "/", container_,
+                       "/", object_, StorageExceptionInfo(e));
+      TF_SetStatus(status, TF_INTERNAL, error_message_.c_str());
+      return;
+    }
+    sync_needed_ = false;
+    TF_SetStatus(status, TF_OK, "");
+  }
+
+  void StreamingClose(TF_Status* status) {
+    if (closed_) {
+      TF_SetStatus(status, TF_OK, "");
+      return;
+    }
+    if (block_ids_.empty() && error_message_.empty()) {
+      // Small enough for a single request.
+      closed_ = true;
+      Azure::Core::IO::MemoryBodyStream stream(
+          reinterpret_cast<const uint8_t*>(block_.data()), block_.size());
+      try {
+        block_client_->Upload(stream);
+      } catch (const Azure::Storage::StorageException& e) {
+        const std::string error_message =
+            absl::StrCat("Failed to upload to az://", account_, "/",
+                         container_, "/", object_, StorageExceptionInfo(e));
+        TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
+        return;
+      }
+      TF_SetStatus(status, TF_OK, "");
+      return;
+    }
+    StreamingSync(status);
+    closed_ = true;
+  }
+
   std::string account_;
   std::string container_;
   std::string object_;
   std::string tmp_content_filename_;
   std::ofstream outfile_;
   bool sync_needed_;  // whether there is buffered data that needs to be synced
+  bool streaming_;
+  bool closed_;
+  size_t block_size_;
+  size_t max_pending_blocks_;
+  std::shared_ptr<Azure::Storage::Blobs::BlockBlobClient> block_client_;
+  std::string block_;  // data not staged yet
+  std::vector<std::string> block_ids_;
+  std::deque<std::future<void>> pending_blocks_;
+  // The first error of a block upload, after which the file fails.
+  std::string error_message_;
 };
 
 #if 0
@@ -500,7 +888,7 @@ static int64_t Tell(const TF_WritableFile* file, TF_Status* status) {
 
 static void Flush(const TF_WritableFile* file, TF_Status* status) {
   auto az_file = static_cast<AzBlobWritableFile*>(file->plugin_file);
-  az_file->Sync(status);
+  az_file->Flush(status);
 }
 
 static void Sync(const TF_WritableFile* file, TF_Status* status) {
@@ -531,10 +919,78 @@ uint64_t Length(const TF_ReadOnlyMemoryRegion* region) { return 0; }
 namespace tf_az_filesystem {
 
 static void Init(TF_Filesystem* filesystem, TF_Status* status) {
+  auto az_file = new AzBlobFileSystem();
+  uint64_t value;
+  int num_threads = kNumThreads;
+  if (absl::SimpleAtoi(getenv("TF_AZURE_NUM_THREADS"), &value) && value > 0) {
+    num_threads = static_cast<int>(value);
+  }
+  az_file->thread_pool = std::make_unique<ThreadPool>("az", num_threads);
+  az_file->parallel_read_chunk_size = kParallelReadChunkSize;
+  if (absl::SimpleAtoi(getenv("TF_AZURE_PARALLEL_READ_CHUNK_SIZE_MB"),
+                       &value)) {
+    az_file->parallel_read_chunk_size = value * 1024 * 1024;
+  }
+  az_file->read_ahead_max = kReadAheadMax;
+  if (absl::SimpleAtoi(getenv("TF_AZURE_READ_AHEAD_MAX_MB"), &value)) {
+    az_file->read_ahead_max = value * 1024 * 1024;
+  }
+
+  size_t block_size = kReadCacheBlockSize;
+  size_t max_bytes = kReadCacheMaxSize;
+  uint64_t max_staleness = 0;
+  if (absl::SimpleAtoi(getenv("TF_AZURE_READ_CACHE_BLOCK_SIZE_MB"), &value)) {
+    block_size = value * 1024 * 1024;
+  }
+  if (absl::SimpleAtoi(getenv("TF_AZURE_READ_CACHE_MAX_SIZE_MB"), &value)) {
+    max_bytes = value * 1024 * 1024;
+  }
+  if (absl::SimpleAtoi(getenv("TF_AZURE_READ_CACHE_MAX_STALENESS"), &value)) {
+    max_staleness = value;
+  }
+  if (block_size > 0 && max_bytes > 0) {
+    az_file->read_cache = std::make_unique<RamFileBlockCache>(
+        block_size, max_bytes, max_staleness,
+        [az_file](const std::string& filename, size_t offset, size_t n,
+                  char* buffer, TF_Status* status) -> int64_t {
+          CachedBlob blob;
+          {
+            absl::MutexLock l(&az_file->mu);
+            auto it = az_file->cached_blobs.find(filename);
+            if (it == az_file->cached_blobs.end()) {
+              TF_SetStatus(status, TF_INTERNAL,
+                           absl::StrCat("Not opened: ", filename).c_str());
+              return -1;
+            }
+            blob = it->second;
+          }
+          // A short read marks the end of the blob for the cache.
+          if (offset >= blob.size) {
+            TF_SetStatus(status, TF_OK, "");
+            return 0;
+          }
+          size_t length = (std::min)(static_cast<uint64_t>(n),
+                                     blob.size - offset);
+          DownloadRange(*blob.blob_client, offset, length, buffer, nullptr, 0,
+                        status);
+          if (TF_GetCode(status) != TF_OK) {
+            const std::string error_message = absl::StrCat(
+                "Failed to get contents of ", filename, TF_Message(status));
+            TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
+            return -1;
+          }
+          return length;
+        },
+        az_file->thread_pool.get());
+  }
+  filesystem->plugin_filesystem = az_file;
   TF_SetStatus(status, TF_OK, "");
 }
 
-static void Cleanup(TF_Filesystem* filesystem) {}
+static void Cleanup(TF_Filesystem* filesystem) {
+  auto az_file = static_cast<AzBlobFileSystem*>(filesystem->plugin_filesystem);
+  delete az_file;
+}
 
 static void NewRandomAccessFile(const TF_Filesystem* filesystem,
                                 const char* path, TF_RandomAccessFile* file,
@@ -544,7 +1000,11 @@ static void NewRandomAccessFile(const TF_Filesystem* filesystem,
   if (TF_GetCode(status) != TF_OK) {
     return;
   }
-  file->plugin_file = new AzBlobRandomAccessFile(account, container, object);
+  auto az_file = static_cast<AzBlobFileSystem*>(filesystem->plugin_filesystem);
+  auto az_random_access_file =
+      new AzBlobRandomAccessFile(path, account, container, object, az_file);
+  az_random_access_file->Open();
+  file->plugin_file = az_random_access_file;
 
   TF_SetStatus(status, TF_OK, "");
 }
@@ -795,8 +1255,8 @@ static void CopyFile(const TF_Filesystem* filesystem, const char* src,
   if (TF_GetCode(status) != TF_OK) {
     return;
   }
-  std::unique_ptr<AzBlobRandomAccessFile> src_file(
-      new AzBlobRandomAccessFile(src_account, src_container, src_object));
+  std::unique_ptr<AzBlobRandomAccessFile> src_file(new AzBlobRandomAccessFile(
+      src, src_account, src_container, src_object, nullptr));
 
   std::string dst_account, dst_container, dst_object;
   ParseAzBlobPath(dst, false, &dst_account, &dst_container, &dst_object,
@@ -0,0 +1,892 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// A caching layer over the other filesystems of this plugin. The wrapper of
+// scheme `s` is registered as "cache.s", e.g. "cache.s3://bucket/key" reads
+// "s3://bucket/key" through a RAM block cache shared by all of its files, an
+// optional local disk tier, sequential read-ahead and a stat cache.
+//
+// TensorFlow only parses URI schemes matching [a-zA-Z][0-9a-zA-Z.]*, hence
+// "cache." rather than "cache+" as the prefix.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/strip.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/c/logging.h"
+#include "tensorflow/c/tf_status.h"
+#include "tensorflow_io/core/filesystems/disk_block_cache.h"
+#include "tensorflow_io/core/filesystems/expiring_lru_cache.h"
+#include "tensorflow_io/core/filesystems/filesystem_plugins.h"
+#include "tensorflow_io/core/filesystems/ram_file_block_cache.h"
+#include "tensorflow_io/core/filesystems/thread_pool.h"
+
+namespace tensorflow {
+namespace io {
+namespace cache {
+namespace {
+
+constexpr char kSchemePrefix[] = "cache.";
+
+constexpr uint64_t kDefaultBlockSizeMB = 4;
+constexpr uint64_t kDefaultMaxCacheSizeMB = 256;
+constexpr uint64_t kDefaultMaxStaleness = 0;
+constexpr uint64_t kDefaultReadAheadMaxMB = 32;
+constexpr uint64_t kDefaultDiskCacheMaxSizeMB = 10240;
+constexpr uint64_t kDefaultStatCacheMaxAge = 5;
+constexpr uint64_t kDefaultStatCacheMaxEntries = 4096;
+constexpr uint64_t kDefaultNumThreads = 8;
+
+typedef struct WrappedScheme {
+  const char* scheme;
+  void (*provide_filesystem_support_for)(TF_FilesystemPluginOps* ops,
+                                         const char* uri);
+  // The instance registered for the scheme itself, for filesystems which
+  // cannot have a second one in the process. Null for the others.
+  TF_Filesystem* (*get_initialized_filesystem)();
+} WrappedScheme;
+
+// The filesystems which can be wrapped. Those of TensorFlow itself or of
+// other plugins are not reachable through the C API.
+const WrappedScheme kWrappedSchemes[] = {
+    {"az", az::ProvideFilesystemSupportFor, nullptr},
+    {"http", http::ProvideFilesystemSupportFor, nullptr},
+    {"https", http::ProvideFilesystemSupportFor, nullptr},
+    {"s3", s3::ProvideFilesystemSupportFor, nullptr},
+    {"hdfs", hdfs::ProvideFilesystemSupportFor, nullptr},
+    {"viewfs", hdfs::ProvideFilesystemSupportFor, nullptr},
+    {"har", hdfs::ProvideFilesystemSupportFor, nullptr},
+    {"chfs", chfs::ProvideFilesystemSupportFor,
+     chfs::GetInitializedFilesystem},
+};
+constexpr size_t kNumWrappedSchemes =
+    sizeof(kWrappedSchemes) / sizeof(kWrappedSchemes[0]);
+
+uint64_t GetEnvUint64(const char* name, uint64_t default_value) {
+  const char* env = getenv(name);
+  uint64_t value;
+  if (env != nullptr && absl::SimpleAtoi(env, &value)) return value;
+  return default_value;
+}
+
+// Frees the tables allocated by a `ProvideFilesystemSupportFor`.
+void FreeOps(TF_FilesystemPluginOps* ops) {
+  free(ops->scheme);
+  plugin_memory_free(ops->filesystem_ops);
+  plugin_memory_free(ops->random_access_file_ops);
+  plugin_memory_free(ops->writable_file_ops);
+  plugin_memory_free(ops->read_only_memory_region_ops);
+}
+
+// "cache.s3://bucket/key" -> "s3://bucket/key".
+std::string InnerPath(const char* path) {
+  absl::string_view inner_path(path);
+  absl::ConsumePrefix(&inner_path, kSchemePrefix);
+  return std::string(inner_path);
+}
+
+// The signature of a file in the block caches, which changes when it is
+// rewritten.
+int64_t FileSignature(const TF_FileStatistics& stats) {
+  return static_cast<int64_t>(static_cast<uint64_t>(stats.mtime_nsec) *
+                                  1000003 +
+                              static_cast<uint64_t>(stats.length));
+}
+
+// A random access file of the wrapped filesystem.
+typedef struct InnerFile {
+  const TF_RandomAccessFileOps* ops;
+  TF_RandomAccessFile file;
+  ~InnerFile() { ops->cleanup(&file); }
+} InnerFile;
+
+typedef struct CacheFileSystem {
+  // TensorFlow initializes the filesystems of every scheme when the plugin is
+  // loaded, so the wrapped filesystem and the caches below are only set up
+  // on first use, under `init_mu`.
+  size_t index;
+  absl::Mutex init_mu;
+  std::atomic<bool> initialized;
+
+  // The wrapped filesystem: `own_filesystem`, or the instance registered for
+  // its own scheme if the scheme provides `get_initialized_filesystem`.
+  TF_FilesystemPluginOps ops;
+  TF_Filesystem* filesystem;
+  TF_Filesystem own_filesystem;
+
+  // Results of `stat`, kept for TF_IO_CACHE_STAT_MAX_AGE seconds (0 disables
+  // the cache) and bounded by TF_IO_CACHE_STAT_MAX_ENTRIES. Paths written,
+  // renamed or deleted through the wrapper are dropped right away.
+  std::unique_ptr<ExpiringLRUCache<TF_FileStatistics>> stat_cache;
+  // Block cache shared by all random access files of this filesystem.
+  // Configured by TF_IO_CACHE_BLOCK_SIZE_MB, TF_IO_CACHE_MAX_SIZE_MB (0
+  // disables the cache) and TF_IO_CACHE_MAX_STALENESS (in seconds).
+  std::unique_ptr<RamFileBlockCache> block_cache;
+  // Second level below `block_cache`, in the subdirectory named after the
+  // wrapped scheme of TF_IO_CACHE_DISK_DIR (disabled if unset), bounded by
+  // TF_IO_CACHE_DISK_MAX_SIZE_MB.
+  std::unique_ptr<DiskBlockCache> disk_cache;
+  // Upper bound of the sequential read-ahead window
+  // (TF_IO_CACHE_READ_AHEAD_MAX_MB).
+  uint64_t read_ahead_max;
+  // Runs the read-ahead fetches (TF_IO_CACHE_NUM_THREADS). Declared after
+  // `block_cache` so that pending prefetches finish before it is destroyed.
+  std::unique_ptr<ThreadPool> thread_pool;
+
+  absl::Mutex mu;
+  // Open files by path, which the block fetcher reads from. Fetches for a
+  // path without an open file open a new one.
+  std::map<std::string, std::weak_ptr<InnerFile>> open_files
+      ABSL_GUARDED_BY(mu);
+} CacheFileSystem;
+
+std::shared_ptr<InnerFile> OpenInnerFile(CacheFileSystem* cache_fs,
+                                         const std::string& path,
+                                         TF_Status* status) {
+  TF_RandomAccessFile file = {nullptr};
+  cache_fs->ops.filesystem_ops->new_random_access_file(
+      cache_fs->filesystem, path.c_str(), &file, status);
+  if (TF_GetCode(status) != TF_OK) return nullptr;
+  auto inner = std::make_shared<InnerFile>();
+  inner->ops = cache_fs->ops.random_access_file_ops;
+  inner->file = file;
+  return inner;
+}
+
+void Stat(CacheFileSystem* cache_fs, const std::string& path,
+          TF_FileStatistics* stats, TF_Status* status) {
+  if (cache_fs->stat_cache->Lookup(path, stats)) {
+    TF_SetStatus(status, TF_OK, "");
+    return;
+  }
+  cache_fs->ops.filesystem_ops->stat(cache_fs->filesystem, path.c_str(),
+                                     stats, status);
+  if (TF_GetCode(status) == TF_OK) cache_fs->stat_cache->Insert(path, *stats);
+}
+
+// Drops what is cached about `path`, and about everything below it if
+// `recursive` is true.
+void Invalidate(CacheFileSystem* cache_fs, const std::string& path,
+                bool recursive = false) {
+  cache_fs->stat_cache->Delete(path);
+  if (recursive) {
+    cache_fs->stat_cache->DeletePrefix(
+        absl::EndsWith(path, "/") ? path : path + "/");
+  }
+  cache_fs->block_cache->RemoveFile(path);
+  cache_fs->disk_cache->RemoveFile(path);
+}
+
+int64_t FetchBlock(CacheFileSystem* cache_fs, const std::string& path,
+                   size_t offset, size_t n, char* buffer, TF_Status* status) {
+  size_t block_size = cache_fs->block_cache->block_size();
+  bool is_block = n == block_size && offset % block_size == 0;
+  int64_t read = -1;
+  if (is_block) read = cache_fs->disk_cache->Lookup(path, offset, n, buffer);
+  if (read >= 0) {
+    TF_SetStatus(status, TF_OK, "");
+    return read;
+  }
+
+  std::shared_ptr<InnerFile> inner;
+  {
+    absl::MutexLock l(&cache_fs->mu);
+    auto it = cache_fs->open_files.find(path);
+    if (it != cache_fs->open_files.end()) inner = it->second.lock();
+  }
+  if (inner == nullptr) {
+    inner = OpenInnerFile(cache_fs, path, status);
+    if (TF_GetCode(status) != TF_OK) return -1;
+  }
+  read = inner->ops->read(&inner->file, offset, n, buffer, status);
+  // A short read only marks the end of the file for the cache.
+  if (TF_GetCode(status) == TF_OUT_OF_RANGE) {
+    TF_SetStatus(status, TF_OK, "");
+    read = (std::max)(read, static_cast<int64_t>(0));
+  }
+  if (TF_GetCode(status) != TF_OK) return -1;
+  if (is_block && read > 0) {
+    cache_fs->disk_cache->Insert(path, offset, buffer, read);
+  }
+  return read;
+}
+
+}  // namespace
+
+// SECTION 1. Implementation for `TF_RandomAccessFile`
+// ----------------------------------------------------------------------------
+namespace tf_random_access_file {
+
+typedef struct CacheFile {
+  CacheFileSystem* cache_fs;
+  std::string path;
+  std::shared_ptr<InnerFile> inner;
+  // Whether reads go through the block cache, which needs the size of the
+  // file. Otherwise they are passed to `inner`.
+  bool cached;
+  uint64_t file_size;
+
+  // Sequential access detection for read-ahead. The window doubles on every
+  // read which starts where the previous one ended, up to `read_ahead_max`,
+  // and collapses on a random access.
+  absl::Mutex mu;
+  uint64_t next_offset ABSL_GUARDED_BY(mu);
+  uint64_t read_ahead ABSL_GUARDED_BY(mu);
+
+  CacheFile(CacheFileSystem* cache_fs, std::string path,
+            std::shared_ptr<InnerFile> inner)
+      : cache_fs(cache_fs),
+        path(std::move(path)),
+        inner(std::move(inner)),
+        cached(false),
+        file_size(0),
+        next_offset(0),
+        read_ahead(0) {}
+} CacheFile;
+
+static void Cleanup(TF_RandomAccessFile* file) {
+  auto cache_file = static_cast<CacheFile*>(file->plugin_file);
+  auto cache_fs = cache_file->cache_fs;
+  std::string path = cache_file->path;
+  delete cache_file;
+  absl::MutexLock l(&cache_fs->mu);
+  auto it = cache_fs->open_files.find(path);
+  if (it != cache_fs->open_files.end() && it->second.expired()) {
+    cache_fs->open_files.erase(it);
+  }
+}
+
+static void MaybeReadAhead(CacheFile* cache_file, uint64_t offset,
+                           size_t read) {
+  auto block_cache = cache_file->cache_fs->block_cache.get();
+  uint64_t window;
+  {
+    absl::MutexLock l(&cache_file->mu);
+    if (offset == cache_file->next_offset) {
+      cache_file->read_ahead = (std::min)(
+          (std::max)(cache_file->read_ahead * 2,
+                     static_cast<uint64_t>(block_cache->block_size())),
+          cache_file->cache_fs->read_ahead_max);
+    } else {
+      cache_file->read_ahead = 0;
+    }
+    cache_file->next_offset = offset + read;
+    window = cache_file->read_ahead;
+  }
+  uint64_t start = offset + read;
+  if (window == 0 || start >= cache_file->file_size) return;
+  block_cache->Prefetch(cache_file->path, start,
+                        (std::min)(window, cache_file->file_size - start));
+}
+
+static int64_t Read(const TF_RandomAccessFile* file, uint64_t offset, size_t n,
+                    char* buffer, TF_Status* status) {
+  auto cache_file = static_cast<CacheFile*>(file->plugin_file);
+  auto inner = cache_file->inner.get();
+  if (!cache_file->cached || n == 0) {
+    return inner->ops->read(&inner->file, offset, n, buffer, status);
+  }
+  if (offset >= cache_file->file_size) {
+    TF_SetStatus(status, TF_OUT_OF_RANGE, "Read past the end of file");
+    return 0;
+  }
+  // The cache must not be asked for blocks past the end of the file.
+  size_t length = (std::min)(static_cast<uint64_t>(n),
+                             cache_file->file_size - offset);
+  auto block_cache = cache_file->cache_fs->block_cache.get();
+  if (length > block_cache->max_bytes()) {
+    return inner->ops->read(&inner->file, offset, n, buffer, status);
+  }
+
+  // The blocks of a read spanning several of them are fetched concurrently.
+  if (length > block_cache->block_size()) {
+    block_cache->Prefetch(cache_file->path, offset, length);
+  }
+  int64_t read =
+      block_cache->Read(cache_file->path, offset, length, buffer, status);
+  if (TF_GetCode(status) != TF_OK) return read;
+  if (read > 0) MaybeReadAhead(cache_file, offset, read);
+  if (static_cast<size_t>(read) < n) {
+    TF_SetStatus(status, TF_OUT_OF_RANGE, "Read less bytes than requested");
+  }
+  return read;
+}
+
+}  // namespace tf_random_access_file
+
+// SECTION 2. Implementation for `TF_WritableFile`
+// ----------------------------------------------------------------------------
+namespace tf_writable_file {
+
+typedef struct CacheWritableFile {
+  CacheFileSystem* cache_fs;
+  std::string path;
+  TF_WritableFile file;
+} CacheWritableFile;
+
+static const TF_WritableFileOps* Ops(const CacheWritableFile* cache_file) {
+  return cache_file->cache_fs->ops.writable_file_ops;
+}
+
+static void Cleanup(TF_WritableFile* file) {
+  auto cache_file = static_cast<CacheWritableFile*>(file->plugin_file);
+  Ops(cache_file)->cleanup(&cache_file->file);
+  Invalidate(cache_file->cache_fs, cache_file->path);
+  delete cache_file;
+}
+
+static void Append(const TF_WritableFile* file, const char* buffer, size_t n,
+                   TF_Status* status) {
+  auto cache_file = static_cast<CacheWritableFile*>(file->plugin_file);
+  Ops(cache_file)->append(&cache_file->file, buffer, n, status);
+}
+
+static int64_t Tell(const TF_WritableFile* file, TF_Status* status) {
+  auto cache_file = static_cast<CacheWritableFile*>(file->plugin_file);
+  return Ops(cache_file)->tell(&cache_file->file, status);
+}
+
+// Flushed data may be visible to readers, so what is cached about the file
+// is dropped.
+static void Flush(const TF_WritableFile* file, TF_Status* status) {
+  auto cache_file = static_cast<CacheWritableFile*>(file->plugin_file);
+  Ops(cache_file)->flush(&cache_file->file, status);
+  Invalidate(cache_file->cache_fs, cache_file->path);
+}
+
+static void Sync(const TF_WritableFile* file, TF_Status* status) {
+  auto cache_file = static_cast<CacheWritableFile*>(file->plugin_file);
+  Ops(cache_file)->sync(&cache_file->file, status);
+  Invalidate(cache_file->cache_fs, cache_file->path);
+}
+
+static void Close(const TF_WritableFile* file, TF_Status* status) {
+  auto cache_file = static_cast<CacheWritableFile*>(file->plugin_file);
+  Ops(cache_file)->close(&cache_file->file, status);
+  Invalidate(cache_file->cache_fs, cache_file->path);
+}
+
+}  // namespace tf_writable_file
+
+// SECTION 3. Implementation for `TF_ReadOnlyMemoryRegion`
+// ----------------------------------------------------------------------------
+namespace tf_read_only_memory_region {
+
+typedef struct CacheMemoryRegion {
+  const TF_ReadOnlyMemoryRegionOps* ops;
+  TF_ReadOnlyMemoryRegion region;
+} CacheMemoryRegion;
+
+static void Cleanup(TF_ReadOnlyMemoryRegion* region) {
+  auto cache_region =
+      static_cast<CacheMemoryRegion*>(region->plugin_memory_region);
+  cache_region->ops->cleanup(&cache_region->region);
+  delete cache_region;
+}
+
+static const void* Data(const TF_ReadOnlyMemoryRegion* region) {
+  auto cache_region =
+      static_cast<CacheMemoryRegion*>(region->plugin_memory_region);
+  return cache_region->ops->data(&cache_region->region);
+}
+
+static uint64_t Length(const TF_ReadOnlyMemoryRegion* region) {
+  auto cache_region =
+      static_cast<CacheMemoryRegion*>(region->plugin_memory_region);
+  return cache_region->ops->length(&cache_region->region);
+}
+
+}  // namespace tf_read_only_memory_region
+
+// SECTION 4. Implementation for `TF_Filesystem`, the actual filesystem
+// ----------------------------------------------------------------------------
+namespace tf_cache_filesystem {
+
+static CacheFileSystem* GetCacheFileSystem(const TF_Filesystem* filesystem) {
+  return static_cast<CacheFileSystem*>(filesystem->plugin_filesystem);
+}
+
+// Sets up the wrapped filesystem and the caches of `cache_fs`.
+static void SetUp(CacheFileSystem* cache_fs, TF_Status* status)
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(cache_fs->init_mu) {
+  const WrappedScheme& wrapped = kWrappedSchemes[cache_fs->index];
+  if (wrapped.get_initialized_filesystem != nullptr) {
+    cache_fs->filesystem = wrapped.get_initialized_filesystem();
+    if (cache_fs->filesystem == nullptr) {
+      TF_SetStatus(status, TF_FAILED_PRECONDITION,
+                   absl::StrCat("The ", wrapped.scheme,
+                                " filesystem failed to initialize")
+                       .c_str());
+      return;
+    }
+  } else {
+    cache_fs->ops.filesystem_ops->init(&cache_fs->own_filesystem, status);
+    if (TF_GetCode(status) != TF_OK) return;
+    cache_fs->filesystem = &cache_fs->own_filesystem;
+  }
+
+  cache_fs->stat_cache.reset(new ExpiringLRUCache<TF_FileStatistics>(
+      GetEnvUint64("TF_IO_CACHE_STAT_MAX_AGE", kDefaultStatCacheMaxAge),
+      GetEnvUint64("TF_IO_CACHE_STAT_MAX_ENTRIES",
+                   kDefaultStatCacheMaxEntries)));
+  cache_fs->read_ahead_max =
+      GetEnvUint64("TF_IO_CACHE_READ_AHEAD_MAX_MB", kDefaultReadAheadMaxMB)
+      << 20;
+  cache_fs->thread_pool.reset(new ThreadPool(
+      absl::StrCat("cache.", wrapped.scheme),
+      std::max<uint64_t>(
+          GetEnvUint64("TF_IO_CACHE_NUM_THREADS", kDefaultNumThreads), 1)));
+  cache_fs->block_cache.reset(new RamFileBlockCache(
+      GetEnvUint64("TF_IO_CACHE_BLOCK_SIZE_MB", kDefaultBlockSizeMB) << 20,
+      GetEnvUint64("TF_IO_CACHE_MAX_SIZE_MB", kDefaultMaxCacheSizeMB) << 20,
+      GetEnvUint64("TF_IO_CACHE_MAX_STALENESS", kDefaultMaxStaleness),
+      [cache_fs](const std::string& path, size_t offset, size_t n,
+                 char* buffer, TF_Status* status) {
+        return FetchBlock(cache_fs, path, offset, n, buffer, status);
+      },
+      cache_fs->thread_pool.get()));
+  const char* disk_cache_dir = getenv("TF_IO_CACHE_DISK_DIR");
+  cache_fs->disk_cache.reset(new DiskBlockCache(
+      disk_cache_dir != nullptr && disk_cache_dir[0] != '\0'
+          ? absl::StrCat(disk_cache_dir, "/", wrapped.scheme)
+          : "",
+      GetEnvUint64("TF_IO_CACHE_DISK_MAX_SIZE_MB",
+                   kDefaultDiskCacheMaxSizeMB)
+          << 20));
+  TF_SetStatus(status, TF_OK, "");
+}
+
+// The wrapper of `filesystem`, set up if needed. Returns null with `status`
+// set if that fails, to be tried again on the next use.
+static CacheFileSystem* GetCacheFileSystem(const TF_Filesystem* filesystem,
+                                           TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem);
+  if (!cache_fs->initialized.load(std::memory_order_acquire)) {
+    absl::MutexLock l(&cache_fs->init_mu);
+    if (!cache_fs->initialized.load(std::memory_order_relaxed)) {
+      SetUp(cache_fs, status);
+      if (TF_GetCode(status) != TF_OK) return nullptr;
+      cache_fs->initialized.store(true, std::memory_order_release);
+    }
+  }
+  return cache_fs;
+}
+
+static void InitWrapper(TF_Filesystem* filesystem, size_t index,
+                        TF_Status* status) {
+  auto cache_fs = new CacheFileSystem();
+  cache_fs->index = index;
+  cache_fs->initialized = false;
+  cache_fs->ops = {};
+  cache_fs->filesystem = nullptr;
+  cache_fs->own_filesystem = {};
+  kWrappedSchemes[index].provide_filesystem_support_for(
+      &cache_fs->ops, kWrappedSchemes[index].scheme);
+  filesystem->plugin_filesystem = cache_fs;
+  TF_SetStatus(status, TF_OK, "");
+}
+
+// `init` has no way to tell which scheme it was registered for, so there is
+// one per wrapped scheme.
+template <size_t kIndex>
+static void Init(TF_Filesystem* filesystem, TF_Status* status) {
+  InitWrapper(filesystem, kIndex, status);
+}
+
+static void (*const kInits[])(TF_Filesystem*, TF_Status*) = {
+    Init<0>, Init<1>, Init<2>, Init<3>, Init<4>, Init<5>, Init<6>, Init<7>,
+};
+static_assert(sizeof(kInits) / sizeof(kInits[0]) == kNumWrappedSchemes,
+              "Every wrapped scheme needs an Init");
+
+static void Cleanup(TF_Filesystem* filesystem) {
+  auto cache_fs = GetCacheFileSystem(filesystem);
+  // Pending prefetches read from the wrapped filesystem.
+  cache_fs->thread_pool.reset();
+  // A shared instance is cleaned up with its own scheme.
+  if (cache_fs->filesystem == &cache_fs->own_filesystem) {
+    cache_fs->ops.filesystem_ops->cleanup(&cache_fs->own_filesystem);
+  }
+  FreeOps(&cache_fs->ops);
+  delete cache_fs;
+}
+
+static void NewRandomAccessFile(const TF_Filesystem* filesystem,
+                                const char* path, TF_RandomAccessFile* file,
+                                TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  std::string inner_path = InnerPath(path);
+  auto inner = OpenInnerFile(cache_fs, inner_path, status);
+  if (TF_GetCode(status) != TF_OK) return;
+  auto cache_file =
+      new tf_random_access_file::CacheFile(cache_fs, inner_path, inner);
+  file->plugin_file = cache_file;
+  if (!cache_fs->block_cache->IsCacheEnabled() ||
+      cache_fs->ops.filesystem_ops->stat == nullptr) {
+    return;
+  }
+
+  // The cache needs the size of the file, and a signature to drop the blocks
+  // of a previous version of it. Without them, reads are passed through.
+  TF_Status* stat_status = TF_NewStatus();
+  TF_FileStatistics stats;
+  Stat(cache_fs, inner_path, &stats, stat_status);
+  if (TF_GetCode(stat_status) == TF_OK && !stats.is_directory) {
+    cache_fs->block_cache->ValidateAndUpdateFileSignature(
+        inner_path, FileSignature(stats));
+    cache_fs->disk_cache->ValidateAndUpdateFileSignature(inner_path,
+                                                         FileSignature(stats));
+    {
+      absl::MutexLock l(&cache_fs->mu);
+      cache_fs->open_files[inner_path] = inner;
+    }
+    cache_file->file_size = stats.length;
+    cache_file->cached = true;
+  }
+  TF_DeleteStatus(stat_status);
+}
+
+static void NewWritableFile(const TF_Filesystem* filesystem, const char* path,
+                            TF_WritableFile* file, TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  std::string inner_path = InnerPath(path);
+  auto cache_file =
+      new tf_writable_file::CacheWritableFile{cache_fs, inner_path, {}};
+  cache_fs->ops.filesystem_ops->new_writable_file(
+      cache_fs->filesystem, inner_path.c_str(), &cache_file->file, status);
+  Invalidate(cache_fs, inner_path);
+  if (TF_GetCode(status) != TF_OK) {
+    delete cache_file;
+    return;
+  }
+  file->plugin_file = cache_file;
+}
+
+static void NewAppendableFile(const TF_Filesystem* filesystem, const char* path,
+                              TF_WritableFile* file, TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  std::string inner_path = InnerPath(path);
+  auto cache_file =
+      new tf_writable_file::CacheWritableFile{cache_fs, inner_path, {}};
+  cache_fs->ops.filesystem_ops->new_appendable_file(
+      cache_fs->filesystem, inner_path.c_str(), &cache_file->file, status);
+  Invalidate(cache_fs, inner_path);
+  if (TF_GetCode(status) != TF_OK) {
+    delete cache_file;
+    return;
+  }
+  file->plugin_file = cache_file;
+}
+
+static void NewReadOnlyMemoryRegionFromFile(const TF_Filesystem* filesystem,
+                                            const char* path,
+                                            TF_ReadOnlyMemoryRegion* region,
+                                            TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  auto cache_region = new tf_read_only_memory_region::CacheMemoryRegion{
+      cache_fs->ops.read_only_memory_region_ops, {}};
+  cache_fs->ops.filesystem_ops->new_read_only_memory_region_from_file(
+      cache_fs->filesystem, InnerPath(path).c_str(), &cache_region->region,
+      status);
+  if (TF_GetCode(status) != TF_OK) {
+    delete cache_region;
+    return;
+  }
+  region->plugin_memory_region = cache_region;
+}
+
+static void CreateDir(const TF_Filesystem* filesystem, const char* path,
+                      TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  std::string inner_path = InnerPath(path);
+  cache_fs->ops.filesystem_ops->create_dir(cache_fs->filesystem,
+                                           inner_path.c_str(), status);
+  Invalidate(cache_fs, inner_path);
+}
+
+static void RecursivelyCreateDir(const TF_Filesystem* filesystem,
+                                 const char* path, TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  std::string inner_path = InnerPath(path);
+  cache_fs->ops.filesystem_ops->recursively_create_dir(
+      cache_fs->filesystem, inner_path.c_str(), status);
+  // Missing ancestors were created too.
+  cache_fs->stat_cache->Clear();
+}
+
+static void DeleteFile(const TF_Filesystem* filesystem, const char* path,
+                       TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  std::string inner_path = InnerPath(path);
+  cache_fs->ops.filesystem_ops->delete_file(cache_fs->filesystem,
+                                            inner_path.c_str(), status);
+  Invalidate(cache_fs, inner_path);
+}
+
+static void DeleteDir(const TF_Filesystem* filesystem, const char* path,
+                      TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  std::string inner_path = InnerPath(path);
+  cache_fs->ops.filesystem_ops->delete_dir(cache_fs->filesystem,
+                                           inner_path.c_str(), status);
+  Invalidate(cache_fs, inner_path);
+}
+
+static void DeleteRecursively(const TF_Filesystem* filesystem, const char* path,
+                              uint64_t* undeleted_files,
+                              uint64_t* undeleted_dirs, TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  std::string inner_path = InnerPath(path);
+  cache_fs->ops.filesystem_ops->delete_recursively(
+      cache_fs->filesystem, inner_path.c_str(), undeleted_files,
+      undeleted_dirs, status);
+  // Blocks of deleted files are dropped when a new file by the same name is
+  // opened, since its signature differs.
+  Invalidate(cache_fs, inner_path, /*recursive=*/true);
+}
+
+static void RenameFile(const TF_Filesystem* filesystem, const char* src,
+                       const char* dst, TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  std::string inner_src = InnerPath(src), inner_dst = InnerPath(dst);
+  cache_fs->ops.filesystem_ops->rename_file(
+      cache_fs->filesystem, inner_src.c_str(), inner_dst.c_str(), status);
+  // `src` may be a directory.
+  Invalidate(cache_fs, inner_src, /*recursive=*/true);
+  Invalidate(cache_fs, inner_dst, /*recursive=*/true);
+}
+
+static void CopyFile(const TF_Filesystem* filesystem, const char* src,
+                     const char* dst, TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  std::string inner_dst = InnerPath(dst);
+  cache_fs->ops.filesystem_ops->copy_file(cache_fs->filesystem,
+                                          InnerPath(src).c_str(),
+                                          inner_dst.c_str(), status);
+  Invalidate(cache_fs, inner_dst);
+}
+
+// With a `stat` in the wrapped filesystem, `PathExists`, `IsDirectory` and
+// `GetFileSize` are answered from the stat cache.
+static void PathExists(const TF_Filesystem* filesystem, const char* path,
+                       TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  std::string inner_path = InnerPath(path);
+  if (cache_fs->ops.filesystem_ops->stat == nullptr) {
+    return cache_fs->ops.filesystem_ops->path_exists(
+        cache_fs->filesystem, inner_path.c_str(), status);
+  }
+  TF_FileStatistics stats;
+  Stat(cache_fs, inner_path, &stats, status);
+}
+
+static void Stat(const TF_Filesystem* filesystem, const char* path,
+                 TF_FileStatistics* stats, TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  Stat(cache_fs, InnerPath(path), stats, status);
+}
+
+static bool IsDirectory(const TF_Filesystem* filesystem, const char* path,
+                        TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return false;
+  std::string inner_path = InnerPath(path);
+  if (cache_fs->ops.filesystem_ops->stat == nullptr) {
+    return cache_fs->ops.filesystem_ops->is_directory(
+        cache_fs->filesystem, inner_path.c_str(), status);
+  }
+  TF_FileStatistics stats;
+  Stat(cache_fs, inner_path, &stats, status);
+  if (TF_GetCode(status) != TF_OK) return false;
+  if (!stats.is_directory) {
+    TF_SetStatus(status, TF_FAILED_PRECONDITION, "Not a directory");
+    return false;
+  }
+  return true;
+}
+
+static int64_t GetFileSize(const TF_Filesystem* filesystem, const char* path,
+                           TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return -1;
+  std::string inner_path = InnerPath(path);
+  if (cache_fs->ops.filesystem_ops->stat == nullptr) {
+    return cache_fs->ops.filesystem_ops->get_file_size(
+        cache_fs->filesystem, inner_path.c_str(), status);
+  }
+  TF_FileStatistics stats;
+  Stat(cache_fs, inner_path, &stats, status);
+  if (TF_GetCode(status) != TF_OK) return -1;
+  if (stats.is_directory) {
+    TF_SetStatus(status, TF_FAILED_PRECONDITION, "Path is a directory");
+    return -1;
+  }
+  return stats.length;
+}
+
+static int GetChildren(const TF_Filesystem* filesystem, const char* path,
+                       char*** entries, TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return -1;
+  return cache_fs->ops.filesystem_ops->get_children(
+      cache_fs->filesystem, InnerPath(path).c_str(), entries, status);
+}
+
+static int GetMatchingPaths(const TF_Filesystem* filesystem,
+                            const char* pattern, char*** entries,
+                            TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return -1;
+  int num_entries = cache_fs->ops.filesystem_ops->get_matching_paths(
+      cache_fs->filesystem, InnerPath(pattern).c_str(), entries, status);
+  if (TF_GetCode(status) != TF_OK) return num_entries;
+  // Matches are full paths of the wrapped scheme.
+  for (int i = 0; i < num_entries; i++) {
+    std::string entry = absl::StrCat(kSchemePrefix, (*entries)[i]);
+    plugin_memory_free((*entries)[i]);
+    (*entries)[i] =
+        static_cast<char*>(plugin_memory_allocate(entry.size() + 1));
+    memcpy((*entries)[i], entry.c_str(), entry.size() + 1);
+  }
+  return num_entries;
+}
+
+static void FlushCaches(const TF_Filesystem* filesystem) {
+  auto cache_fs = GetCacheFileSystem(filesystem);
+  // Nothing is cached before the first use.
+  if (!cache_fs->initialized.load(std::memory_order_acquire)) return;
+  // The disk cache is meant to outlive the process, and is kept.
+  cache_fs->block_cache->Flush();
+  cache_fs->stat_cache->Clear();
+  if (cache_fs->ops.filesystem_ops->flush_caches != nullptr) {
+    cache_fs->ops.filesystem_ops->flush_caches(cache_fs->filesystem);
+  }
+}
+
+static void SetFilesystemConfiguration(const TF_Filesystem* filesystem,
+                                       const TF_Filesystem_Option* options,
+                                       int num_options, TF_Status* status) {
+  auto cache_fs = GetCacheFileSystem(filesystem, status);
+  if (cache_fs == nullptr) return;
+  cache_fs->ops.filesystem_ops->set_filesystem_configuration(
+      cache_fs->filesystem, options, num_options, status);
+}
+
+}  // namespace tf_cache_filesystem
+
+void ProvideFilesystemSupportFor(TF_FilesystemPluginOps* ops, const char* uri) {
+  absl::string_view scheme(uri);
+  absl::ConsumePrefix(&scheme, kSchemePrefix);
+  size_t index = 0;
+  while (index < kNumWrappedSchemes &&
+         scheme != kWrappedSchemes[index].scheme) {
+    index++;
+  }
+  if (index == kNumWrappedSchemes) {
+    TF_Log(TF_FATAL, "No filesystem to wrap for %s", uri);
+    return;
+  }
+
+  // The ops of the wrapped filesystem, to only provide those it implements.
+  TF_FilesystemPluginOps wrapped = {};
+  kWrappedSchemes[index].provide_filesystem_support_for(
+      &wrapped, kWrappedSchemes[index].scheme);
+
+  TF_SetFilesystemVersionMetadata(ops);
+  ops->scheme = strdup(uri);
+
+  ops->random_access_file_ops = static_cast<TF_RandomAccessFileOps*>(
+      plugin_memory_allocate(TF_RANDOM_ACCESS_FILE_OPS_SIZE));
+  ops->random_access_file_ops->cleanup = tf_random_access_file::Cleanup;
+  ops->random_access_file_ops->read = tf_random_access_file::Read;
+
+  ops->writable_file_ops = static_cast<TF_WritableFileOps*>(
+      plugin_memory_allocate(TF_WRITABLE_FILE_OPS_SIZE));
+  ops->writable_file_ops->cleanup = tf_writable_file::Cleanup;
+  ops->writable_file_ops->append = tf_writable_file::Append;
+  ops->writable_file_ops->tell = tf_writable_file::Tell;
+  ops->writable_file_ops->flush = tf_writable_file::Flush;
+  ops->writable_file_ops->sync = tf_writable_file::Sync;
+  ops->writable_file_ops->close = tf_writable_file::Close;
+
+  ops->read_only_memory_region_ops = static_cast<TF_ReadOnlyMemoryRegionOps*>(
+      plugin_memory_allocate(TF_READ_ONLY_MEMORY_REGION_OPS_SIZE));
+  ops->read_only_memory_region_ops->cleanup =
+      tf_read_only_memory_region::Cleanup;
+  ops->read_only_memory_region_ops->data = tf_read_only_memory_region::Data;
+  ops->read_only_memory_region_ops->length = tf_read_only_memory_region::Length;
+
+  const TF_FilesystemOps* wrapped_ops = wrapped.filesystem_ops;
+  ops->filesystem_ops = static_cast<TF_FilesystemOps*>(
+      plugin_memory_allocate(TF_FILESYSTEM_OPS_SIZE));
+  ops->filesystem_ops->init = tf_cache_filesystem::kInits[index];
+  ops->filesystem_ops->cleanup = tf_cache_filesystem::Cleanup;
+  ops->filesystem_ops->new_random_access_file =
+      tf_cache_filesystem::NewRandomAccessFile;
+#define WRAP_OP(op, function)                              \
+  if (wrapped_ops->op != nullptr) {                        \
+    ops->filesystem_ops->op = tf_cache_filesystem::function; \
+  }
+  WRAP_OP(new_writable_file, NewWritableFile);
+  WRAP_OP(new_appendable_file, NewAppendableFile);
+  WRAP_OP(new_read_only_memory_region_from_file,
+          NewReadOnlyMemoryRegionFromFile);
+  WRAP_OP(create_dir, CreateDir);
+  WRAP_OP(recursively_create_dir, RecursivelyCreateDir);
+  WRAP_OP(delete_file, DeleteFile);
+  WRAP_OP(delete_dir, DeleteDir);
+  WRAP_OP(delete_recursively, DeleteRecursively);
+  WRAP_OP(rename_file, RenameFile);
+  WRAP_OP(copy_file, CopyFile);
+  WRAP_OP(path_exists, PathExists);
+  WRAP_OP(stat, Stat);
+  WRAP_OP(is_directory, IsDirectory);
+  WRAP_OP(get_file_size, GetFileSize);
+  WRAP_OP(get_children, GetChildren);
+  WRAP_OP(get_matching_paths, GetMatchingPaths);
+  WRAP_OP(set_filesystem_configuration, SetFilesystemConfiguration);
+#undef WRAP_OP
+  ops->filesystem_ops->flush_caches = tf_cache_filesystem::FlushCaches;
+
+  FreeOps(&wrapped);
+}
+
+}  // namespace cache
+}  // namespace io
+}  // namespace tensorflow
@@ -3,13 +3,92 @@
 #include <dlfcn.h>
 
 // #undef NDEBUG
+#include <atomic>
 #include <cassert>
+#include <chrono>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "tensorflow/c/logging.h"
+
+constexpr uint64_t kDefaultBlockSizeMB = 1;
+constexpr uint64_t kDefaultMaxCacheSizeMB = 128;
+constexpr uint64_t kDefaultMaxStaleness = 0;
+constexpr uint64_t kDefaultReadAheadMaxMB = 16;
+constexpr uint64_t kDefaultDiskCacheMaxSizeMB = 10240;
+constexpr uint64_t kDefaultNumThreads = 8;
+constexpr uint64_t kDefaultNumContexts = 1;
+constexpr uint64_t kDefaultPrefetchConcurrency = 4;
+constexpr uint64_t kDefaultParallelReadSizeMB = 4;
+constexpr uint64_t kDefaultParallelReadThresholdMB = 8;
+constexpr uint64_t kDefaultStatCacheMaxAge = 5;
+constexpr uint64_t kDefaultStatCacheMaxEntries = 4096;
+constexpr uint64_t kDefaultFdCacheSize = 256;
+// Default chunk size of the CHFS client library.
+constexpr uint64_t kDefaultChunkSize = 64 * 1024;
+constexpr uint64_t kDefaultWriteBufferSizeMB = 4;
+constexpr uint64_t kDefaultWriteMaxPendingMB = 64;
+
+static uint64_t NowSeconds() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static uint64_t GetEnvUint64(const char* name, uint64_t default_value) {
+  uint64_t value;
+  const char* env = std::getenv(name);
+  if (env != nullptr && absl::SimpleAtoi(env, &value)) return value;
+  return default_value;
+}
+
+// Operations counted by `CHFS::stats`, in the order of kCHFSOpNames.
+enum CHFSOp {
+  kCHFSOpen,
+  kCHFSCreate,
+  kCHFSClose,
+  kCHFSPread,
+  kCHFSPwrite,
+  kCHFSStat,
+  kCHFSReaddir,
+  kCHFSMkdir,
+  kCHFSRmdir,
+  kCHFSUnlink,
+  kCHFSRename,
+};
+static const std::vector<std::string> kCHFSOpNames = {
+    "open",    "create", "close", "pread",  "pwrite", "stat",
+    "readdir", "mkdir",  "rmdir", "unlink", "rename"};
+
+// Replaces `func` by a wrapper which records every call in `stats`. A
+// negative result counts as an error, a positive one as transferred bytes if
+// `counts_bytes`.
+template <typename... Args>
+static void Instrument(tensorflow::io::FileSystemStats* stats, CHFSOp op,
+                       bool counts_bytes, std::function<int(Args...)>* func) {
+  if (!*func) return;
+  std::function<int(Args...)> call = std::move(*func);
+  *func = [stats, op, counts_bytes, call](Args... args) {
+    uint64_t start = tensorflow::io::FileSystemStats::NowMicros();
+    int rc = call(args...);
+    int error = errno;
+    stats->Record(op, tensorflow::io::FileSystemStats::NowMicros() - start,
+                  counts_bytes && rc > 0 ? rc : 0, rc >= 0);
+    errno = error;
+    return rc;
+  };
+}
 
 CHFS::CHFS(const char* server, TF_Status* status) {
   TF_SetStatus(status, TF_OK, "");
   int rc;
 
-  libchfs.reset(new libCHFS(status));
+  size_t num_contexts = GetEnvUint64("CHFS_NUM_CONTEXTS", kDefaultNumContexts);
+  if (num_contexts > 1) {
+    libchfs.reset(new libCHFS(num_contexts, status));
+  } else {
+    libchfs.reset(new libCHFS(status));
+  }
   if (TF_GetCode(status) != TF_OK) {
     libchfs.reset(nullptr);
     return;
@@ -20,9 +99,103 @@ CHFS::CHFS(const char* server, TF_Status* status) {
     TF_SetStatus(status, TF_INTERNAL, "Error initializing CHFS library");
     return;
   }
+
+  if (GetEnvUint64("CHFS_STATS", 1) != 0) {
+    stats.reset(new tensorflow::io::FileSystemStats(kCHFSOpNames));
+    tensorflow::io::FileSystemStats* s = stats.get();
+    Instrument(s, kCHFSOpen, false, &libchfs->chfs_open);
+    Instrument(s, kCHFSCreate, false, &libchfs->chfs_create);
+    Instrument(s, kCHFSClose, false, &libchfs->chfs_close);
+    Instrument(s, kCHFSPread, true, &libchfs->chfs_pread);
+    Instrument(s, kCHFSPwrite, true, &libchfs->chfs_pwrite);
+    Instrument(s, kCHFSStat, false, &libchfs->chfs_stat);
+    Instrument(s, kCHFSReaddir, false, &libchfs->chfs_readdir);
+    Instrument(s, kCHFSMkdir, false, &libchfs->chfs_mkdir);
+    Instrument(s, kCHFSRmdir, false, &libchfs->chfs_rmdir);
+    Instrument(s, kCHFSUnlink, false, &libchfs->chfs_unlink);
+    Instrument(s, kCHFSRename, false, &libchfs->chfs_rename);
+    tensorflow::io::RegisterFileSystemStats("chfs", s);
+  }
+
+  uint64_t stat_max_age =
+      GetEnvUint64("CHFS_STAT_CACHE_MAX_AGE", kDefaultStatCacheMaxAge);
+  stat_cache.reset(new tensorflow::io::ExpiringLRUCache<CachedStat>(
+      stat_max_age, GetEnvUint64("CHFS_STAT_CACHE_MAX_ENTRIES",
+                                 kDefaultStatCacheMaxEntries)));
+  stat_cache_negative = GetEnvUint64("CHFS_STAT_CACHE_NEGATIVE", 1) != 0;
+  max_idle_fds_ = GetEnvUint64("CHFS_FD_CACHE_SIZE", kDefaultFdCacheSize);
+  // Attributes kept with a descriptor are trusted no longer than those in
+  // `stat_cache` by default.
+  fd_max_age_ = GetEnvUint64("CHFS_FD_CACHE_MAX_AGE", stat_max_age);
+
+  size_t block_size =
+      GetEnvUint64("CHFS_READ_CACHE_BLOCK_SIZE_MB", kDefaultBlockSizeMB)
+      << 20;
+  size_t max_bytes =
+      GetEnvUint64("CHFS_READ_CACHE_MAX_SIZE_MB", kDefaultMaxCacheSizeMB)
+      << 20;
+  uint64_t max_staleness =
+      GetEnvUint64("CHFS_READ_CACHE_MAX_STALENESS", kDefaultMaxStaleness);
+  read_ahead_max =
+      GetEnvUint64("CHFS_READ_AHEAD_MAX_MB", kDefaultReadAheadMaxMB) << 20;
+  write_buffer_size =
+      GetEnvUint64("CHFS_WRITE_BUFFER_SIZE_MB", kDefaultWriteBufferSizeMB)
+      << 20;
+  write_max_pending =
+      GetEnvUint64("CHFS_WRITE_MAX_PENDING_MB", kDefaultWriteMaxPendingMB)
+      << 20;
+  size_t chunk_size =
+      std::max<uint64_t>(GetEnvUint64("CHFS_CHUNK_SIZE", kDefaultChunkSize), 1);
+  parallel_read_size =
+      GetEnvUint64("CHFS_PARALLEL_READ_SIZE_MB", kDefaultParallelReadSizeMB)
+      << 20;
+  parallel_read_size = std::max<size_t>(
+      (parallel_read_size + chunk_size - 1) / chunk_size * chunk_size,
+      chunk_size);
+  parallel_read_threshold = GetEnvUint64("CHFS_PARALLEL_READ_THRESHOLD_MB",
+                                         kDefaultParallelReadThresholdMB)
+                            << 20;
+  thread_pool.reset(new tensorflow::io::ThreadPool(
+      "chfs", GetEnvUint64("CHFS_NUM_THREADS", kDefaultNumThreads)));
+  prefetch_concurrency_ =
+      GetEnvUint64("CHFS_PREFETCH_CONCURRENCY", kDefaultPrefetchConcurrency);
+  block_cache.reset(new tensorflow::io::RamFileBlockCache(
+      block_size, max_bytes, max_staleness,
+      [this](const std::string& path, size_t offset, size_t n, char* buffer,
+             TF_Status* status) {
+        return ReadBlock(path, offset, n, buffer, status);
+      },
+      thread_pool.get()));
+
+  const char* disk_cache_dir = std::getenv("CHFS_DISK_CACHE_DIR");
+  disk_cache.reset(new tensorflow::io::DiskBlockCache(
+      disk_cache_dir != nullptr ? disk_cache_dir : "",
+      GetEnvUint64("CHFS_DISK_CACHE_MAX_SIZE_MB", kDefaultDiskCacheMaxSizeMB)
+          << 20));
 }
 
 CHFS::~CHFS() {
+  if (stats != nullptr) {
+    tensorflow::io::UnregisterFileSystemStats("chfs", stats.get());
+  }
+  // Drain background I/O before the library is terminated. Prefetch hints
+  // which did not start yet are dropped.
+  {
+    absl::MutexLock l(&prefetch_mu_);
+    prefetch_stopping_ = true;
+  }
+  thread_pool.reset(nullptr);
+  block_cache.reset(nullptr);
+  for (auto& entry : read_fds_) {
+    libchfs->chfs_close(entry.second.fd);
+  }
+  for (auto& entry : detached_fds_) {
+    libchfs->chfs_close(entry.first);
+  }
+  read_fds_.clear();
+  idle_fds_.clear();
+  detached_fds_.clear();
+
   libchfs->chfs_term();
 
   libchfs.reset(nullptr);
@@ -48,26 +221,36 @@ void CopyEntries(char*** entries, std::vector<std::string>& results) {
       tensorflow::io::plugin_memory_allocate(results.size() * sizeof(char*)));
 
   for (uint32_t i = 0; i < results.size(); i++) {
-    (*entries)[i] = static_cast<char*>(tensorflow::io::plugin_memory_allocate(
-        results[i].size() * sizeof(char)));
     if (results[i][0] == '/') results[i].erase(0, 1);
+    (*entries)[i] = static_cast<char*>(tensorflow::io::plugin_memory_allocate(
+        (results[i].size() + 1) * sizeof(char)));
     strcpy((*entries)[i], results[i].c_str());
   }
 }
 
+int64_t FileSignature(const struct stat* st) {
+  return static_cast<int64_t>(st->st_mtime) * 1000003 +
+         static_cast<int64_t>(st->st_size);
+}
+
 const std::string GetPath(const std::string& path) {
   auto pos = path.find("://");
   if (pos != std::string::npos) return path.substr(pos + 3);
   return path;
 }
 
+const std::string JoinPath(const std::string& dir, const std::string& name) {
+  if (!dir.empty() && dir.back() == '/') return dir + name;
+  return dir + "/" + name;
+}
+
 const std::string GetParent(const std::string& path) {
   std::filesystem::path p = path;
   return p.parent_path();
 }
 
 int CHFS::NewFile(const std::string path, FileMode mode, int32_t flags,
-                  TF_Status* status) {
+                  TF_Status* status, struct stat* st_out) {
   int rc, fd;
   mode_t m_mode;
   const std::string cpath = GetPath(path);
@@ -76,6 +259,15 @@ int CHFS::NewFile(const std::string path, FileMode mode, int32_t flags,
           tensorflow::io::plugin_memory_allocate(sizeof(struct stat))),
       tensorflow::io::plugin_memory_free);
 
+  if (mode == READ) {
+    fd = AcquireCachedReadFd(cpath, st.get());
+    if (fd >= 0) {
+      if (st_out != nullptr) *st_out = *st;
+      TF_SetStatus(status, TF_OK, "");
+      return fd;
+    }
+  }
+
   rc = Stat(cpath, st, status);
   if (rc != 0 && errno != ENOENT) {
     TF_SetStatus(status, TF_FAILED_PRECONDITION, "Error stating the path");
@@ -87,16 +279,39 @@ int CHFS::NewFile(const std::string path, FileMode mode, int32_t flags,
     return -1;
   }
 
+  if (mode == READ && !IsFile(st)) {
+    TF_SetStatus(status, TF_NOT_FOUND, "File not found");
+    return -1;
+  }
+
   if (IsFile(st) && mode == READ) {
-    fd = Open(path, flags, status);
+    // Drop cached blocks if the file changed since they were read.
+    block_cache->ValidateAndUpdateFileSignature(cpath, FileSignature(st.get()));
+    disk_cache->ValidateAndUpdateFileSignature(cpath, FileSignature(st.get()));
+    fd = AcquireReadFd(cpath, status, st.get());
     if (fd < 0) {
       TF_SetStatus(status, TF_INTERNAL, "Error opening a file");
       return -1;
     }
+    if (st_out != nullptr) *st_out = *st;
     TF_SetStatus(status, TF_OK, "");
     return fd;
   }
 
+  RemoveCachedBlocks(cpath);
+  InvalidateStat(cpath);
+  InvalidateFd(cpath);
+  if (IsFile(st) && mode == APPEND) {
+    // Appending must keep the existing contents. Writes are positional, so
+    // the descriptor is not opened with O_APPEND.
+    fd = Open(cpath, O_WRONLY, status);
+    if (fd < 0) {
+      TF_SetStatus(status, TF_INTERNAL, "Error opening a file");
+      return -1;
+    }
+    return fd;
+  }
+
   const std::string parent = GetParent(cpath);
   st.reset(static_cast<struct stat*>(
                tensorflow::io::plugin_memory_allocate(sizeof(struct stat))),
@@ -127,15 +342,246 @@ int CHFS::Open(const std::string path, int32_t flags, TF_Status* status) {
 
   fd = libchfs->chfs_open(cpath.c_str(), flags);
   if (fd < 0) {
-    if (fd == ENOENT) {
+    if (errno == ENOENT) {
       TF_SetStatus(status, TF_NOT_FOUND, "");
     } else {
-      TF_SetStatus(status, TF_FAILED_PRECONDITION, "Erorr openning a file");
+      TF_SetStatus(status, TF_FAILED_PRECONDITION, strerror(errno));
+    }
+  }
+  return fd;
+}
+
+// The open and close RPCs are issued without holding `read_fds_mu_`, so that
+// they do not serialize the opens of unrelated files.
+int CHFS::AcquireReadFd(const std::string path, TF_Status* status,
+                        const struct stat* st) {
+  TF_SetStatus(status, TF_OK, "");
+  FdKey key(path, O_RDONLY);
+  {
+    absl::MutexLock l(&read_fds_mu_);
+    auto it = read_fds_.find(key);
+    if (it != read_fds_.end()) {
+      if (it->second.refs++ == 0) idle_fds_.erase(it->second.idle_iterator);
+      // The caller just validated `st`, which renews the cached attributes.
+      if (st != nullptr) UpdateFdStat(&it->second, st);
+      return it->second.fd;
+    }
+  }
+  int fd = Open(path, O_RDONLY, status);
+  if (fd < 0) return fd;
+  int duplicate = -1;
+  {
+    absl::MutexLock l(&read_fds_mu_);
+    auto inserted = read_fds_.emplace(key, SharedFd());
+    SharedFd& entry = inserted.first->second;
+    if (inserted.second) {
+      entry.fd = fd;
+      entry.refs = 1;
+      entry.has_stat = false;
+    } else {
+      // Another reader opened the file meanwhile, its descriptor is shared.
+      if (entry.refs++ == 0) idle_fds_.erase(entry.idle_iterator);
+      duplicate = fd;
+      fd = entry.fd;
     }
+    if (st != nullptr) UpdateFdStat(&entry, st);
   }
+  if (duplicate >= 0) libchfs->chfs_close(duplicate);
   return fd;
 }
 
+void CHFS::UpdateFdStat(SharedFd* entry, const struct stat* st) {
+  entry->has_stat = true;
+  entry->st = *st;
+  entry->opened = NowSeconds();
+}
+
+int CHFS::AcquireCachedReadFd(const std::string path, struct stat* st) {
+  FdKey key(path, O_RDONLY);
+  absl::MutexLock l(&read_fds_mu_);
+  auto it = read_fds_.find(key);
+  if (it == read_fds_.end() || !it->second.has_stat) return -1;
+  // Expired attributes are renewed by a stat in NewFile.
+  if (NowSeconds() - it->second.opened >= fd_max_age_) return -1;
+  if (it->second.refs++ == 0) idle_fds_.erase(it->second.idle_iterator);
+  *st = it->second.st;
+  return it->second.fd;
+}
+
+void CHFS::ReleaseReadFd(const std::string path, int fd) {
+  std::vector<int> to_close;
+  {
+    absl::MutexLock l(&read_fds_mu_);
+    auto it = read_fds_.find(FdKey(path, O_RDONLY));
+    if (it == read_fds_.end() || it->second.fd != fd) {
+      auto detached = detached_fds_.find(fd);
+      if (detached != detached_fds_.end() && --detached->second == 0) {
+        to_close.push_back(fd);
+        detached_fds_.erase(detached);
+      }
+    } else if (--it->second.refs == 0) {
+      idle_fds_.push_front(it->first);
+      it->second.idle_iterator = idle_fds_.begin();
+      CloseIdleFds(&to_close);
+    }
+  }
+  for (int idle_fd : to_close) libchfs->chfs_close(idle_fd);
+}
+
+void CHFS::InvalidateFd(const std::string path) {
+  int to_close = -1;
+  {
+    absl::MutexLock l(&read_fds_mu_);
+    auto it = read_fds_.find(FdKey(path, O_RDONLY));
+    if (it == read_fds_.end()) return;
+    if (it->second.refs == 0) {
+      idle_fds_.erase(it->second.idle_iterator);
+      to_close = it->second.fd;
+    } else {
+      detached_fds_[it->second.fd] = it->second.refs;
+    }
+    read_fds_.erase(it);
+  }
+  if (to_close >= 0) libchfs->chfs_close(to_close);
+}
+
+void CHFS::CloseIdleFds(std::vector<int>* to_close) {
+  while (idle_fds_.size() > max_idle_fds_) {
+    auto it = read_fds_.find(idle_fds_.back());
+    to_close->push_back(it->second.fd);
+    read_fds_.erase(it);
+    idle_fds_.pop_back();
+  }
+}
+
+int64_t CHFS::PreadFully(int fd, char* buffer, size_t n, off_t offset,
+                         TF_Status* status) {
+  TF_SetStatus(status, TF_OK, "");
+  size_t total_bytes = 0;
+  while (total_bytes < n) {
+    ssize_t read_size =
+        libchfs->chfs_pread(fd, buffer + total_bytes, n - total_bytes,
+                            offset + total_bytes);
+    if (read_size < 0) {
+      TF_SetStatus(status, TF_INTERNAL, "Error reading");
+      return -1;
+    }
+    if (read_size == 0) break;  // EOF
+    total_bytes += read_size;
+  }
+  return total_bytes;
+}
+
+int64_t CHFS::ParallelPread(int fd, char* buffer, size_t n, off_t offset,
+                            TF_Status* status) {
+  TF_SetStatus(status, TF_OK, "");
+  size_t first = offset / parallel_read_size;
+  size_t last = (offset + n + parallel_read_size - 1) / parallel_read_size;
+  size_t chunks = last - first;
+  if (chunks <= 1) return PreadFully(fd, buffer, n, offset, status);
+
+  absl::Mutex mu;
+  TF_Code code = TF_OK;
+  // A short chunk marks EOF, everything after it is not part of the file.
+  size_t eof = n;
+  thread_pool->ParallelFor(chunks, 0, [&](size_t i) {
+    size_t chunk_begin =
+        std::max<size_t>((first + i) * parallel_read_size, offset);
+    size_t chunk_end =
+        std::min<size_t>((first + i + 1) * parallel_read_size, offset + n);
+    size_t chunk_offset = chunk_begin - offset;
+    size_t chunk_size = chunk_end - chunk_begin;
+    TF_Status* chunk_status = TF_NewStatus();
+    int64_t read_size = PreadFully(fd, buffer + chunk_offset, chunk_size,
+                                   chunk_begin, chunk_status);
+    absl::MutexLock l(&mu);
+    if (TF_GetCode(chunk_status) != TF_OK) {
+      code = TF_GetCode(chunk_status);
+    } else if (static_cast<size_t>(read_size) < chunk_size) {
+      eof = std::min(eof, chunk_offset + read_size);
+    }
+    TF_DeleteStatus(chunk_status);
+  });
+  if (code != TF_OK) {
+    TF_SetStatus(status, code, "Error reading");
+    return -1;
+  }
+  return eof;
+}
+
+int64_t CHFS::ReadBlock(const std::string& path, size_t offset, size_t n,
+                        char* buffer, TF_Status* status) {
+  // Reads larger than `block_cache` are passed through unaligned, and are
+  // not cached on disk either.
+  size_t block_size = block_cache->block_size();
+  bool is_block = n == block_size && offset % block_size == 0;
+  int64_t read_size = -1;
+  if (is_block) read_size = disk_cache->Lookup(path, offset, n, buffer);
+  if (read_size >= 0) {
+    TF_SetStatus(status, TF_OK, "");
+    return read_size;
+  }
+  int fd = AcquireReadFd(path, status);
+  if (fd < 0) return -1;
+  read_size = PreadFully(fd, buffer, n, offset, status);
+  ReleaseReadFd(path, fd);
+  if (is_block && TF_GetCode(status) == TF_OK && read_size > 0) {
+    disk_cache->Insert(path, offset, buffer, read_size);
+  }
+  return read_size;
+}
+
+void CHFS::RemoveCachedBlocks(const std::string& path) {
+  block_cache->RemoveFile(path);
+  disk_cache->RemoveFile(path);
+}
+
+void CHFS::Prefetch(const std::string path, uint64_t offset, int64_t length) {
+  absl::MutexLock l(&prefetch_mu_);
+  if (prefetch_stopping_ || prefetch_concurrency_ == 0) return;
+  prefetch_queue_.push_back({GetPath(path), offset, length});
+  if (prefetch_running_ < prefetch_concurrency_) {
+    prefetch_running_++;
+    thread_pool->Schedule([this]() { RunPrefetches(); });
+  }
+}
+
+void CHFS::RunPrefetches() {
+  while (true) {
+    PrefetchRequest request;
+    {
+      absl::MutexLock l(&prefetch_mu_);
+      if (prefetch_queue_.empty() || prefetch_stopping_) {
+        prefetch_running_--;
+        return;
+      }
+      request = std::move(prefetch_queue_.front());
+      prefetch_queue_.pop_front();
+    }
+    PrefetchFile(request);
+  }
+}
+
+void CHFS::PrefetchFile(const PrefetchRequest& request) {
+  // Opening validates the cached blocks and leaves the descriptor and the
+  // attributes of the file in the handle cache for the actual open.
+  struct stat st;
+  TF_Status* status = TF_NewStatus();
+  int fd = NewFile(request.path, READ, S_IRUSR | S_IFREG, status, &st);
+  if (TF_GetCode(status) == TF_OK) {
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    if (request.offset < size) {
+      uint64_t n = size - request.offset;
+      if (request.length >= 0) {
+        n = std::min(n, static_cast<uint64_t>(request.length));
+      }
+      block_cache->Prefetch(request.path, request.offset, n);
+    }
+    ReleaseReadFd(request.path, fd);
+  }
+  TF_DeleteStatus(status);
+}
+
 void CHFS::Close(int fd, TF_Status* status) {
   TF_SetStatus(status, TF_OK, "");
   int rc;
@@ -157,11 +603,32 @@ int CHFS::Stat(const std::string path, std::shared_ptr<struct stat>& st,
     return -1;
   }
 
+  CachedStat cached;
+  if (stat_cache->Lookup(cpath, &cached)) {
+    *st = cached.st;
+    errno = cached.error;
+    return cached.rc;
+  }
+
   struct stat* st_ptr = st.get();
   rc = libchfs->chfs_stat(cpath.c_str(), st_ptr);
+  int error = errno;
+  if (rc == 0 || (error == ENOENT && stat_cache_negative)) {
+    stat_cache->Insert(cpath, CachedStat{rc, error, *st_ptr});
+  }
+  errno = error;
   return rc;
 }
 
+void CHFS::InvalidateStat(const std::string path, bool recursive) {
+  std::string cpath = GetPath(path);
+  stat_cache->Delete(cpath);
+  if (recursive) {
+    if (cpath.empty() || cpath.back() != '/') cpath.push_back('/');
+    stat_cache->DeletePrefix(cpath);
+  }
+}
+
 int CHFS::IsDir(std::shared_ptr<struct stat>& st) {
   if (st == nullptr) {
     return false;
@@ -182,7 +649,12 @@ int CHFS::IsFile(std::shared_ptr<struct stat>& st) {
   return false;
 }
 
-static std::vector<std::string> readdir_entries;
+// Per-call state of ReadDir, handed to the filler through the opaque buffer
+// argument of chfs_readdir so that concurrent listings do not interfere.
+struct ReadDirContext {
+  std::vector<std::string>* children;
+  std::vector<struct stat>* stats;
+};
 
 static int readdirFiller(void* buf, const char* name, const struct stat* st,
                          off_t off) {
@@ -190,24 +662,108 @@ static int readdirFiller(void* buf, const char* name, const struct stat* st,
       (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
     return 0;
 
-  std::string filename(name);
-  readdir_entries.emplace_back(filename);
+  auto context = static_cast<ReadDirContext*>(buf);
+  context->children->emplace_back(name);
+  if (context->stats != nullptr) {
+    context->stats->emplace_back();
+    if (st != nullptr) {
+      context->stats->back() = *st;
+    } else {
+      memset(&context->stats->back(), 0, sizeof(struct stat));
+    }
+  }
   return 0;
 }
 
-int CHFS::ReadDir(const std::string path, std::vector<std::string>& child) {
+int CHFS::ReadDir(const std::string path, std::vector<std::string>& child,
+                  std::vector<struct stat>* stats) {
   int rc = 0;
-  char** buffer;
   std::string cpath = GetPath(path);
+  std::vector<struct stat> entry_stats;
+  ReadDirContext context{&child, &entry_stats};
 
-  rc = libchfs->chfs_readdir(cpath.c_str(), NULL, readdirFiller);
+  size_t first = child.size();
+  rc = libchfs->chfs_readdir(cpath.c_str(), &context, readdirFiller);
+  if (rc) return rc;
 
-  for (auto& entry : readdir_entries) {
-    child.emplace_back(entry);
+  // The listing already carries the attributes of every entry, remember them
+  // so that following stats of the children are free.
+  std::string prefix = cpath;
+  if (prefix.empty() || prefix.back() != '/') prefix.push_back('/');
+  for (size_t i = 0; i < entry_stats.size(); i++) {
+    if (entry_stats[i].st_mode == 0) continue;
+    stat_cache->Insert(prefix + child[first + i],
+                       CachedStat{0, 0, entry_stats[i]});
+  }
+  if (stats != nullptr) {
+    stats->insert(stats->end(), entry_stats.begin(), entry_stats.end());
   }
   return rc;
 }
 
+static bool HasWildcard(const std::string& component) {
+  return component.find_first_of("*?[\\") != std::string::npos;
+}
+
+void CHFS::Glob(const std::string pattern, std::vector<std::string>& results) {
+  std::vector<std::string> components = absl::StrSplit(
+      GetPath(pattern), '/', absl::SkipEmpty());
+
+  // Walk the fixed prefix of the pattern without listing anything.
+  std::string root = "/";
+  size_t depth = 0;
+  while (depth < components.size() && !HasWildcard(components[depth])) {
+    root = JoinPath(root, components[depth]);
+    depth++;
+  }
+
+  std::shared_ptr<struct stat> st(
+      static_cast<struct stat*>(
+          tensorflow::io::plugin_memory_allocate(sizeof(struct stat))),
+      tensorflow::io::plugin_memory_free);
+  TF_Status* status = TF_NewStatus();
+  int rc = Stat(root, st, status);
+  TF_DeleteStatus(status);
+  if (rc != 0) return;
+  if (depth == components.size()) {
+    results.push_back(root);
+    return;
+  }
+  if (!IsDir(st)) return;
+
+  absl::Mutex mu;
+  std::function<void(const std::string&, size_t)> walk;
+  walk = [&](const std::string& dir, size_t depth) {
+    std::vector<std::string> children;
+    std::vector<struct stat> stats;
+    if (ReadDir(dir, children, &stats) != 0) return;
+
+    bool last = depth + 1 == components.size();
+    std::vector<std::string> subdirs;
+    std::vector<std::string> matches;
+    for (size_t i = 0; i < children.size(); i++) {
+      if (fnmatch(components[depth].c_str(), children[i].c_str(),
+                  FNM_PATHNAME) != 0) {
+        continue;
+      }
+      std::string child = JoinPath(dir, children[i]);
+      if (last) {
+        matches.push_back(child);
+      } else if (S_ISDIR(stats[i].st_mode)) {
+        subdirs.push_back(child);
+      }
+    }
+    if (!matches.empty()) {
+      absl::MutexLock l(&mu);
+      results.insert(results.end(), matches.begin(), matches.end());
+    }
+    thread_pool->ParallelFor(subdirs.size(), 0, [&](size_t i) {
+      walk(subdirs[i], depth + 1);
+    });
+  };
+  walk(root, depth);
+}
+
 int CHFS::CreateDir(const std::string path, TF_Status* status) {
   TF_SetStatus(status, TF_OK, "");
   int rc;
@@ -230,6 +786,7 @@ int CHFS::CreateDir(const std::string path, TF_Status* status) {
   }
 
   TF_SetStatus(status, TF_OK, "");
+  InvalidateStat(cpath);
   rc = libchfs->chfs_mkdir(cpath.c_str(), S_IWUSR | S_IRUSR | S_IXUSR);
   if (rc) {
     TF_SetStatus(status, TF_INTERNAL, "Error creating directory");
@@ -255,6 +812,9 @@ int CHFS::DeleteEntry(const std::string path, bool is_dir, TF_Status* status) {
       TF_SetStatus(status, TF_INTERNAL, "");
     return -1;
   }
+  RemoveCachedBlocks(cpath);
+  InvalidateStat(cpath, IsDir(st));
+  InvalidateFd(cpath);
   if (IsDir(st)) {
     if (!is_dir) {
       TF_SetStatus(status, TF_FAILED_PRECONDITION, "Entory is a directory");
@@ -279,8 +839,202 @@ int CHFS::DeleteEntry(const std::string path, bool is_dir, TF_Status* status) {
   return 0;
 }
 
+void CHFS::RecursivelyCreateDir(const std::string path, TF_Status* status) {
+  TF_SetStatus(status, TF_OK, "");
+  std::vector<std::string> components =
+      absl::StrSplit(GetPath(path), '/', absl::SkipEmpty());
+  std::shared_ptr<struct stat> st(
+      static_cast<struct stat*>(
+          tensorflow::io::plugin_memory_allocate(sizeof(struct stat))),
+      tensorflow::io::plugin_memory_free);
+
+  // Find the deepest existing ancestor first, so that only the missing
+  // directories cost an RPC each.
+  size_t existing = components.size();
+  while (existing > 0) {
+    std::string dir;
+    for (size_t i = 0; i < existing; i++) dir = JoinPath(dir, components[i]);
+    if (Stat(dir, st, status) == 0) {
+      if (!IsDir(st)) {
+        TF_SetStatus(status, TF_FAILED_PRECONDITION,
+                     absl::StrCat(dir, " is not a directory").c_str());
+        return;
+      }
+      break;
+    }
+    if (TF_GetCode(status) != TF_OK) return;
+    if (errno != ENOENT) {
+      TF_SetStatus(status, TF_INTERNAL, strerror(errno));
+      return;
+    }
+    existing--;
+  }
+
+  std::string dir;
+  for (size_t i = 0; i < components.size(); i++) {
+    dir = JoinPath(dir, components[i]);
+    if (i < existing) continue;
+    CreateDir(dir, status);
+    if (TF_GetCode(status) == TF_ALREADY_EXISTS) {
+      TF_SetStatus(status, TF_OK, "");
+    }
+    if (TF_GetCode(status) != TF_OK) return;
+  }
+}
+
+void CHFS::DeleteRecursively(const std::string path, uint64_t* undeleted_files,
+                             uint64_t* undeleted_dirs, TF_Status* status) {
+  TF_SetStatus(status, TF_OK, "");
+  *undeleted_files = 0;
+  *undeleted_dirs = 0;
+  const std::string cpath = GetPath(path);
+  std::shared_ptr<struct stat> st(
+      static_cast<struct stat*>(
+          tensorflow::io::plugin_memory_allocate(sizeof(struct stat))),
+      tensorflow::io::plugin_memory_free);
+
+  if (Stat(cpath, st, status) != 0) {
+    if (TF_GetCode(status) != TF_OK) return;
+    if (errno == ENOENT) {
+      *undeleted_dirs = 1;
+      TF_SetStatus(status, TF_NOT_FOUND, "");
+    } else {
+      TF_SetStatus(status, TF_INTERNAL, strerror(errno));
+    }
+    return;
+  }
+  InvalidateStat(cpath, true);
+  if (!IsDir(st)) {
+    RemoveCachedBlocks(cpath);
+    InvalidateFd(cpath);
+    if (libchfs->chfs_unlink(cpath.c_str()) != 0) *undeleted_files = 1;
+    return;
+  }
+
+  std::atomic<uint64_t> files(0);
+  std::atomic<uint64_t> dirs(0);
+  std::function<void(const std::string&)> remove_dir;
+  remove_dir = [&](const std::string& dir) {
+    std::vector<std::string> children;
+    std::vector<struct stat> stats;
+    if (ReadDir(dir, children, &stats) != 0) {
+      dirs++;
+      return;
+    }
+    thread_pool->ParallelFor(children.size(), 0, [&](size_t i) {
+      std::string child = JoinPath(dir, children[i]);
+      if (S_ISDIR(stats[i].st_mode)) {
+        remove_dir(child);
+      } else {
+        RemoveCachedBlocks(child);
+        InvalidateFd(child);
+        if (libchfs->chfs_unlink(child.c_str()) != 0) files++;
+      }
+    });
+    if (libchfs->chfs_rmdir(dir.c_str()) != 0) dirs++;
+  };
+  remove_dir(cpath);
+  // Listing put the children back into the stat cache.
+  InvalidateStat(cpath, true);
+
+  *undeleted_files = files;
+  *undeleted_dirs = dirs;
+}
+
+void CHFS::CopyFile(const std::string src, const std::string dst,
+                    TF_Status* status) {
+  const std::string csrc = GetPath(src);
+  const std::string cdst = GetPath(dst);
+  std::shared_ptr<struct stat> st(
+      static_cast<struct stat*>(
+          tensorflow::io::plugin_memory_allocate(sizeof(struct stat))),
+      tensorflow::io::plugin_memory_free);
+
+  int src_fd = NewFile(csrc, READ, S_IRUSR | S_IFREG, status, st.get());
+  if (TF_GetCode(status) != TF_OK) return;
+  size_t size = static_cast<size_t>(st->st_size);
+
+  int dst_fd = NewFile(cdst, WRITE, S_IRUSR | S_IWUSR | S_IFREG, status);
+  if (TF_GetCode(status) != TF_OK) {
+    ReleaseReadFd(csrc, src_fd);
+    return;
+  }
+
+  std::atomic<bool> failed(false);
+  size_t chunks = (size + parallel_read_size - 1) / parallel_read_size;
+  thread_pool->ParallelFor(chunks, 0, [&](size_t i) {
+    if (failed) return;
+    size_t offset = i * parallel_read_size;
+    size_t n = std::min(parallel_read_size, size - offset);
+    std::unique_ptr<char[]> buffer(new char[n]);
+    TF_Status* chunk_status = TF_NewStatus();
+    int64_t read_size =
+        PreadFully(src_fd, buffer.get(), n, offset, chunk_status);
+    TF_DeleteStatus(chunk_status);
+    size_t written = 0;
+    while (read_size > 0 && written < static_cast<size_t>(read_size)) {
+      ssize_t rc = libchfs->chfs_pwrite(dst_fd, buffer.get() + written,
+                                        read_size - written, offset + written);
+      if (rc <= 0) break;
+      written += rc;
+    }
+    if (read_size != static_cast<int64_t>(n) || written != n) failed = true;
+  });
+  ReleaseReadFd(csrc, src_fd);
+
+  Close(dst_fd, status);
+  InvalidateStat(cdst);
+  if (failed) {
+    TF_SetStatus(status, TF_INTERNAL, "Error copying a file");
+  }
+}
+
+void CHFS::Rename(const std::string src, const std::string dst,
+                  TF_Status* status) {
+  TF_SetStatus(status, TF_OK, "");
+  const std::string csrc = GetPath(src);
+  const std::string cdst = GetPath(dst);
+  std::shared_ptr<struct stat> st(
+      static_cast<struct stat*>(
+          tensorflow::io::plugin_memory_allocate(sizeof(struct stat))),
+      tensorflow::io::plugin_memory_free);
+
+  if (Stat(csrc, st, status) != 0) {
+    if (TF_GetCode(status) != TF_OK) return;
+    if (errno == ENOENT) {
+      TF_SetStatus(status, TF_NOT_FOUND, "");
+    } else {
+      TF_SetStatus(status, TF_INTERNAL, strerror(errno));
+    }
+    return;
+  }
+  bool is_dir = IsDir(st);
+  RemoveCachedBlocks(csrc);
+  RemoveCachedBlocks(cdst);
+  InvalidateStat(csrc, is_dir);
+  InvalidateStat(cdst, true);
+  InvalidateFd(csrc);
+  InvalidateFd(cdst);
+
+  if (libchfs->chfs_rename) {
+    if (libchfs->chfs_rename(csrc.c_str(), cdst.c_str()) != 0) {
+      TF_SetStatus(status, TF_INTERNAL, strerror(errno));
+    }
+    return;
+  }
+
+  if (is_dir) {
+    TF_SetStatus(status, TF_UNIMPLEMENTED,
+                 "CHFS cannot rename directories without chfs_rename");
+    return;
+  }
+  CopyFile(csrc, cdst, status);
+  if (TF_GetCode(status) != TF_OK) return;
+  DeleteEntry(csrc, false, status);
+}
+
 static void* LoadSharedLibrary(const char* library_filename,
-                               TF_Status* status) {
+                               bool new_namespace, TF_Status* status) {
   std::vector<std::string> libdirs{"/usr/lib64", "/usr/local/lib64",
                                    "/opt/chfs/lib64"};
   char* libdir;
@@ -294,7 +1048,11 @@ static void* LoadSharedLibrary(const char* library_filename,
     std::string path = *itr;
     if (path.back() != '/') path.push_back('/');
     path.append(library_filename);
-    handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (new_namespace) {
+      handle = dlmopen(LM_ID_NEWLM, path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    } else {
+      handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    }
     if (handle != nullptr) {
       TF_SetStatus(status, TF_OK, "");
       return handle;
@@ -349,8 +1107,8 @@ libCHFS::~libCHFS() {
   }
 }
 
-void libCHFS::LoadAndBindCHFSLibs(TF_Status* status) {
-  libchfs_handle_ = LoadSharedLibrary("libchfs.so", status);
+void libCHFS::LoadAndBindCHFSLibs(bool new_namespace, TF_Status* status) {
+  libchfs_handle_ = LoadSharedLibrary("libchfs.so", new_namespace, status);
   if (TF_GetCode(status) != TF_OK) return;
 
 #define BIND_CHFS_FUNC(handle, function)            \
@@ -374,4 +1132,141 @@ void libCHFS::LoadAndBindCHFSLibs(TF_Status* status) {
   BIND_CHFS_FUNC(libchfs_handle_, chfs_readdir);
 
 #undef BIND_CHFS_FUNC
+
+  // A library in a new namespace comes with its own libc, and so its own
+  // errno.
+  if (new_namespace) {
+    errno_location_ = reinterpret_cast<int* (*)()>(
+        GetSymbolFromLibrary(libchfs_handle_, "__errno_location", status));
+    if (TF_GetCode(status) != TF_OK) return;
+  }
+
+  // Only available in some versions of libchfs.
+  BindFunc(libchfs_handle_, "chfs_rename", &chfs_rename, status);
+  if (TF_GetCode(status) != TF_OK) {
+    chfs_rename = nullptr;
+    TF_SetStatus(status, TF_OK, "");
+  }
+}
+
+libCHFS::libCHFS(size_t num_contexts, TF_Status* status) {
+  for (size_t i = 0; i < num_contexts; ++i) {
+    std::unique_ptr<libCHFS> context(new libCHFS(status, i > 0));
+    if (TF_GetCode(status) != TF_OK) {
+      if (i == 0) return;
+      TF_Log(TF_WARNING, "Using %zu CHFS contexts instead of %zu: %s", i,
+             num_contexts, TF_Message(status));
+      TF_SetStatus(status, TF_OK, "");
+      break;
+    }
+    contexts_.push_back(std::move(context));
+  }
+  BindContexts();
+}
+
+libCHFS* libCHFS::ThreadContext(size_t* index) {
+  static std::atomic<size_t> next_thread(0);
+  thread_local size_t thread = next_thread++;
+  *index = thread % contexts_.size();
+  return contexts_[*index].get();
+}
+
+int libCHFS::EncodeFd(int fd, size_t index) const {
+  if (fd < 0) return fd;
+  return fd * static_cast<int>(contexts_.size()) + static_cast<int>(index);
+}
+
+libCHFS* libCHFS::FdContext(int fd, int* local_fd) {
+  int n = static_cast<int>(contexts_.size());
+  *local_fd = fd / n;
+  return contexts_[fd % n].get();
+}
+
+void libCHFS::BindContexts() {
+  chfs_init = [this](const char* server) {
+    std::vector<std::string> servers;
+    if (server != nullptr) servers = absl::StrSplit(server, ',');
+    for (size_t i = 0; i < contexts_.size(); ++i) {
+      const char* s =
+          servers.empty() ? server : servers[i % servers.size()].c_str();
+      int rc = contexts_[i]->chfs_init(s);
+      if (rc != 0) return rc;
+    }
+    return 0;
+  };
+  chfs_term = [this]() {
+    int rc = 0;
+    for (auto& context : contexts_) {
+      if (context->chfs_term() != 0) rc = -1;
+    }
+    return rc;
+  };
+  chfs_create = [this](const char* path, int32_t flags, mode_t mode) {
+    size_t index;
+    libCHFS* context = ThreadContext(&index);
+    int fd = context->ReturnErrno(context->chfs_create(path, flags, mode));
+    return EncodeFd(fd, index);
+  };
+  chfs_open = [this](const char* path, int32_t flags) {
+    size_t index;
+    libCHFS* context = ThreadContext(&index);
+    int fd = context->ReturnErrno(context->chfs_open(path, flags));
+    return EncodeFd(fd, index);
+  };
+  chfs_close = [this](int fd) {
+    int local_fd;
+    libCHFS* context = FdContext(fd, &local_fd);
+    return context->ReturnErrno(context->chfs_close(local_fd));
+  };
+  chfs_pread = [this](int fd, void* buf, size_t size, off_t offset) {
+    int local_fd;
+    libCHFS* context = FdContext(fd, &local_fd);
+    return context->ReturnErrno(
+        context->chfs_pread(local_fd, buf, size, offset));
+  };
+  chfs_pwrite = [this](int fd, const void* buf, size_t size, off_t offset) {
+    int local_fd;
+    libCHFS* context = FdContext(fd, &local_fd);
+    return context->ReturnErrno(
+        context->chfs_pwrite(local_fd, buf, size, offset));
+  };
+  chfs_seek = [this](int fd, off_t offset, int whence) {
+    int local_fd;
+    libCHFS* context = FdContext(fd, &local_fd);
+    return context->ReturnErrno(context->chfs_seek(local_fd, offset, whence));
+  };
+  chfs_unlink = [this](const char* path) {
+    size_t index;
+    libCHFS* context = ThreadContext(&index);
+    return context->ReturnErrno(context->chfs_unlink(path));
+  };
+  chfs_mkdir = [this](const char* path, mode_t mode) {
+    size_t index;
+    libCHFS* context = ThreadContext(&index);
+    return context->ReturnErrno(context->chfs_mkdir(path, mode));
+  };
+  chfs_rmdir = [this](const char* path) {
+    size_t index;
+    libCHFS* context = ThreadContext(&index);
+    return context->ReturnErrno(context->chfs_rmdir(path));
+  };
+  chfs_stat = [this](const char* path, struct stat* st) {
+    size_t index;
+    libCHFS* context = ThreadContext(&index);
+    return context->ReturnErrno(context->chfs_stat(path, st));
+  };
+  chfs_readdir = [this](const char* path, void* buf,
+                        int (*filler)(void*, const char*, const struct stat*,
+                                      off_t)) {
+    size_t index;
+    libCHFS* context = ThreadContext(&index);
+    return context->ReturnErrno(context->chfs_readdir(path, buf, filler));
+  };
+  if (contexts_[0]->chfs_rename) {
+    chfs_rename = [this](const char* src, const char* dst) {
+      size_t index;
+      libCHFS* context = ThreadContext(&index);
+      return context->ReturnErrno(context->chfs_rename(src, dst));
+    };
+  }
 }
@@ -2,6 +2,7 @@
 #define TENSORFLOW_IO_CORE_FILESYTEM_CHFS_CHFS_H_
 
 #include <fcntl.h>
+#include <fnmatch.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 // clang-format off
@@ -9,9 +10,13 @@
 // clang-format on
 
 #include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <deque>
 #include <filesystem>
 #include <functional>
+#include <list>
+#include <map>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -20,23 +25,74 @@
 #include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
 #include "tensorflow/c/tf_status.h"
+#include "tensorflow_io/core/filesystems/disk_block_cache.h"
+#include "tensorflow_io/core/filesystems/expiring_lru_cache.h"
 #include "tensorflow_io/core/filesystems/filesystem_plugins.h"
+#include "tensorflow_io/core/filesystems/filesystem_stats.h"
+#include "tensorflow_io/core/filesystems/ram_file_block_cache.h"
+#include "tensorflow_io/core/filesystems/thread_pool.h"
 
 enum FileMode { READ, WRITE, APPEND, READWRITE };
 
 class libCHFS;
 
+// Result of a chfs_stat call, including failed ones.
+struct CachedStat {
+  int rc;
+  int error;
+  struct stat st;
+};
+
 class CHFS {
  public:
   std::unique_ptr<libCHFS> libchfs;
 
+  // Call counts, bytes and latencies of the libchfs functions, published
+  // under the "chfs" scheme unless CHFS_STATS is 0.
+  std::unique_ptr<tensorflow::io::FileSystemStats> stats;
+
+  // Results of chfs_stat, kept for CHFS_STAT_CACHE_MAX_AGE seconds (0
+  // disables the cache) and bounded by CHFS_STAT_CACHE_MAX_ENTRIES. Lookups of
+  // missing paths are cached too unless CHFS_STAT_CACHE_NEGATIVE is 0.
+  std::unique_ptr<tensorflow::io::ExpiringLRUCache<CachedStat>> stat_cache;
+  bool stat_cache_negative;
+
+  // Block cache shared by all random access files of this filesystem.
+  // Configured by CHFS_READ_CACHE_BLOCK_SIZE_MB, CHFS_READ_CACHE_MAX_SIZE_MB
+  // and CHFS_READ_CACHE_MAX_STALENESS (in seconds).
+  std::unique_ptr<tensorflow::io::RamFileBlockCache> block_cache;
+  // Second level below `block_cache`, in the local directory
+  // CHFS_DISK_CACHE_DIR (disabled if unset) and bounded by
+  // CHFS_DISK_CACHE_MAX_SIZE_MB. Blocks are keyed by the mtime and size of the
+  // file when it was opened, so later epochs, or later runs, read unchanged
+  // files from local storage.
+  std::unique_ptr<tensorflow::io::DiskBlockCache> disk_cache;
+  // Upper bound of the sequential read-ahead window (CHFS_READ_AHEAD_MAX_MB).
+  size_t read_ahead_max;
+  // Appends are buffered until CHFS_WRITE_BUFFER_SIZE_MB are collected, and
+  // block once more than CHFS_WRITE_MAX_PENDING_MB wait to be written.
+  size_t write_buffer_size;
+  size_t write_max_pending;
+  // Size of the sub-requests of ParallelPread (CHFS_PARALLEL_READ_SIZE_MB,
+  // rounded up to a multiple of the CHFS chunk size CHFS_CHUNK_SIZE so that
+  // every sub-request is served by as few servers as possible).
+  size_t parallel_read_size;
+  // Reads of at least CHFS_PARALLEL_READ_THRESHOLD_MB bypass the block cache
+  // and are striped with ParallelPread.
+  size_t parallel_read_threshold;
+  // Workers for background I/O (CHFS_NUM_THREADS). Declared after
+  // `block_cache` so that pending prefetches finish before it is destroyed.
+  std::unique_ptr<tensorflow::io::ThreadPool> thread_pool;
+
   // std::string GetPath(const std::string& path);
   // std::string GetParent(const std::string& path);
 
   explicit CHFS(const char* server, TF_Status* status);
 
+  // Opens or creates `path`. For READ, `st` (if given) receives the
+  // attributes of the file.
   int NewFile(const std::string path, FileMode mode, int flags,
-              TF_Status* status);
+              TF_Status* status, struct stat* st = nullptr);
 
   int CreateDir(const std::string path, TF_Status* status);
 
@@ -47,15 +103,137 @@ class CHFS {
   int Stat(const std::string path, std::shared_ptr<struct stat>& st,
            TF_Status* status);
 
+  // Drops the cached stat of `path`, and of everything below it if
+  // `recursive` is true.
+  void InvalidateStat(const std::string path, bool recursive = false);
+
   int IsDir(std::shared_ptr<struct stat>& st);
 
   int IsFile(std::shared_ptr<struct stat>& st);
 
-  int ReadDir(const std::string path, std::vector<std::string>& child);
+  // Appends the names of the entries of `path` to `child`, and their
+  // attributes to `stats` if it is not null. Safe to call concurrently.
+  int ReadDir(const std::string path, std::vector<std::string>& child,
+              std::vector<struct stat>* stats = nullptr);
 
   int DeleteEntry(const std::string path, bool is_dir, TF_Status* status);
 
+  // Creates `path` and all of its missing ancestors.
+  void RecursivelyCreateDir(const std::string path, TF_Status* status);
+
+  // Deletes `path` and everything below it. Entries of a directory are
+  // removed in parallel on `thread_pool` and the directory itself last.
+  void DeleteRecursively(const std::string path, uint64_t* undeleted_files,
+                         uint64_t* undeleted_dirs, TF_Status* status);
+
+  // Copies the regular file `src` to `dst` with chunked preads and pwrites
+  // issued in parallel.
+  void CopyFile(const std::string src, const std::string dst,
+                TF_Status* status);
+
+  // Renames with chfs_rename when libchfs provides it, and otherwise copies
+  // `src` to `dst` and deletes `src` (regular files only).
+  void Rename(const std::string src, const std::string dst, TF_Status* status);
+
+  // Appends every path matching the glob `pattern` to `results`. Only the
+  // directories below the longest wildcard-free prefix of `pattern` are
+  // listed, and sibling subdirectories are walked in parallel.
+  void Glob(const std::string pattern, std::vector<std::string>& results);
+
+  // Returns a read-only descriptor for `path` which is shared with every other
+  // reader of the same path. Each successful call must be paired with a call
+  // to ReleaseReadFd. `st`, if given, must be freshly validated attributes of
+  // the file, which are remembered with the descriptor for
+  // AcquireCachedReadFd.
+  int AcquireReadFd(const std::string path, TF_Status* status,
+                    const struct stat* st = nullptr);
+
+  // Returns a descriptor for `path` from the handle cache together with the
+  // attributes recorded when it was opened, or -1 if there is no such
+  // descriptor whose attributes are younger than CHFS_FD_CACHE_MAX_AGE
+  // seconds (CHFS_STAT_CACHE_MAX_AGE by default, 0 always stats the file
+  // again). A returned descriptor must be released with ReleaseReadFd.
+  int AcquireCachedReadFd(const std::string path, struct stat* st);
+
+  void ReleaseReadFd(const std::string path, int fd);
+
+  // Drops `path` from the handle cache, e.g. because it was overwritten.
+  // Descriptors still in use are closed once they are released.
+  void InvalidateFd(const std::string path);
+
+  // Reads up to `n` bytes at `offset`, retrying short reads until EOF.
+  int64_t PreadFully(int fd, char* buffer, size_t n, off_t offset,
+                     TF_Status* status);
+
+  // Reads `n` bytes at `offset` as preads issued concurrently on
+  // `thread_pool`, split at file offsets which are multiples of
+  // `parallel_read_size`. Returns the number of bytes read, which is only
+  // smaller than `n` at EOF.
+  int64_t ParallelPread(int fd, char* buffer, size_t n, off_t offset,
+                        TF_Status* status);
+
+  // Block fetcher of `block_cache`, served from `disk_cache` if possible.
+  int64_t ReadBlock(const std::string& path, size_t offset, size_t n,
+                    char* buffer, TF_Status* status);
+
+  // Drops the blocks of `path` from `block_cache` and `disk_cache`.
+  void RemoveCachedBlocks(const std::string& path);
+
+  // Hints that `length` bytes (or everything, if negative) at `offset` of
+  // `path` will be read soon. The file is opened and the range fetched into
+  // `block_cache` in the background, by at most CHFS_PREFETCH_CONCURRENCY
+  // workers of `thread_pool` at a time. Errors are ignored.
+  void Prefetch(const std::string path, uint64_t offset, int64_t length);
+
   ~CHFS();
+
+ private:
+  // Descriptors are kept open after their last reader released them, up to
+  // CHFS_FD_CACHE_SIZE idle ones which are evicted in LRU order, so that
+  // reopening a file (e.g. in the next epoch) needs neither an open nor a
+  // stat RPC.
+  typedef std::pair<std::string, int> FdKey;  // path and open flags
+  struct SharedFd {
+    int fd;
+    int refs;
+    // Attributes of the file, valid if `has_stat`, as of `opened`.
+    bool has_stat;
+    struct stat st;
+    uint64_t opened;
+    // Position in `idle_fds_`, valid if `refs` is 0.
+    std::list<FdKey>::iterator idle_iterator;
+  };
+  // Evicts idle descriptors beyond CHFS_FD_CACHE_SIZE, to be closed by the
+  // caller once `read_fds_mu_` is released.
+  void CloseIdleFds(std::vector<int>* to_close)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(read_fds_mu_);
+  void UpdateFdStat(SharedFd* entry, const struct stat* st)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(read_fds_mu_);
+
+  struct PrefetchRequest {
+    std::string path;
+    uint64_t offset;
+    int64_t length;
+  };
+  // Runs queued prefetch requests until there are none left.
+  void RunPrefetches();
+  void PrefetchFile(const PrefetchRequest& request);
+
+  size_t prefetch_concurrency_;
+  absl::Mutex prefetch_mu_;
+  std::deque<PrefetchRequest> prefetch_queue_ ABSL_GUARDED_BY(prefetch_mu_);
+  size_t prefetch_running_ ABSL_GUARDED_BY(prefetch_mu_) = 0;
+  bool prefetch_stopping_ ABSL_GUARDED_BY(prefetch_mu_) = false;
+
+  size_t max_idle_fds_;
+  uint64_t fd_max_age_;
+  absl::Mutex read_fds_mu_;
+  std::map<FdKey, SharedFd> read_fds_ ABSL_GUARDED_BY(read_fds_mu_);
+  // Most recently released first.
+  std::list<FdKey> idle_fds_ ABSL_GUARDED_BY(read_fds_mu_);
+  // Invalidated descriptors that are still in use, with their reference
+  // counts.
+  std::map<int, int> detached_fds_ ABSL_GUARDED_BY(read_fds_mu_);
 };
 
 using Filler =
@@ -63,7 +241,20 @@ using Filler =
 
 class libCHFS {
  public:
-  explicit libCHFS(TF_Status* status) { LoadAndBindCHFSLibs(status); }
+  explicit libCHFS(TF_Status* status, bool new_namespace = false) {
+    LoadAndBindCHFSLibs(new_namespace, status);
+  }
+
+  // Loads `num_contexts` independent instances of libchfs, each in its own
+  // link-map namespace so that each has its own client state, and binds the
+  // functions below to dispatchers over them. Path based calls go to the
+  // context of the calling thread (threads are assigned to contexts round
+  // robin), and descriptors encode the context which opened them. chfs_init
+  // assigns the entries of a comma separated server list to the contexts
+  // round robin. Fewer contexts are used if the system cannot create more
+  // namespaces. Every namespace has its own copy of libc, whose errno is
+  // copied to the caller's after each call.
+  libCHFS(size_t num_contexts, TF_Status* status);
 
   ~libCHFS();
 
@@ -79,20 +270,41 @@ class libCHFS {
   std::function<int(const char*, mode_t)> chfs_mkdir;
   std::function<int(const char*)> chfs_rmdir;
   std::function<int(const char*, struct stat*)> chfs_stat;
+  // Optional, null if the library does not provide it.
+  std::function<int(const char*, const char*)> chfs_rename;
   std::function<int(const char* path, void* buf,
                     int (*)(void*, const char*, const struct stat*, off_t))>
       chfs_readdir;
   // std::function<int(const char*, void*, Filler*)> chfs_reddir;
 
  private:
-  void LoadAndBindCHFSLibs(TF_Status* status);
-  void* libchfs_handle_;
+  void LoadAndBindCHFSLibs(bool new_namespace, TF_Status* status);
+  void BindContexts();
+  libCHFS* ThreadContext(size_t* index);
+  int EncodeFd(int fd, size_t index) const;
+  libCHFS* FdContext(int fd, int* local_fd);
+  // Copies the errno of this context, set by the call which returned `rc`,
+  // to the errno of the caller.
+  int ReturnErrno(int rc) const {
+    if (errno_location_ != nullptr) errno = *errno_location_();
+    return rc;
+  }
+
+  void* libchfs_handle_ = nullptr;
+  // `__errno_location` of the libc loaded with a context in a new namespace,
+  // null for a context sharing the libc of the caller.
+  int* (*errno_location_)() = nullptr;
+  std::vector<std::unique_ptr<libCHFS>> contexts_;
 };
 
 const std::string GetPath(const std::string& string);
 
 const std::string GetParent(const std::string& string);
 
+const std::string JoinPath(const std::string& dir, const std::string& name);
+
 void CopyEntries(char*** entries, std::vector<std::string>& results);
 
+int64_t FileSignature(const struct stat* st);
+
 #endif
@@ -0,0 +1,423 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Micro-benchmarks of the CHFS filesystem plugin, driving its
+// TF_FilesystemPluginOps table directly.
+//
+//   export TF_IO_CHFS_LIBRARY_DIR=<libchfs.so directory> CHFS_SERVER=<server>
+//   chfs_benchmark [--name=value ...]
+//
+// To run without a CHFS deployment, point TF_IO_CHFS_LIBRARY_DIR to the
+// directory of the fake/libchfs.so target and CHFS_SERVER to a local
+// directory. The plugin is configured through its usual environment
+// variables, e.g. CHFS_READ_CACHE_MAX_SIZE_MB=0 measures uncached reads.
+//
+// Flags (defaults in parentheses):
+//   --root          directory the benchmark works in (chfs:///chfs_benchmark)
+//   --benchmarks    comma separated subset of seq_read, rand_read, large_read,
+//                   append, meta and list (all of them)
+//   --threads       concurrent threads (4)
+//   --file_size_mb  size of the file read by each thread (64)
+//   --chunk_kb      request size of seq_read (1024)
+//   --rand_read_kb  request size of rand_read (4)
+//   --large_read_mb request size of large_read (16)
+//   --append_bytes  size of each append (256)
+//   --ops           random reads, appends and create/stat/delete rounds per
+//                   thread (1000)
+//   --list_entries  entries of the directory listed by list (10000)
+//   --list_ops      listings per thread (10)
+//
+// Each benchmark reports its throughput, operations per second and the
+// latency percentiles of single operations.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "tensorflow_io/core/filesystems/filesystem_plugins.h"
+
+namespace tensorflow {
+namespace io {
+namespace chfs {
+namespace {
+
+struct Flags {
+  std::string root = "chfs:///chfs_benchmark";
+  std::string benchmarks = "seq_read,rand_read,large_read,append,meta,list";
+  uint64_t threads = 4;
+  uint64_t file_size_mb = 64;
+  uint64_t chunk_kb = 1024;
+  uint64_t rand_read_kb = 4;
+  uint64_t large_read_mb = 16;
+  uint64_t append_bytes = 256;
+  uint64_t ops = 1000;
+  uint64_t list_entries = 10000;
+  uint64_t list_ops = 10;
+};
+
+bool ParseFlags(int argc, char** argv, Flags* flags) {
+  std::map<std::string, uint64_t*> numbers = {
+      {"threads", &flags->threads},
+      {"file_size_mb", &flags->file_size_mb},
+      {"chunk_kb", &flags->chunk_kb},
+      {"rand_read_kb", &flags->rand_read_kb},
+      {"large_read_mb", &flags->large_read_mb},
+      {"append_bytes", &flags->append_bytes},
+      {"ops", &flags->ops},
+      {"list_entries", &flags->list_entries},
+      {"list_ops", &flags->list_ops},
+  };
+  for (int i = 1; i < argc; i++) {
+    std::vector<std::string> parts =
+        absl::StrSplit(argv[i], absl::MaxSplits('=', 1));
+    if (parts.size() != 2 || parts[0].compare(0, 2, "--") != 0) {
+      fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+      return false;
+    }
+    std::string name = parts[0].substr(2);
+    if (name == "root") {
+      flags->root = parts[1];
+    } else if (name == "benchmarks") {
+      flags->benchmarks = parts[1];
+    } else if (numbers.count(name) == 0 ||
+               !absl::SimpleAtoi(parts[1], numbers[name])) {
+      fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  flags->threads = std::max<uint64_t>(flags->threads, 1);
+  return true;
+}
+
+TF_FilesystemPluginOps ops;
+TF_Filesystem filesystem;
+
+void CheckOk(TF_Status* status, const std::string& what) {
+  if (TF_GetCode(status) == TF_OK) return;
+  fprintf(stderr, "%s: %s\n", what.c_str(), TF_Message(status));
+  std::exit(1);
+}
+
+uint64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Latencies and transferred bytes of the operations of one thread.
+struct Samples {
+  std::vector<uint64_t> latencies;
+  uint64_t bytes = 0;
+
+  // Runs `fn`, which returns the number of bytes it transferred, and records
+  // its latency.
+  void Time(const std::function<uint64_t()>& fn) {
+    uint64_t start = NowNanos();
+    bytes += fn();
+    latencies.push_back(NowNanos() - start);
+  }
+};
+
+void Report(const std::string& name, uint64_t elapsed,
+            std::vector<Samples>& samples) {
+  std::vector<uint64_t> latencies;
+  uint64_t bytes = 0;
+  for (auto& s : samples) {
+    latencies.insert(latencies.end(), s.latencies.begin(), s.latencies.end());
+    bytes += s.bytes;
+  }
+  if (latencies.empty()) return;
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) {
+    size_t i = static_cast<size_t>(p * (latencies.size() - 1));
+    return latencies[i] / 1e3;
+  };
+  double seconds = elapsed / 1e9;
+  char throughput[32] = "-";
+  if (bytes > 0) {
+    snprintf(throughput, sizeof(throughput), "%.1f",
+             bytes / seconds / (1 << 20));
+  }
+  printf("%-12s %8zu %12s %12.1f %10.1f %10.1f %10.1f %10.1f\n",
+         name.c_str(), latencies.size(), throughput,
+         latencies.size() / seconds, percentile(0.5), percentile(0.9),
+         percentile(0.99), latencies.back() / 1e3);
+}
+
+// Runs `fn(thread, samples)` on every thread and reports the result.
+void Run(const std::string& name, const Flags& flags,
+         const std::function<void(size_t, Samples*)>& fn) {
+  std::vector<Samples> samples(flags.threads);
+  std::vector<std::thread> threads;
+  uint64_t start = NowNanos();
+  for (size_t t = 0; t < flags.threads; t++) {
+    threads.emplace_back([&fn, &samples, t]() { fn(t, &samples[t]); });
+  }
+  for (auto& thread : threads) thread.join();
+  Report(name, NowNanos() - start, samples);
+}
+
+std::string ThreadPath(const Flags& flags, const std::string& name,
+                       size_t thread) {
+  return absl::StrCat(flags.root, "/", name, "_", thread);
+}
+
+void WriteFile(const std::string& path, uint64_t size) {
+  TF_Status* status = TF_NewStatus();
+  TF_WritableFile file;
+  ops.filesystem_ops->new_writable_file(&filesystem, path.c_str(), &file,
+                                        status);
+  CheckOk(status, "new_writable_file " + path);
+  std::string buffer(std::min<uint64_t>(size, 1 << 20), 'x');
+  for (uint64_t written = 0; written < size; written += buffer.size()) {
+    size_t n = std::min<uint64_t>(buffer.size(), size - written);
+    ops.writable_file_ops->append(&file, buffer.data(), n, status);
+    CheckOk(status, "append " + path);
+  }
+  ops.writable_file_ops->close(&file, status);
+  CheckOk(status, "close " + path);
+  ops.writable_file_ops->cleanup(&file);
+  TF_DeleteStatus(status);
+}
+
+// Reads `n` bytes at `offset` of `file` and returns the number of bytes read.
+uint64_t ReadAt(TF_RandomAccessFile* file, uint64_t offset, size_t n,
+                char* buffer) {
+  TF_Status* status = TF_NewStatus();
+  int64_t read =
+      ops.random_access_file_ops->read(file, offset, n, buffer, status);
+  if (TF_GetCode(status) != TF_OUT_OF_RANGE) CheckOk(status, "read");
+  TF_DeleteStatus(status);
+  return read > 0 ? read : 0;
+}
+
+// Opens the data file of `thread`, calls `fn` with it and closes it again.
+void WithDataFile(const Flags& flags, size_t thread,
+                  const std::function<void(TF_RandomAccessFile*)>& fn) {
+  TF_Status* status = TF_NewStatus();
+  TF_RandomAccessFile file;
+  std::string path = ThreadPath(flags, "data", thread);
+  ops.filesystem_ops->new_random_access_file(&filesystem, path.c_str(), &file,
+                                             status);
+  CheckOk(status, "new_random_access_file " + path);
+  fn(&file);
+  ops.random_access_file_ops->cleanup(&file);
+  TF_DeleteStatus(status);
+}
+
+void SequentialRead(const Flags& flags, const std::string& name,
+                    uint64_t chunk) {
+  uint64_t file_size = flags.file_size_mb << 20;
+  Run(name, flags, [&](size_t thread, Samples* samples) {
+    std::vector<char> buffer(chunk);
+    WithDataFile(flags, thread, [&](TF_RandomAccessFile* file) {
+      for (uint64_t offset = 0; offset < file_size; offset += chunk) {
+        samples->Time([&]() {
+          return ReadAt(file, offset, buffer.size(), buffer.data());
+        });
+      }
+    });
+  });
+}
+
+void RandomRead(const Flags& flags) {
+  uint64_t file_size = flags.file_size_mb << 20;
+  uint64_t chunk = flags.rand_read_kb << 10;
+  uint64_t blocks = std::max<uint64_t>(file_size / chunk, 1);
+  Run("rand_read", flags, [&](size_t thread, Samples* samples) {
+    std::mt19937_64 random(thread);
+    std::vector<char> buffer(chunk);
+    WithDataFile(flags, thread, [&](TF_RandomAccessFile* file) {
+      for (uint64_t i = 0; i < flags.ops; i++) {
+        uint64_t offset = (random() % blocks) * chunk;
+        samples->Time([&]() {
+          return ReadAt(file, offset, buffer.size(), buffer.data());
+        });
+      }
+    });
+  });
+}
+
+void Append(const Flags& flags) {
+  Run("append", flags, [&](size_t thread, Samples* samples) {
+    TF_Status* status = TF_NewStatus();
+    TF_WritableFile file;
+    std::string path = ThreadPath(flags, "append", thread);
+    ops.filesystem_ops->new_writable_file(&filesystem, path.c_str(), &file,
+                                          status);
+    CheckOk(status, "new_writable_file " + path);
+    std::string record(flags.append_bytes, 'x');
+    for (uint64_t i = 0; i < flags.ops; i++) {
+      samples->Time([&]() {
+        ops.writable_file_ops->append(&file, record.data(), record.size(),
+                                      status);
+        CheckOk(status, "append " + path);
+        return record.size();
+      });
+    }
+    // Buffered appends are only complete once the file is closed.
+    samples->Time([&]() {
+      ops.writable_file_ops->close(&file, status);
+      CheckOk(status, "close " + path);
+      return 0;
+    });
+    ops.writable_file_ops->cleanup(&file);
+    TF_DeleteStatus(status);
+  });
+}
+
+void Metadata(const Flags& flags) {
+  std::vector<Samples> create(flags.threads), stat(flags.threads),
+      remove(flags.threads);
+  std::vector<std::thread> threads;
+  uint64_t start = NowNanos();
+  for (size_t t = 0; t < flags.threads; t++) {
+    threads.emplace_back([&, t]() {
+      TF_Status* status = TF_NewStatus();
+      for (uint64_t i = 0; i < flags.ops; i++) {
+        std::string path = absl::StrCat(ThreadPath(flags, "meta", t), "_", i);
+        create[t].Time([&]() {
+          TF_WritableFile file;
+          ops.filesystem_ops->new_writable_file(&filesystem, path.c_str(),
+                                                &file, status);
+          CheckOk(status, "new_writable_file " + path);
+          ops.writable_file_ops->close(&file, status);
+          CheckOk(status, "close " + path);
+          ops.writable_file_ops->cleanup(&file);
+          return 0;
+        });
+        stat[t].Time([&]() {
+          TF_FileStatistics stats;
+          ops.filesystem_ops->stat(&filesystem, path.c_str(), &stats, status);
+          CheckOk(status, "stat " + path);
+          return 0;
+        });
+        remove[t].Time([&]() {
+          ops.filesystem_ops->delete_file(&filesystem, path.c_str(), status);
+          CheckOk(status, "delete_file " + path);
+          return 0;
+        });
+      }
+      TF_DeleteStatus(status);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  uint64_t elapsed = NowNanos() - start;
+  Report("create", elapsed, create);
+  Report("stat", elapsed, stat);
+  Report("delete", elapsed, remove);
+}
+
+void List(const Flags& flags) {
+  std::string dir = flags.root + "/wide";
+  TF_Status* status = TF_NewStatus();
+  ops.filesystem_ops->create_dir(&filesystem, dir.c_str(), status);
+  CheckOk(status, "create_dir " + dir);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < flags.threads; t++) {
+    threads.emplace_back([&, t]() {
+      for (uint64_t i = t; i < flags.list_entries; i += flags.threads) {
+        WriteFile(absl::StrCat(dir, "/entry_", i), 0);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  Run("list", flags, [&](size_t thread, Samples* samples) {
+    TF_Status* status = TF_NewStatus();
+    for (uint64_t i = 0; i < flags.list_ops; i++) {
+      samples->Time([&]() {
+        char** entries;
+        int n = ops.filesystem_ops->get_children(&filesystem, dir.c_str(),
+                                                 &entries, status);
+        CheckOk(status, "get_children " + dir);
+        for (int j = 0; j < n; j++) plugin_memory_free(entries[j]);
+        plugin_memory_free(entries);
+        return 0;
+      });
+    }
+    TF_DeleteStatus(status);
+  });
+  TF_DeleteStatus(status);
+}
+
+int Main(int argc, char** argv) {
+  Flags flags;
+  if (!ParseFlags(argc, argv, &flags)) return 2;
+  std::vector<std::string> benchmarks = absl::StrSplit(flags.benchmarks, ',');
+  auto enabled = [&benchmarks](const std::string& name) {
+    return std::find(benchmarks.begin(), benchmarks.end(), name) !=
+           benchmarks.end();
+  };
+
+  ProvideFilesystemSupportFor(&ops, "chfs");
+  TF_Status* status = TF_NewStatus();
+  ops.filesystem_ops->init(&filesystem, status);
+  CheckOk(status, "init");
+  ops.filesystem_ops->recursively_create_dir(&filesystem, flags.root.c_str(),
+                                             status);
+  CheckOk(status, "recursively_create_dir " + flags.root);
+
+  if (enabled("seq_read") || enabled("rand_read") || enabled("large_read")) {
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < flags.threads; t++) {
+      threads.emplace_back([&flags, t]() {
+        WriteFile(ThreadPath(flags, "data", t), flags.file_size_mb << 20);
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  }
+
+  printf("%-12s %8s %12s %12s %10s %10s %10s %10s\n", "benchmark", "ops",
+         "MB/s", "IOPS", "p50_us", "p90_us", "p99_us", "max_us");
+  if (enabled("seq_read")) {
+    SequentialRead(flags, "seq_read", flags.chunk_kb << 10);
+  }
+  if (enabled("rand_read")) RandomRead(flags);
+  if (enabled("large_read")) {
+    SequentialRead(flags, "large_read", flags.large_read_mb << 20);
+  }
+  if (enabled("append")) Append(flags);
+  if (enabled("meta")) Metadata(flags);
+  if (enabled("list")) List(flags);
+
+  uint64_t undeleted_files, undeleted_dirs;
+  ops.filesystem_ops->delete_recursively(&filesystem, flags.root.c_str(),
+                                         &undeleted_files, &undeleted_dirs,
+                                         status);
+  CheckOk(status, "delete_recursively " + flags.root);
+  ops.filesystem_ops->cleanup(&filesystem);
+  TF_DeleteStatus(status);
+  return 0;
+}
+
+}  // namespace
+}  // namespace chfs
+}  // namespace io
+}  // namespace tensorflow
+
+int main(int argc, char** argv) {
+  return tensorflow::io::chfs::Main(argc, argv);
+}
@@ -3,6 +3,9 @@
 #include <cassert>
 #include <iostream>
 
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+
 namespace tensorflow {
 namespace io {
 namespace chfs {
@@ -16,38 +19,60 @@ typedef struct CHFSRandomAccessFile {
   size_t file_size;
   int fd;
 
-  CHFSRandomAccessFile(CHFS* chfs, std::string path, int fd)
-      : chfs(chfs), fd(fd) {
-    path = GetPath(path);
-    std::shared_ptr<struct stat> st(
-        static_cast<struct stat*>(
-            tensorflow::io::plugin_memory_allocate(sizeof(struct stat))),
-        tensorflow::io::plugin_memory_free);
-    chfs->libchfs->chfs_stat(path.c_str(), st.get());
-    file_size = static_cast<size_t>(st->st_size);
-  }
+  // Sequential access detection for read-ahead. The window doubles on every
+  // read which starts where the previous one ended, up to
+  // `chfs->read_ahead_max`, and collapses on a random access.
+  absl::Mutex mu;
+  size_t next_offset ABSL_GUARDED_BY(mu);
+  size_t read_ahead ABSL_GUARDED_BY(mu);
+
+  CHFSRandomAccessFile(CHFS* chfs, std::string path, int fd, size_t file_size)
+      : chfs(chfs),
+        path(GetPath(path)),
+        file_size(file_size),
+        fd(fd),
+        next_offset(0),
+        read_ahead(0) {}
 
   int64_t Read(uint64_t offset, size_t n, char* buffer, TF_Status* status) {
-    ssize_t read_size;
-
-    read_size = chfs->libchfs->chfs_pread(fd, buffer, n, offset);
-    if (read_size < 0) {
-      TF_SetStatus(status, TF_INTERNAL, "Error reading");
-      return read_size;
+    // Large reads are striped over the servers instead of going through the
+    // cache block by block.
+    if (n >= chfs->parallel_read_threshold) {
+      return chfs->ParallelPread(fd, buffer, n, offset, status);
     }
-
-    if (static_cast<size_t>(read_size) != n) {
-      TF_SetStatus(status, TF_OUT_OF_RANGE, "");
-      return read_size;
+    if (!chfs->block_cache->IsCacheEnabled()) {
+      return chfs->PreadFully(fd, buffer, n, offset, status);
     }
-
-    TF_SetStatus(status, TF_OK, "");
+    int64_t read_size =
+        chfs->block_cache->Read(path, offset, n, buffer, status);
+    if (read_size > 0) MaybeReadAhead(offset, read_size);
     return read_size;
   }
+
+  void MaybeReadAhead(uint64_t offset, size_t read_size) {
+    size_t block_size = chfs->block_cache->block_size();
+    size_t window;
+    {
+      absl::MutexLock l(&mu);
+      if (offset == next_offset) {
+        read_ahead = std::min(std::max(read_ahead * 2, block_size),
+                              chfs->read_ahead_max);
+      } else {
+        read_ahead = 0;
+      }
+      next_offset = offset + read_size;
+      window = read_ahead;
+    }
+    size_t start = offset + read_size;
+    if (window == 0 || start >= file_size) return;
+    chfs->block_cache->Prefetch(path, start,
+                                std::min(window, file_size - start));
+  }
 } CHFSRandomAccessFile;
 
 void Cleanup(TF_RandomAccessFile* file) {
   auto chfs_file = static_cast<CHFSRandomAccessFile*>(file->plugin_file);
+  chfs_file->chfs->ReleaseReadFd(chfs_file->path, chfs_file->fd);
   chfs_file->chfs = nullptr;
   delete chfs_file;
 }
@@ -55,120 +80,168 @@ void Cleanup(TF_RandomAccessFile* file) {
 int64_t Read(const TF_RandomAccessFile* file, uint64_t offset, size_t n,
              char* ret, TF_Status* status) {
   auto chfs_file = static_cast<CHFSRandomAccessFile*>(file->plugin_file);
-  if (offset > chfs_file->file_size) {
-    TF_SetStatus(status, TF_OUT_OF_RANGE, "");
-    return -1;
+  if (offset >= chfs_file->file_size) {
+    TF_SetStatus(status, TF_OUT_OF_RANGE, "Read past the end of file");
+    return 0;
   }
 
-  size_t ret_offset = 0;
-  size_t cur_offset = offset;
-  int64_t total_bytes = 0;
-  while (cur_offset < chfs_file->file_size) {
-    int64_t read_bytes = 0;
-
-    read_bytes = chfs_file->Read(cur_offset, n + ret_offset, ret, status);
-    if (read_bytes > 0) {
-      ret_offset += read_bytes;
-      cur_offset += read_bytes;
-      total_bytes += read_bytes;
-      n -= read_bytes;
-      continue;
-    }
+  int64_t read_bytes = chfs_file->Read(offset, n, ret, status);
+  if (TF_GetCode(status) != TF_OK) return read_bytes;
+  if (static_cast<size_t>(read_bytes) < n) {
+    TF_SetStatus(status, TF_OUT_OF_RANGE, "Read less bytes than requested");
   }
-  return total_bytes;
+  return read_bytes;
 }
 }  // namespace tf_random_access_file
 
 // Implementation for `TF_WritableFile`
 //
 namespace tf_writable_file {
+// Appends are collected in `buffer` and, once it reaches
+// `chfs->write_buffer_size`, handed to the filesystem thread pool as a pwrite
+// at the next file offset. Several pwrites may be in flight at once; Append
+// only blocks while more than `chfs->write_max_pending` bytes are pending.
+// Flush/Sync/Close drain the pending writes and report the first error.
 typedef struct CHFSWritableFile {
   CHFS* chfs;
   std::string path;
   int fd;
-  size_t file_size;
-  bool size_known;
+  // Offset of the first byte of `buffer` in the file.
+  size_t offset;
+  std::string buffer;
+
+  absl::Mutex mu;
+  size_t pending_bytes ABSL_GUARDED_BY(mu);
+  TF_Code error_code ABSL_GUARDED_BY(mu);
+  std::string error_message ABSL_GUARDED_BY(mu);
+
+  CHFSWritableFile(CHFS* chfs, std::string path, int fd, bool append,
+                   TF_Status* status)
+      : chfs(chfs),
+        path(GetPath(path)),
+        fd(fd),
+        offset(0),
+        pending_bytes(0),
+        error_code(TF_OK) {
+    // A new writable file starts out empty.
+    if (!append) return;
+    std::shared_ptr<struct stat> st(
+        static_cast<struct stat*>(
+            tensorflow::io::plugin_memory_allocate(sizeof(struct stat))),
+        tensorflow::io::plugin_memory_free);
+    if (chfs->libchfs->chfs_stat(this->path.c_str(), st.get()) != 0) {
+      chfs->libchfs->chfs_close(fd);
+      TF_SetStatus(status, TF_INTERNAL, "Cannot determine file size");
+      return;
+    }
+    offset = static_cast<size_t>(st->st_size);
+  }
+
+  void SetError(TF_Code code, const char* message)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu) {
+    if (error_code != TF_OK) return;
+    error_code = code;
+    error_message = message;
+  }
 
-  CHFSWritableFile(CHFS* chfs, std::string path, int fd) : chfs(chfs), fd(fd) {
-    path = GetPath(path);
-    size_known = false;
-    size_t dummy;
-    get_file_size(dummy);
+  bool GetError(TF_Status* status) ABSL_LOCKS_EXCLUDED(mu) {
+    absl::MutexLock l(&mu);
+    TF_SetStatus(status, error_code, error_message.c_str());
+    return error_code != TF_OK;
   }
 
-  int get_file_size(size_t& size) {
-    int rc;
-
-    if (!size_known) {
-      std::shared_ptr<struct stat> st(
-          static_cast<struct stat*>(
-              tensorflow::io::plugin_memory_allocate(sizeof(struct stat))),
-          tensorflow::io::plugin_memory_free);
-      rc = chfs->libchfs->chfs_stat(path.c_str(), st.get());
-      if (rc) {
-        return rc;
+  // Hands `buffer` over to the thread pool, then waits until at most
+  // `max_pending` bytes are still in flight.
+  void Submit(size_t max_pending) ABSL_LOCKS_EXCLUDED(mu) {
+    if (!buffer.empty()) {
+      auto data = std::make_shared<std::string>();
+      data->swap(buffer);
+      size_t write_offset = offset;
+      offset += data->size();
+      {
+        absl::MutexLock l(&mu);
+        pending_bytes += data->size();
       }
-      file_size = static_cast<size_t>(st->st_size);
-      size_known = true;
+      chfs->thread_pool->Schedule([this, data, write_offset]() {
+        ssize_t written_bytes = 0;
+        const char* error = nullptr;
+        while (static_cast<size_t>(written_bytes) < data->size()) {
+          ssize_t rc = chfs->libchfs->chfs_pwrite(
+              fd, data->data() + written_bytes, data->size() - written_bytes,
+              write_offset + written_bytes);
+          if (rc <= 0) {
+            error = rc < 0 ? strerror(errno) : "Short write";
+            break;
+          }
+          written_bytes += rc;
+        }
+        absl::MutexLock l(&mu);
+        if (error != nullptr) SetError(TF_RESOURCE_EXHAUSTED, error);
+        pending_bytes -= data->size();
+      });
     }
-    size = file_size;
-    return 0;
+    absl::MutexLock l(&mu);
+    auto drained = [this, max_pending]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu) {
+      return pending_bytes <= max_pending;
+    };
+    mu.Await(absl::Condition(&drained));
   }
 
-  void set_file_size(size_t size) {
-    file_size = size;
-    size_known = true;
+  void Flush(TF_Status* status) {
+    Submit(0);
+    chfs->RemoveCachedBlocks(path);
+    chfs->InvalidateStat(path);
+    chfs->InvalidateFd(path);
+    GetError(status);
   }
-
-  void unset_file_size() { size_known = false; }
 } CHFSWritableFile;
 
 void Cleanup(TF_WritableFile* file) {
   auto chfs_file = static_cast<CHFSWritableFile*>(file->plugin_file);
+  // Never leave writes referring to this file behind.
+  chfs_file->Submit(0);
   chfs_file->chfs = nullptr;
   delete chfs_file;
 }
 
 void Append(const TF_WritableFile* file, const char* buffer, size_t n,
             TF_Status* status) {
-  int rc;
-  ssize_t written_bytes;
-  size_t cur_file_size;
   auto chfs_file = static_cast<CHFSWritableFile*>(file->plugin_file);
+  if (chfs_file->GetError(status)) return;
 
-  rc = chfs_file->get_file_size(cur_file_size);
-  if (rc != 0) {
-    TF_SetStatus(status, TF_INTERNAL, "Cannot determine file size");
-    return;
+  chfs_file->buffer.append(buffer, n);
+  if (chfs_file->buffer.size() >= chfs_file->chfs->write_buffer_size) {
+    chfs_file->Submit(chfs_file->chfs->write_max_pending);
+    chfs_file->GetError(status);
   }
+}
 
-  written_bytes = chfs_file->chfs->libchfs->chfs_pwrite(chfs_file->fd, buffer,
-                                                        n, cur_file_size);
-  if (written_bytes < 0) {
-    TF_SetStatus(status, TF_RESOURCE_EXHAUSTED, strerror(errno));
-    chfs_file->unset_file_size();
-    return;
-  }
+int64_t Tell(const TF_WritableFile* file, TF_Status* status) {
+  auto chfs_file = static_cast<CHFSWritableFile*>(file->plugin_file);
 
-  chfs_file->set_file_size(cur_file_size + written_bytes);
   TF_SetStatus(status, TF_OK, "");
+  return chfs_file->offset + chfs_file->buffer.size();
 }
 
-int64_t Tell(const TF_WritableFile* file, TF_Status* status) {
-  off_t cur_position;
+void Flush(const TF_WritableFile* file, TF_Status* status) {
   auto chfs_file = static_cast<CHFSWritableFile*>(file->plugin_file);
+  chfs_file->Flush(status);
+}
 
-  cur_position =
-      chfs_file->chfs->libchfs->chfs_seek(chfs_file->fd, 0, SEEK_CUR);
-
-  TF_SetStatus(status, TF_OK, "");
-  return cur_position;
+void Sync(const TF_WritableFile* file, TF_Status* status) {
+  auto chfs_file = static_cast<CHFSWritableFile*>(file->plugin_file);
+  chfs_file->Flush(status);
 }
 
 void Close(const TF_WritableFile* file, TF_Status* status) {
-  TF_SetStatus(status, TF_OK, "");
   auto chfs_file = static_cast<CHFSWritableFile*>(file->plugin_file);
-  chfs_file->chfs->Close(chfs_file->fd, status);
+  chfs_file->Flush(status);
+  TF_Status* close_status = TF_NewStatus();
+  chfs_file->chfs->Close(chfs_file->fd, close_status);
+  if (TF_GetCode(status) == TF_OK) {
+    TF_SetStatus(status, TF_GetCode(close_status), TF_Message(close_status));
+  }
+  TF_DeleteStatus(close_status);
 }
 
 }  // namespace tf_writable_file
@@ -176,11 +249,26 @@ void Close(const TF_WritableFile* file, TF_Status* status) {
 // Implementation for `TF_ReadOnlyMemoryRegion`
 //
 namespace tf_read_only_memory_region {
-void Cleanup(TF_ReadOnlyMemoryRegion* region) {}
+typedef struct CHFSReadOnlyMemoryRegion {
+  const void* const address;
+  const uint64_t length;
+} CHFSReadOnlyMemoryRegion;
+
+void Cleanup(TF_ReadOnlyMemoryRegion* region) {
+  auto r = static_cast<CHFSReadOnlyMemoryRegion*>(region->plugin_memory_region);
+  plugin_memory_free(const_cast<void*>(r->address));
+  delete r;
+}
 
-const void* Data(const TF_ReadOnlyMemoryRegion* region) { return nullptr; }
+const void* Data(const TF_ReadOnlyMemoryRegion* region) {
+  auto r = static_cast<CHFSReadOnlyMemoryRegion*>(region->plugin_memory_region);
+  return r->address;
+}
 
-uint64_t Length(const TF_ReadOnlyMemoryRegion* region) { return 0; }
+uint64_t Length(const TF_ReadOnlyMemoryRegion* region) {
+  auto r = static_cast<CHFSReadOnlyMemoryRegion*>(region->plugin_memory_region);
+  return r->length;
+}
 }  // namespace tf_read_only_memory_region
 
 // Implementation for `TF_Filesystem`
@@ -205,12 +293,16 @@ void Init(TF_Filesystem* filesystem, TF_Status* status) {
 
 void Cleanup(TF_Filesystem* filesystem) {
   auto chfs = static_cast<CHFS*>(filesystem->plugin_filesystem);
+  // Cleanup may run both from TensorFlow and from the atexit handler.
+  filesystem->plugin_filesystem = nullptr;
+  // TensorFlow may clean up the filesystem before the atexit handler runs.
+  if (chfs_filesystem == filesystem) chfs_filesystem = nullptr;
   delete chfs;
 }
 
 void atexit_handler(void) {
   // terminate chfs_filesystem
-  Cleanup(chfs_filesystem);
+  if (chfs_filesystem != nullptr) Cleanup(chfs_filesystem);
 }
 
 void NewWritableFile(const TF_Filesystem* filesystem, const char* path,
@@ -223,7 +315,13 @@ void NewWritableFile(const TF_Filesystem* filesystem, const char* path,
   fd = chfs->NewFile(path, WRITE, flags, status);
   if (TF_GetCode(status) != TF_OK) return;
 
-  file->plugin_file = new tf_writable_file::CHFSWritableFile(chfs, path, fd);
+  auto chfs_file =
+      new tf_writable_file::CHFSWritableFile(chfs, path, fd, false, status);
+  if (TF_GetCode(status) != TF_OK) {
+    delete chfs_file;
+    return;
+  }
+  file->plugin_file = chfs_file;
 }
 
 void NewRandomAccessFile(const TF_Filesystem* filesystem, const char* path,
@@ -231,13 +329,14 @@ void NewRandomAccessFile(const TF_Filesystem* filesystem, const char* path,
   TF_SetStatus(status, TF_OK, "");
   auto chfs = static_cast<CHFS*>(filesystem->plugin_filesystem);
   int32_t flags = S_IRUSR | S_IFREG;
+  struct stat st;
   int fd;
 
-  fd = chfs->NewFile(path, READ, flags, status);
+  fd = chfs->NewFile(path, READ, flags, status, &st);
   if (TF_GetCode(status) != TF_OK) return;
 
-  file->plugin_file =
-      new tf_random_access_file::CHFSRandomAccessFile(chfs, path, fd);
+  file->plugin_file = new tf_random_access_file::CHFSRandomAccessFile(
+      chfs, path, fd, static_cast<size_t>(st.st_size));
 }
 
 void NewAppendableFile(const TF_Filesystem* filesystem, const char* path,
@@ -250,7 +349,60 @@ void NewAppendableFile(const TF_Filesystem* filesystem, const char* path,
   fd = chfs->NewFile(path, APPEND, flags, status);
   if (TF_GetCode(status) != TF_OK) return;
 
-  file->plugin_file = new tf_writable_file::CHFSWritableFile(chfs, path, fd);
+  auto chfs_file =
+      new tf_writable_file::CHFSWritableFile(chfs, path, fd, true, status);
+  if (TF_GetCode(status) != TF_OK) {
+    delete chfs_file;
+    return;
+  }
+  file->plugin_file = chfs_file;
+}
+
+// The whole file is pulled into one contiguous buffer with concurrent preads,
+// bypassing the block cache so that large model files do not evict it.
+void NewReadOnlyMemoryRegionFromFile(const TF_Filesystem* filesystem,
+                                     const char* path,
+                                     TF_ReadOnlyMemoryRegion* region,
+                                     TF_Status* status) {
+  TF_SetStatus(status, TF_OK, "");
+  auto chfs = static_cast<CHFS*>(filesystem->plugin_filesystem);
+  int32_t flags = S_IRUSR | S_IFREG;
+  struct stat st;
+  int fd;
+
+  fd = chfs->NewFile(path, READ, flags, status, &st);
+  if (TF_GetCode(status) != TF_OK) return;
+
+  const std::string cpath = GetPath(path);
+  size_t file_size = static_cast<size_t>(st.st_size);
+  if (file_size == 0) {
+    chfs->ReleaseReadFd(cpath, fd);
+    TF_SetStatus(status, TF_INVALID_ARGUMENT, "File is empty");
+    return;
+  }
+
+  char* buffer = static_cast<char*>(plugin_memory_allocate(file_size));
+  if (buffer == nullptr) {
+    chfs->ReleaseReadFd(cpath, fd);
+    TF_SetStatus(status, TF_RESOURCE_EXHAUSTED,
+                 "Cannot allocate memory region");
+    return;
+  }
+  int64_t read = chfs->ParallelPread(fd, buffer, file_size, 0, status);
+  chfs->ReleaseReadFd(cpath, fd);
+  if (TF_GetCode(status) != TF_OK) {
+    plugin_memory_free(buffer);
+    return;
+  }
+  if (static_cast<size_t>(read) != file_size) {
+    plugin_memory_free(buffer);
+    TF_SetStatus(status, TF_DATA_LOSS, "File changed while being read");
+    return;
+  }
+
+  region->plugin_memory_region =
+      new tf_read_only_memory_region::CHFSReadOnlyMemoryRegion(
+          {buffer, static_cast<uint64_t>(read)});
 }
 
 static void CreateDir(const TF_Filesystem* filesystem, const char* path,
@@ -263,7 +415,9 @@ static void CreateDir(const TF_Filesystem* filesystem, const char* path,
 
 static void RecursivelyCreateDir(const TF_Filesystem* filesystem,
                                  const char* path, TF_Status* status) {
-  // unimplemented
+  auto chfs = static_cast<CHFS*>(filesystem->plugin_filesystem);
+
+  chfs->RecursivelyCreateDir(path, status);
 }
 
 static void DeleteFile(const TF_Filesystem* filesystem, const char* path,
@@ -287,12 +441,24 @@ static void DeleteDir(const TF_Filesystem* filesystem, const char* path,
 static void DeleteRecursively(const TF_Filesystem* filesystem, const char* path,
                               uint64_t* undeleted_files,
                               uint64_t* undeleted_dirs, TF_Status* status) {
-  // unimplemented
+  auto chfs = static_cast<CHFS*>(filesystem->plugin_filesystem);
+
+  chfs->DeleteRecursively(path, undeleted_files, undeleted_dirs, status);
 }
 
 static void RenameFile(const TF_Filesystem* filesystem, const char* src,
                        const char* dst, TF_Status* status) {
-  // unimplemented
+  auto chfs = static_cast<CHFS*>(filesystem->plugin_filesystem);
+
+  chfs->Rename(src, dst, status);
+}
+
+static void CopyFile(const TF_Filesystem* filesystem, const char* src,
+                     const char* dst, TF_Status* status) {
+  TF_SetStatus(status, TF_OK, "");
+  auto chfs = static_cast<CHFS*>(filesystem->plugin_filesystem);
+
+  chfs->CopyFile(src, dst, status);
 }
 
 static void PathExists(const TF_Filesystem* filesystem, const char* path,
@@ -454,8 +620,82 @@ static int GetChildren(const TF_Filesystem* filesystem, const char* path,
   return nr;
 }
 
+static int GetMatchingPaths(const TF_Filesystem* filesystem, const char* glob,
+                            char*** entries, TF_Status* status) {
+  TF_SetStatus(status, TF_OK, "");
+  auto chfs = static_cast<CHFS*>(filesystem->plugin_filesystem);
+
+  // Results carry the same scheme and authority as the pattern.
+  std::string pattern(glob);
+  std::string scheme;
+  auto pos = pattern.find("://");
+  if (pos != std::string::npos) scheme = pattern.substr(0, pos + 3);
+
+  std::vector<std::string> results;
+  chfs->Glob(pattern, results);
+  std::sort(results.begin(), results.end());
+
+  *entries = static_cast<char**>(
+      plugin_memory_allocate(results.size() * sizeof((*entries)[0])));
+  for (size_t i = 0; i < results.size(); i++) {
+    std::string entry = scheme + results[i];
+    (*entries)[i] =
+        static_cast<char*>(plugin_memory_allocate(entry.size() + 1));
+    memcpy((*entries)[i], entry.c_str(), entry.size() + 1);
+  }
+  return results.size();
+}
+
+// The "prefetch" option hints that files will be read soon. Each of its
+// values is "<offset>:<length>:<path>", a negative length meaning the rest of
+// the file.
+static void SetConfiguration(const TF_Filesystem* filesystem,
+                             const TF_Filesystem_Option* options,
+                             int num_options, TF_Status* status) {
+  auto chfs = static_cast<CHFS*>(filesystem->plugin_filesystem);
+  for (int i = 0; i < num_options; i++) {
+    std::string name = options[i].name;
+    if (name != "prefetch") {
+      std::string message = absl::StrCat(
+          "SetConfiguration not implemented for chfs ('chfs://') file system: "
+          "name = ",
+          name);
+      TF_SetStatus(status, TF_UNIMPLEMENTED, message.c_str());
+      return;
+    }
+    if (options[i].value->type_tag != TF_Filesystem_Option_Type_Buffer) {
+      TF_SetStatus(status, TF_INVALID_ARGUMENT,
+                   "SetConfiguration only support buffer type values for chfs "
+                   "('chfs://') file system");
+      return;
+    }
+    for (int j = 0; j < options[i].value->num_values; j++) {
+      std::string value(options[i].value->values[j].buffer_val.buf,
+                        options[i].value->values[j].buffer_val.buf_length);
+      std::vector<std::string> parts =
+          absl::StrSplit(value, absl::MaxSplits(':', 2));
+      uint64_t offset;
+      int64_t length;
+      if (parts.size() != 3 || !absl::SimpleAtoi(parts[0], &offset) ||
+          !absl::SimpleAtoi(parts[1], &length)) {
+        std::string message =
+            absl::StrCat("Invalid prefetch value: ", value,
+                         ", expected <offset>:<length>:<path>");
+        TF_SetStatus(status, TF_INVALID_ARGUMENT, message.c_str());
+        return;
+      }
+      chfs->Prefetch(parts[2], offset, length);
+    }
+  }
+  TF_SetStatus(status, TF_OK, "");
+}
+
 }  // namespace tf_chfs_filesystem
 
+TF_Filesystem* GetInitializedFilesystem() {
+  return tf_chfs_filesystem::chfs_filesystem;
+}
+
 void ProvideFilesystemSupportFor(TF_FilesystemPluginOps* ops, const char* uri) {
   TF_SetFilesystemVersionMetadata(ops);
   ops->scheme = strdup(uri);
@@ -470,6 +710,8 @@ void ProvideFilesystemSupportFor(TF_FilesystemPluginOps* ops, const char* uri) {
   ops->writable_file_ops->cleanup = tf_writable_file::Cleanup;
   ops->writable_file_ops->append = tf_writable_file::Append;
   ops->writable_file_ops->tell = tf_writable_file::Tell;
+  ops->writable_file_ops->flush = tf_writable_file::Flush;
+  ops->writable_file_ops->sync = tf_writable_file::Sync;
   ops->writable_file_ops->close = tf_writable_file::Close;
 
   ops->read_only_memory_region_ops = static_cast<TF_ReadOnlyMemoryRegionOps*>(
@@ -488,20 +730,27 @@ void ProvideFilesystemSupportFor(TF_FilesystemPluginOps* ops, const char* uri) {
   ops->filesystem_ops->new_writable_file = tf_chfs_filesystem::NewWritableFile;
   ops->filesystem_ops->new_appendable_file =
       tf_chfs_filesystem::NewAppendableFile;
+  ops->filesystem_ops->new_read_only_memory_region_from_file =
+      tf_chfs_filesystem::NewReadOnlyMemoryRegionFromFile;
   ops->filesystem_ops->path_exists = tf_chfs_filesystem::PathExists;
   ops->filesystem_ops->create_dir = tf_chfs_filesystem::CreateDir;
   ops->filesystem_ops->delete_dir = tf_chfs_filesystem::DeleteDir;
-  // ops->filesystem_ops->recursively_create_dir =
-  // tf_chfs_filesystem::RecursivelyCreateDir;
+  ops->filesystem_ops->recursively_create_dir =
+      tf_chfs_filesystem::RecursivelyCreateDir;
   ops->filesystem_ops->is_directory = tf_chfs_filesystem::IsDir;
-  // ops->filesystem_ops->delete_recursively =
-  // tf_chfs_filesystem::DeleteRecursively;
+  ops->filesystem_ops->delete_recursively =
+      tf_chfs_filesystem::DeleteRecursively;
   ops->filesystem_ops->get_file_size = tf_chfs_filesystem::GetFileSize;
   ops->filesystem_ops->delete_file = tf_chfs_filesystem::DeleteFile;
   ops->filesystem_ops->rename_file = tf_chfs_filesystem::RenameFile;
+  ops->filesystem_ops->copy_file = tf_chfs_filesystem::CopyFile;
   ops->filesystem_ops->stat = tf_chfs_filesystem::Stat;
   ops->filesystem_ops->get_children = tf_chfs_filesystem::GetChildren;
+  ops->filesystem_ops->get_matching_paths =
+      tf_chfs_filesystem::GetMatchingPaths;
   ops->filesystem_ops->translate_name = tf_chfs_filesystem::TranslateName;
+  ops->filesystem_ops->set_filesystem_configuration =
+      tf_chfs_filesystem::SetConfiguration;
 }
 
 }  // namespace chfs
@@ -0,0 +1,130 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// A stand-in for libchfs which maps the CHFS client API onto a local
+// directory, so that the plugin can be exercised and benchmarked without a
+// CHFS deployment. The directory is the server string passed to chfs_init
+// (i.e. CHFS_SERVER), or /tmp/chfs_fake if it is empty. CHFS_FAKE_LATENCY_US
+// adds a fixed delay to every call to emulate the round trip to a server.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::string root = "/tmp/chfs_fake";
+std::chrono::microseconds latency(0);
+
+std::string LocalPath(const char* path) {
+  std::string p(path);
+  if (p.empty() || p[0] != '/') p.insert(0, "/");
+  return root + p;
+}
+
+void Delay() {
+  if (latency.count() > 0) std::this_thread::sleep_for(latency);
+}
+
+}  // namespace
+
+extern "C" {
+
+int chfs_init(const char* server) {
+  if (server != nullptr && server[0] != '\0') root = server;
+  const char* env = std::getenv("CHFS_FAKE_LATENCY_US");
+  if (env != nullptr) latency = std::chrono::microseconds(std::atol(env));
+  mkdir(root.c_str(), 0755);
+  return 0;
+}
+
+int chfs_term() { return 0; }
+
+int chfs_create(const char* path, int32_t flags, mode_t mode) {
+  Delay();
+  return open(LocalPath(path).c_str(), flags | O_CREAT | O_TRUNC, 0644);
+}
+
+int chfs_open(const char* path, int32_t flags) {
+  Delay();
+  return open(LocalPath(path).c_str(), flags);
+}
+
+int chfs_close(int fd) { return close(fd); }
+
+ssize_t chfs_pread(int fd, void* buf, size_t size, off_t offset) {
+  Delay();
+  return pread(fd, buf, size, offset);
+}
+
+ssize_t chfs_pwrite(int fd, const void* buf, size_t size, off_t offset) {
+  Delay();
+  return pwrite(fd, buf, size, offset);
+}
+
+off_t chfs_seek(int fd, off_t offset, int whence) {
+  return lseek(fd, offset, whence);
+}
+
+int chfs_unlink(const char* path) {
+  Delay();
+  return unlink(LocalPath(path).c_str());
+}
+
+int chfs_mkdir(const char* path, mode_t mode) {
+  Delay();
+  return mkdir(LocalPath(path).c_str(), 0755);
+}
+
+int chfs_rmdir(const char* path) {
+  Delay();
+  return rmdir(LocalPath(path).c_str());
+}
+
+int chfs_stat(const char* path, struct stat* st) {
+  Delay();
+  return stat(LocalPath(path).c_str(), st);
+}
+
+int chfs_rename(const char* src, const char* dst) {
+  Delay();
+  return rename(LocalPath(src).c_str(), LocalPath(dst).c_str());
+}
+
+int chfs_readdir(const char* path, void* buf,
+                 int (*filler)(void*, const char*, const struct stat*,
+                               off_t)) {
+  Delay();
+  std::string dir = LocalPath(path);
+  DIR* d = opendir(dir.c_str());
+  if (d == nullptr) return -1;
+  struct dirent* entry;
+  while ((entry = readdir(d)) != nullptr) {
+    struct stat st;
+    if (stat((dir + "/" + entry->d_name).c_str(), &st) != 0) continue;
+    if (filler(buf, entry->d_name, &st, 0) != 0) break;
+  }
+  closedir(d);
+  return 0;
+}
+
+}  // extern "C"
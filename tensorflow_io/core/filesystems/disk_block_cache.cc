@@ -0,0 +1,243 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_io/core/filesystems/disk_block_cache.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <tuple>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+
+namespace tensorflow {
+namespace io {
+namespace {
+
+constexpr char kTempPrefix[] = ".tmp-";
+
+// FNV-1a, which unlike std::hash is guaranteed to be stable across builds,
+// so that block files outlive the process which wrote them.
+uint64_t Fingerprint(const std::string& s) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : s) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool ReadFully(int fd, char* buffer, size_t n, off_t offset) {
+  while (n > 0) {
+    ssize_t rc = pread(fd, buffer, n, offset);
+    if (rc <= 0) return false;
+    buffer += rc;
+    n -= rc;
+    offset += rc;
+  }
+  return true;
+}
+
+bool WriteFully(int fd, const char* data, size_t n) {
+  while (n > 0) {
+    ssize_t rc = write(fd, data, n);
+    if (rc <= 0) return false;
+    data += rc;
+    n -= rc;
+  }
+  return true;
+}
+
+}  // namespace
+
+DiskBlockCache::DiskBlockCache(const std::string& directory,
+                               uint64_t max_bytes)
+    : directory_(directory), max_bytes_(max_bytes), enabled_(false) {
+  if (directory_.empty() || max_bytes_ == 0) return;
+  std::error_code ec;
+  std::filesystem::create_directories(directory_, ec);
+  if (ec) return;
+
+  std::vector<std::tuple<std::filesystem::file_time_type, std::string,
+                         uint64_t>>
+      blocks;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(directory_, ec)) {
+    if (!entry.is_regular_file(ec)) continue;
+    std::string name = entry.path().filename().string();
+    if (absl::StartsWith(name, kTempPrefix)) {
+      std::filesystem::remove(entry.path(), ec);
+      continue;
+    }
+    blocks.emplace_back(entry.last_write_time(ec), name, entry.file_size(ec));
+  }
+  if (ec) return;
+  std::sort(blocks.begin(), blocks.end());
+
+  absl::MutexLock l(&mu_);
+  for (const auto& block : blocks) {
+    AddEntry(std::get<1>(block), std::get<2>(block));
+  }
+  while (cache_size_ > max_bytes_) {
+    RemoveEntry(entries_.find(lru_list_.back()));
+  }
+  enabled_ = true;
+}
+
+std::string DiskBlockCache::FilePrefix(const std::string& filename) {
+  return absl::StrCat(absl::Hex(Fingerprint(filename), absl::kZeroPad16), "-");
+}
+
+std::string DiskBlockCache::SignaturePrefix(const std::string& filename) {
+  return absl::StrCat(FilePrefix(filename),
+                      absl::Hex(static_cast<uint64_t>(signatures_[filename])),
+                      "-");
+}
+
+std::string DiskBlockCache::BlockName(const std::string& filename,
+                                      size_t offset) {
+  return absl::StrCat(SignaturePrefix(filename), offset);
+}
+
+void DiskBlockCache::AddEntry(const std::string& name, uint64_t size) {
+  lru_list_.push_front(name);
+  entries_[name] = Entry{size, lru_list_.begin()};
+  cache_size_ += size;
+}
+
+void DiskBlockCache::RemoveEntry(std::map<std::string, Entry>::iterator entry) {
+  unlink(absl::StrCat(directory_, "/", entry->first).c_str());
+  cache_size_ -= entry->second.size;
+  lru_list_.erase(entry->second.lru_iterator);
+  entries_.erase(entry);
+}
+
+void DiskBlockCache::ValidateAndUpdateFileSignature(
+    const std::string& filename, int64_t signature) {
+  if (!enabled_) return;
+  absl::MutexLock l(&mu_);
+  auto it = signatures_.find(filename);
+  if (it != signatures_.end() && it->second == signature) return;
+  signatures_[filename] = signature;
+
+  // Blocks of other versions of the file, possibly from a previous run, can
+  // not be hit anymore.
+  const std::string prefix = FilePrefix(filename);
+  const std::string current_prefix = SignaturePrefix(filename);
+  auto entry = entries_.lower_bound(prefix);
+  while (entry != entries_.end() && absl::StartsWith(entry->first, prefix)) {
+    if (absl::StartsWith(entry->first, current_prefix)) {
+      ++entry;
+    } else {
+      RemoveEntry(entry++);
+    }
+  }
+}
+
+int64_t DiskBlockCache::Lookup(const std::string& filename, size_t offset,
+                               size_t n, char* buffer) {
+  if (!enabled_) return -1;
+  std::string name;
+  {
+    absl::MutexLock l(&mu_);
+    if (signatures_.find(filename) == signatures_.end()) return -1;
+    name = BlockName(filename, offset);
+    auto entry = entries_.find(name);
+    if (entry == entries_.end()) return -1;
+    lru_list_.erase(entry->second.lru_iterator);
+    lru_list_.push_front(name);
+    entry->second.lru_iterator = lru_list_.begin();
+  }
+
+  int fd = open(absl::StrCat(directory_, "/", name).c_str(), O_RDONLY);
+  if (fd < 0) return -1;
+  int64_t size = -1;
+  struct stat st;
+  uint32_t length;
+  if (fstat(fd, &st) == 0 &&
+      ReadFully(fd, reinterpret_cast<char*>(&length), sizeof(length), 0) &&
+      length == filename.size()) {
+    std::string recorded(length, '\0');
+    uint64_t header = sizeof(length) + length;
+    uint64_t data_size = static_cast<uint64_t>(st.st_size) - header;
+    if (ReadFully(fd, &recorded[0], length, sizeof(length)) &&
+        recorded == filename && data_size <= n &&
+        ReadFully(fd, buffer, data_size, header)) {
+      size = static_cast<int64_t>(data_size);
+    }
+  }
+  close(fd);
+  return size;
+}
+
+void DiskBlockCache::Insert(const std::string& filename, size_t offset,
+                            const char* data, size_t n) {
+  if (!enabled_) return;
+  std::string name, temp;
+  {
+    absl::MutexLock l(&mu_);
+    if (signatures_.find(filename) == signatures_.end()) return;
+    name = BlockName(filename, offset);
+    if (entries_.find(name) != entries_.end()) return;
+    temp = absl::StrCat(directory_, "/", kTempPrefix, getpid(), "-",
+                        next_temp_++);
+  }
+
+  // Written to a temporary file first, so that a block file is never seen
+  // partially written.
+  int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) return;
+  uint32_t length = static_cast<uint32_t>(filename.size());
+  bool ok =
+      WriteFully(fd, reinterpret_cast<const char*>(&length), sizeof(length)) &&
+      WriteFully(fd, filename.data(), length) && WriteFully(fd, data, n);
+  ok = close(fd) == 0 && ok;
+  if (!ok ||
+      rename(temp.c_str(), absl::StrCat(directory_, "/", name).c_str()) != 0) {
+    unlink(temp.c_str());
+    return;
+  }
+
+  absl::MutexLock l(&mu_);
+  if (entries_.find(name) != entries_.end()) return;
+  AddEntry(name, sizeof(length) + length + n);
+  while (cache_size_ > max_bytes_) {
+    RemoveEntry(entries_.find(lru_list_.back()));
+  }
+}
+
+void DiskBlockCache::RemoveFile(const std::string& filename) {
+  if (!enabled_) return;
+  absl::MutexLock l(&mu_);
+  signatures_.erase(filename);
+  const std::string prefix = FilePrefix(filename);
+  auto entry = entries_.lower_bound(prefix);
+  while (entry != entries_.end() && absl::StartsWith(entry->first, prefix)) {
+    RemoveEntry(entry++);
+  }
+}
+
+uint64_t DiskBlockCache::CacheSize() const {
+  absl::MutexLock l(&mu_);
+  return cache_size_;
+}
+
+}  // namespace io
+}  // namespace tensorflow
@@ -0,0 +1,114 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_IO_CORE_FILESYSTEMS_DISK_BLOCK_CACHE_H
+#define TENSORFLOW_IO_CORE_FILESYSTEMS_DISK_BLOCK_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace tensorflow {
+namespace io {
+
+/// \brief An LRU cache of file blocks stored as files in a local directory,
+/// meant to sit below a `RamFileBlockCache` on node-local SSD or tmpfs.
+///
+/// Blocks are keyed by {filename, signature, offset}, where the signature
+/// (e.g. derived from mtime and size) is set when a file is opened, so that a
+/// file which changed in the meantime misses the cache. The directory may
+/// outlive the process: blocks left by a previous run are indexed on
+/// construction, oldest first, and count towards `max_bytes`. Every block
+/// file also records its filename, which is checked on lookup.
+///
+/// The directory should not be shared by concurrent processes, since each of
+/// them enforces `max_bytes` on its own. This class is thread safe.
+class DiskBlockCache {
+ public:
+  /// The cache is disabled if `directory` is empty or cannot be created, or if
+  /// `max_bytes` is 0.
+  DiskBlockCache(const std::string& directory, uint64_t max_bytes);
+
+  bool IsCacheEnabled() const { return enabled_; }
+
+  /// Sets the signature of `filename` used by subsequent lookups and inserts.
+  void ValidateAndUpdateFileSignature(const std::string& filename,
+                                      int64_t signature)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Copies the block of `filename` at `offset` into `buffer`, which holds
+  /// `n` bytes, and returns its size. Returns -1 if the block is not cached,
+  /// or if no signature is known for `filename`.
+  int64_t Lookup(const std::string& filename, size_t offset, size_t n,
+                 char* buffer) ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Stores the `n` bytes at `data` as the block of `filename` at `offset`,
+  /// evicting the least recently used blocks beyond `max_bytes`. Failures are
+  /// ignored.
+  void Insert(const std::string& filename, size_t offset, const char* data,
+              size_t n) ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Removes all blocks of `filename` and forgets its signature.
+  void RemoveFile(const std::string& filename) ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Accessors for cache parameters.
+  uint64_t max_bytes() const { return max_bytes_; }
+
+  /// The current size of the cache in bytes.
+  uint64_t CacheSize() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Entry {
+    uint64_t size;
+    /// Position in `lru_list_`.
+    std::list<std::string>::iterator lru_iterator;
+  };
+
+  /// Block files are named "<FilePrefix><signature>-<offset>", where the
+  /// signature is the current one of the filename.
+  static std::string FilePrefix(const std::string& filename);
+  std::string SignaturePrefix(const std::string& filename)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  std::string BlockName(const std::string& filename, size_t offset)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  void AddEntry(const std::string& name, uint64_t size)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void RemoveEntry(std::map<std::string, Entry>::iterator entry)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const std::string directory_;
+  const uint64_t max_bytes_;
+  bool enabled_;
+
+  mutable absl::Mutex mu_;
+  /// Cached blocks by file name. Ordered, so that the blocks of one filename
+  /// are adjacent.
+  std::map<std::string, Entry> entries_ ABSL_GUARDED_BY(mu_);
+  /// Most recently used first.
+  std::list<std::string> lru_list_ ABSL_GUARDED_BY(mu_);
+  uint64_t cache_size_ ABSL_GUARDED_BY(mu_) = 0;
+  std::map<std::string, int64_t> signatures_ ABSL_GUARDED_BY(mu_);
+  uint64_t next_temp_ ABSL_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_IO_CORE_FILESYSTEMS_DISK_BLOCK_CACHE_H
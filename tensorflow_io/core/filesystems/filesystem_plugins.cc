@@ -29,7 +29,7 @@ limitations under the License.
 TFIO_PLUGIN_EXPORT void TF_InitPlugin(TF_FilesystemPluginInfo* info) {
   info->plugin_memory_allocate = tensorflow::io::plugin_memory_allocate;
   info->plugin_memory_free = tensorflow::io::plugin_memory_free;
-  info->num_schemes = 8;
+  info->num_schemes = 16;
   info->ops = static_cast<TF_FilesystemPluginOps*>(
       tensorflow::io::plugin_memory_allocate(info->num_schemes *
                                              sizeof(info->ops[0])));
@@ -41,4 +41,20 @@ TFIO_PLUGIN_EXPORT void TF_InitPlugin(TF_FilesystemPluginInfo* info) {
   tensorflow::io::hdfs::ProvideFilesystemSupportFor(&info->ops[5], "viewfs");
   tensorflow::io::hdfs::ProvideFilesystemSupportFor(&info->ops[6], "har");
   tensorflow::io::chfs::ProvideFilesystemSupportFor(&info->ops[7], "chfs");
+  tensorflow::io::cache::ProvideFilesystemSupportFor(&info->ops[8],
+                                                     "cache.az");
+  tensorflow::io::cache::ProvideFilesystemSupportFor(&info->ops[9],
+                                                     "cache.http");
+  tensorflow::io::cache::ProvideFilesystemSupportFor(&info->ops[10],
+                                                     "cache.https");
+  tensorflow::io::cache::ProvideFilesystemSupportFor(&info->ops[11],
+                                                     "cache.s3");
+  tensorflow::io::cache::ProvideFilesystemSupportFor(&info->ops[12],
+                                                     "cache.hdfs");
+  tensorflow::io::cache::ProvideFilesystemSupportFor(&info->ops[13],
+                                                     "cache.viewfs");
+  tensorflow::io::cache::ProvideFilesystemSupportFor(&info->ops[14],
+                                                     "cache.har");
+  tensorflow::io::cache::ProvideFilesystemSupportFor(&info->ops[15],
+                                                     "cache.chfs");
 }
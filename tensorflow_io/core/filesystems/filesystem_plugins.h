@@ -54,8 +54,18 @@ namespace chfs {
 
 void ProvideFilesystemSupportFor(TF_FilesystemPluginOps* ops, const char* uri);
 
+// The filesystem initialized for the "chfs" scheme, or null. libchfs has a
+// single client per process, which the "cache.chfs" wrapper shares.
+TF_Filesystem* GetInitializedFilesystem();
+
 }  // namespace chfs
 
+namespace cache {
+
+void ProvideFilesystemSupportFor(TF_FilesystemPluginOps* ops, const char* uri);
+
+}  // namespace cache
+
 }  // namespace io
 }  // namespace tensorflow
 
@@ -0,0 +1,117 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_io/core/filesystems/filesystem_stats.h"
+
+#include <chrono>
+#include <map>
+
+#include "absl/synchronization/mutex.h"
+
+#if defined(_MSC_VER)
+#define TFIO_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define TFIO_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+namespace tensorflow {
+namespace io {
+namespace {
+
+absl::Mutex registry_mu(absl::kConstInit);
+
+std::map<std::string, const FileSystemStats*>* Registry() {
+  static auto* registry = new std::map<std::string, const FileSystemStats*>;
+  return registry;
+}
+
+int LatencyBucket(uint64_t latency_us) {
+  int bucket = 0;
+  while (latency_us > 1 && bucket < kFileSystemStatsNumBuckets - 1) {
+    latency_us >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+}  // namespace
+
+FileSystemStats::FileSystemStats(const std::vector<std::string>& op_names)
+    : names_(op_names), counters_(new Counters[op_names.size()]) {
+  for (size_t i = 0; i < names_.size(); ++i) {
+    for (auto& value : counters_[i].values) {
+      value.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void FileSystemStats::Record(int op, uint64_t latency_us, uint64_t bytes,
+                             bool ok) {
+  auto& values = counters_[op].values;
+  values[kFileSystemStatsCalls].fetch_add(1, std::memory_order_relaxed);
+  if (!ok) {
+    values[kFileSystemStatsErrors].fetch_add(1, std::memory_order_relaxed);
+  }
+  if (bytes > 0) {
+    values[kFileSystemStatsBytes].fetch_add(bytes, std::memory_order_relaxed);
+  }
+  values[kFileSystemStatsLatencyMicros].fetch_add(latency_us,
+                                                  std::memory_order_relaxed);
+  values[kFileSystemStatsFirstBucket + LatencyBucket(latency_us)].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+int FileSystemStats::Snapshot(const char** names, int64_t* values,
+                              int max_ops) const {
+  for (int i = 0; i < num_ops() && i < max_ops; ++i) {
+    names[i] = names_[i].c_str();
+    for (int j = 0; j < kFileSystemStatsNumFields; ++j) {
+      values[i * kFileSystemStatsNumFields + j] = static_cast<int64_t>(
+          counters_[i].values[j].load(std::memory_order_relaxed));
+    }
+  }
+  return num_ops();
+}
+
+uint64_t FileSystemStats::NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void RegisterFileSystemStats(const std::string& scheme,
+                             const FileSystemStats* stats) {
+  absl::MutexLock l(&registry_mu);
+  (*Registry())[scheme] = stats;
+}
+
+void UnregisterFileSystemStats(const std::string& scheme,
+                               const FileSystemStats* stats) {
+  absl::MutexLock l(&registry_mu);
+  auto it = Registry()->find(scheme);
+  if (it != Registry()->end() && it->second == stats) Registry()->erase(it);
+}
+
+}  // namespace io
+}  // namespace tensorflow
+
+extern "C" TFIO_PLUGIN_EXPORT int TF_IO_FileSystemStatsSnapshot(
+    const char* scheme, const char** names, int64_t* values, int max_ops) {
+  absl::MutexLock l(&tensorflow::io::registry_mu);
+  auto registry = tensorflow::io::Registry();
+  auto it = registry->find(scheme);
+  if (it == registry->end()) return -1;
+  return it->second->Snapshot(names, values, max_ops);
+}
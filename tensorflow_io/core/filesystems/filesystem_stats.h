@@ -0,0 +1,97 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_IO_CORE_FILESYSTEMS_FILESYSTEM_STATS_H
+#define TENSORFLOW_IO_CORE_FILESYSTEMS_FILESYSTEM_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tensorflow {
+namespace io {
+
+/// Number of latency buckets per operation. Bucket `b` > 0 counts the calls
+/// which took [2^b, 2^(b+1)) microseconds, bucket 0 the ones faster than 2
+/// microseconds, and the last bucket also everything slower.
+constexpr int kFileSystemStatsNumBuckets = 32;
+
+/// Layout of the row of one operation in a snapshot.
+enum FileSystemStatsField {
+  kFileSystemStatsCalls = 0,
+  kFileSystemStatsErrors,
+  kFileSystemStatsBytes,
+  kFileSystemStatsLatencyMicros,
+  kFileSystemStatsFirstBucket,
+  kFileSystemStatsNumFields = kFileSystemStatsFirstBucket +
+                              kFileSystemStatsNumBuckets,
+};
+
+/// Filesystem plugins are loaded into their own shared object, so kernels
+/// reach their statistics through a function with C linkage which is looked
+/// up with `dlsym` under this name.
+///
+/// The function copies the names and counters of at most `max_ops`
+/// operations of the filesystem registered for `scheme` into `names` and
+/// `values` (`max_ops` rows of kFileSystemStatsNumFields), and returns the
+/// number of operations of that filesystem, or -1 if no filesystem registered
+/// statistics for `scheme`. The names stay valid while the plugin is loaded.
+constexpr char kFileSystemStatsSnapshotSymbol[] =
+    "TF_IO_FileSystemStatsSnapshot";
+typedef int (*FileSystemStatsSnapshotFn)(const char* scheme,
+                                         const char** names, int64_t* values,
+                                         int max_ops);
+
+/// \brief Lock-free per-operation call, error and byte counters with
+/// log-bucketed latency histograms.
+class FileSystemStats {
+ public:
+  explicit FileSystemStats(const std::vector<std::string>& op_names);
+
+  /// Records one call of operation `op` (an index into the names given to the
+  /// constructor) which transferred `bytes` and took `latency_us`.
+  void Record(int op, uint64_t latency_us, uint64_t bytes, bool ok);
+
+  /// See FileSystemStatsSnapshotFn.
+  int Snapshot(const char** names, int64_t* values, int max_ops) const;
+
+  int num_ops() const { return static_cast<int>(names_.size()); }
+
+  static uint64_t NowMicros();
+
+ private:
+  struct Counters {
+    std::atomic<uint64_t> values[kFileSystemStatsNumFields];
+  };
+
+  const std::vector<std::string> names_;
+  std::unique_ptr<Counters[]> counters_;
+};
+
+/// Makes `stats` visible to the snapshot function under `scheme`, replacing
+/// what was registered for it before.
+void RegisterFileSystemStats(const std::string& scheme,
+                             const FileSystemStats* stats);
+
+/// Removes `stats` again if it is still registered for `scheme`.
+void UnregisterFileSystemStats(const std::string& scheme,
+                               const FileSystemStats* stats);
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_IO_CORE_FILESYSTEMS_FILESYSTEM_STATS_H
@@ -16,18 +16,23 @@ limitations under the License.
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <deque>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 #if defined(_MSC_VER)
 #include <Windows.h>
 #else
 #include <dlfcn.h>
 #endif
 
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
 #include "hdfs/hdfs.h"
@@ -256,14 +261,40 @@ class LibHDFS {
 // SECTION 1. Implementation for `TF_RandomAccessFile`
 // ----------------------------------------------------------------------------
 namespace tf_random_access_file {
+constexpr size_t kHandlesPerFile = 4;
+constexpr size_t kReadAheadSize = 1024 * 1024;
+
+// A range of the file read ahead of small reads. Immutable once shared.
+typedef struct ReadAheadBlock {
+  uint64_t offset;
+  std::string data;
+} ReadAheadBlock;
+
 typedef struct HDFSRandomAccessFile {
   std::string path;
   std::string hdfs_path;
   hdfsFS fs;
   LibHDFS* libhdfs;
-  absl::Mutex mu;
-  hdfsFile handle ABSL_GUARDED_BY(mu);
   bool disable_eof_retried;
+  // The maximum number of handles opened for this file, i.e. of concurrent
+  // `hdfsPread` calls.
+  size_t max_handles;
+  // Sequential reads smaller than this are served from read-ahead blocks of
+  // this size, aligned to it.
+  size_t read_ahead_size;
+  absl::Mutex mu;
+  absl::CondVar handle_released;
+  // Handles not used by a read at the moment. A read takes one for its
+  // duration, so that concurrent reads do not wait for each other.
+  std::vector<hdfsFile> handles ABSL_GUARDED_BY(mu);
+  // The number of open handles, including those in use.
+  size_t num_handles ABSL_GUARDED_BY(mu);
+  // The most recently read-ahead blocks, most recent first. There is one per
+  // handle, enough for each concurrent reader to stream through its own.
+  std::deque<std::shared_ptr<const ReadAheadBlock>> blocks ABSL_GUARDED_BY(mu);
+  // Where the most recent small reads ended, most recent first, one per
+  // handle as well. A read starting at one of them is sequential.
+  std::deque<uint64_t> read_ends ABSL_GUARDED_BY(mu);
   HDFSRandomAccessFile(std::string path, std::string hdfs_path, hdfsFS fs,
                        LibHDFS* libhdfs, hdfsFile handle)
       : path(std::move(path)),
@@ -271,7 +302,8 @@ typedef struct HDFSRandomAccessFile {
         fs(fs),
         libhdfs(libhdfs),
         mu(),
-        handle(handle) {
+        handles({handle}),
+        num_handles(1) {
     const char* disable_eof_retried_str =
         getenv("HDFS_DISABLE_READ_EOF_RETRIED");
     if (disable_eof_retried_str && disable_eof_retried_str[0] == '1') {
@@ -279,6 +311,16 @@ typedef struct HDFSRandomAccessFile {
     } else {
       disable_eof_retried = false;
     }
+    uint64_t value;
+    max_handles = kHandlesPerFile;
+    if (absl::SimpleAtoi(getenv("HDFS_READ_HANDLES_PER_FILE"), &value) &&
+        value > 0) {
+      max_handles = value;
+    }
+    read_ahead_size = kReadAheadSize;
+    if (absl::SimpleAtoi(getenv("HDFS_READ_AHEAD_SIZE_KB"), &value)) {
+      read_ahead_size = value * 1024;
+    }
   }
 } HDFSRandomAccessFile;
 
@@ -286,39 +328,75 @@ void Cleanup(TF_RandomAccessFile* file) {
   auto hdfs_file = static_cast<HDFSRandomAccessFile*>(file->plugin_file);
   {
     absl::MutexLock l(&hdfs_file->mu);
-    if (hdfs_file->handle != nullptr) {
-      hdfs_file->libhdfs->hdfsCloseFile(hdfs_file->fs, hdfs_file->handle);
+    for (auto handle : hdfs_file->handles) {
+      if (handle != nullptr) {
+        hdfs_file->libhdfs->hdfsCloseFile(hdfs_file->fs, handle);
+      }
     }
   }
   delete hdfs_file;
 }
 
-int64_t Read(const TF_RandomAccessFile* file, uint64_t offset, size_t n,
-             char* buffer, TF_Status* status) {
-  auto hdfs_file = static_cast<HDFSRandomAccessFile*>(file->plugin_file);
+// Takes an idle handle, opening a new one if there is none and the limit
+// is not reached yet, or waits for one to be released.
+static hdfsFile AcquireHandle(HDFSRandomAccessFile* hdfs_file,
+                              TF_Status* status) {
+  {
+    absl::MutexLock l(&hdfs_file->mu);
+    while (hdfs_file->handles.empty() &&
+           hdfs_file->num_handles >= hdfs_file->max_handles) {
+      hdfs_file->handle_released.Wait(&hdfs_file->mu);
+    }
+    if (!hdfs_file->handles.empty()) {
+      hdfsFile handle = hdfs_file->handles.back();
+      hdfs_file->handles.pop_back();
+      return handle;
+    }
+    hdfs_file->num_handles++;
+  }
+  hdfsFile handle = hdfs_file->libhdfs->hdfsOpenFile(
+      hdfs_file->fs, hdfs_file->hdfs_path.c_str(), O_RDONLY, 0, 0, 0);
+  if (handle == nullptr) {
+    TF_SetStatusFromIOError(status, errno, hdfs_file->path.c_str());
+    absl::MutexLock l(&hdfs_file->mu);
+    hdfs_file->num_handles--;
+    hdfs_file->handle_released.Signal();
+  }
+  return handle;
+}
+
+// Gives back a handle taken by `AcquireHandle`. A null handle (whose reopen
+// failed) frees its slot.
+static void ReleaseHandle(HDFSRandomAccessFile* hdfs_file, hdfsFile handle) {
+  absl::MutexLock l(&hdfs_file->mu);
+  if (handle != nullptr) {
+    hdfs_file->handles.push_back(handle);
+  } else {
+    hdfs_file->num_handles--;
+  }
+  hdfs_file->handle_released.Signal();
+}
+
+// Reads `n` bytes at `offset` through `*handle`, which may be replaced if the
+// file is reopened at EOF.
+static int64_t ReadWithHandle(HDFSRandomAccessFile* hdfs_file,
+                              hdfsFile* handle, uint64_t offset, size_t n,
+                              char* buffer, bool eof_retried,
+                              TF_Status* status) {
   auto libhdfs = hdfs_file->libhdfs;
   auto fs = hdfs_file->fs;
   auto hdfs_path = hdfs_file->hdfs_path.c_str();
   auto path = hdfs_file->path.c_str();
 
   char* dst = buffer;
-  bool eof_retried = false;
-  if (hdfs_file->disable_eof_retried) {
-    // eof_retried = true, avoid calling hdfsOpenFile in Read, Fixes #42597
-    eof_retried = true;
-  }
   int64_t read = 0;
   while (TF_GetCode(status) == TF_OK && n > 0) {
-    // We lock inside the loop rather than outside so we don't block other
-    // concurrent readers.
-    absl::MutexLock l(&hdfs_file->mu);
-    auto handle = hdfs_file->handle;
     // Max read length is INT_MAX-2.
     // Actual max array size in java depends on JVM's implentation
     // So we choose INT_MAX-8, which is the maximum "safe" number.
     size_t read_n =
         (std::min)(n, static_cast<size_t>(std::numeric_limits<int>::max() - 8));
-    int64_t r = libhdfs->hdfsPread(fs, handle, static_cast<tOffset>(offset),
+    int64_t r = libhdfs->hdfsPread(fs, *handle, static_cast<tOffset>(offset),
                                    dst, static_cast<tSize>(read_n));
     if (r > 0) {
       dst += r;
@@ -332,17 +410,16 @@ int64_t Read(const TF_RandomAccessFile* file, uint64_t offset, size_t n,
       // contents.
       //
       // Fixes #5438
-      if (handle != nullptr && libhdfs->hdfsCloseFile(fs, handle) != 0) {
+      if (*handle != nullptr && libhdfs->hdfsCloseFile(fs, *handle) != 0) {
+        *handle = nullptr;
         TF_SetStatusFromIOError(status, errno, path);
         return -1;
       }
-      hdfs_file->handle =
-          libhdfs->hdfsOpenFile(fs, hdfs_path, O_RDONLY, 0, 0, 0);
-      if (hdfs_file->handle == nullptr) {
+      *handle = libhdfs->hdfsOpenFile(fs, hdfs_path, O_RDONLY, 0, 0, 0);
+      if (*handle == nullptr) {
         TF_SetStatusFromIOError(status, errno, path);
         return -1;
       }
-      handle = hdfs_file->handle;
       eof_retried = true;
     } else if (eof_retried && r == 0) {
       TF_SetStatus(status, TF_OUT_OF_RANGE, "Read less bytes than requested");
@@ -355,35 +432,127 @@ int64_t Read(const TF_RandomAccessFile* file, uint64_t offset, size_t n,
   return read;
 }
 
+// Serves the beginning of a small read from a read-ahead block. A new block
+// is only read if none holds `offset` and the read is sequential. Returns
+// the number of bytes copied, which is less than `n` if the block ends
+// early (e.g. at EOF) or if there is none.
+static int64_t ReadAhead(HDFSRandomAccessFile* hdfs_file, uint64_t offset,
+                         size_t n, char* buffer, TF_Status* status) {
+  std::shared_ptr<const ReadAheadBlock> block;
+  bool sequential = false;
+  {
+    absl::MutexLock l(&hdfs_file->mu);
+    for (const auto& b : hdfs_file->blocks) {
+      if (b->offset <= offset && offset < b->offset + b->data.size()) {
+        block = b;
+        break;
+      }
+    }
+    auto& read_ends = hdfs_file->read_ends;
+    auto it = std::find(read_ends.begin(), read_ends.end(), offset);
+    if (it != read_ends.end()) {
+      sequential = true;
+      read_ends.erase(it);
+    }
+    read_ends.push_front(offset + n);
+    if (read_ends.size() > hdfs_file->max_handles) read_ends.pop_back();
+  }
+  if (block == nullptr) {
+    // Random reads go straight to the file.
+    if (!sequential) return 0;
+    hdfsFile handle = AcquireHandle(hdfs_file, status);
+    if (TF_GetCode(status) != TF_OK) return -1;
+    auto new_block = std::make_shared<ReadAheadBlock>();
+    // Aligned, so that nearby reads do not read overlapping blocks.
+    new_block->offset =
+        offset / hdfs_file->read_ahead_size * hdfs_file->read_ahead_size;
+    new_block->data.resize(hdfs_file->read_ahead_size);
+    // A short block is fine here: the rest of the read goes through the
+    // regular path, which reopens the file at EOF.
+    int64_t r = ReadWithHandle(hdfs_file, &handle, new_block->offset,
+                               new_block->data.size(), &new_block->data[0],
+                               /*eof_retried=*/true, status);
+    ReleaseHandle(hdfs_file, handle);
+    if (TF_GetCode(status) == TF_OUT_OF_RANGE) {
+      TF_SetStatus(status, TF_OK, "");
+    }
+    if (TF_GetCode(status) != TF_OK) return -1;
+    if (static_cast<uint64_t>(r) <= offset - new_block->offset) return 0;
+    new_block->data.resize(r);
+    block = std::move(new_block);
+    absl::MutexLock l(&hdfs_file->mu);
+    hdfs_file->blocks.push_front(block);
+    if (hdfs_file->blocks.size() > hdfs_file->max_handles) {
+      hdfs_file->blocks.pop_back();
+    }
+  }
+  size_t copy_n = (std::min)(
+      n, static_cast<size_t>(block->offset + block->data.size() - offset));
+  memcpy(buffer, block->data.data() + (offset - block->offset), copy_n);
+  return copy_n;
+}
+
+int64_t Read(const TF_RandomAccessFile* file, uint64_t offset, size_t n,
+             char* buffer, TF_Status* status) {
+  auto hdfs_file = static_cast<HDFSRandomAccessFile*>(file->plugin_file);
+
+  int64_t read = 0;
+  if (n > 0 && n < hdfs_file->read_ahead_size) {
+    read = ReadAhead(hdfs_file, offset, n, buffer, status);
+    if (TF_GetCode(status) != TF_OK) return -1;
+    if (static_cast<size_t>(read) == n) return read;
+    offset += read;
+    buffer += read;
+    n -= read;
+  }
+
+  hdfsFile handle = AcquireHandle(hdfs_file, status);
+  if (TF_GetCode(status) != TF_OK) return -1;
+  // eof_retried = true, avoid calling hdfsOpenFile in Read, Fixes #42597
+  int64_t r = ReadWithHandle(hdfs_file, &handle, offset, n, buffer,
+                             hdfs_file->disable_eof_retried, status);
+  ReleaseHandle(hdfs_file, handle);
+  if (r < 0) return -1;
+  return read + r;
+}
+
 }  // namespace tf_random_access_file
 
 // SECTION 2. Implementation for `TF_WritableFile`
 // ----------------------------------------------------------------------------
 namespace tf_writable_file {
+constexpr size_t kWriteBufferSize = 4 * 1024 * 1024;
+
 typedef struct HDFSWritableFile {
   std::string hdfs_path;
   hdfsFS fs;
   LibHDFS* libhdfs;
   hdfsFile handle;
+  // Appends are buffered up to this many bytes and written by `writer`, or
+  // written directly if 0.
+  size_t buffer_size;
+  absl::Mutex mu;
+  absl::CondVar cond;
+  std::string buffer ABSL_GUARDED_BY(mu);
+  // Offset in the file of the end of `buffer`.
+  int64_t position ABSL_GUARDED_BY(mu);
+  // Flushes and syncs requested by the writer, and those done by `writer`.
+  uint64_t flush_requested ABSL_GUARDED_BY(mu);
+  uint64_t flush_done ABSL_GUARDED_BY(mu);
+  uint64_t sync_requested ABSL_GUARDED_BY(mu);
+  uint64_t sync_done ABSL_GUARDED_BY(mu);
+  bool stop ABSL_GUARDED_BY(mu);
+  // First error hit by `writer`, reported by all later calls.
+  TF_Code error_code ABSL_GUARDED_BY(mu);
+  std::string error_message ABSL_GUARDED_BY(mu);
+  std::thread writer;
   HDFSWritableFile(std::string hdfs_path, hdfsFS fs, LibHDFS* libhdfs,
-                   hdfsFile handle)
-      : hdfs_path(std::move(hdfs_path)),
-        fs(fs),
-        libhdfs(libhdfs),
-        handle(handle) {}
+                   hdfsFile handle);
 } HDFSWritableFile;
 
-void Cleanup(TF_WritableFile* file) {
-  auto hdfs_file = static_cast<HDFSWritableFile*>(file->plugin_file);
-  hdfs_file->libhdfs->hdfsCloseFile(hdfs_file->fs, hdfs_file->handle);
-  hdfs_file->fs = nullptr;
-  hdfs_file->handle = nullptr;
-  delete hdfs_file;
-}
-
-void Append(const TF_WritableFile* file, const char* buffer, size_t n,
-            TF_Status* status) {
-  auto hdfs_file = static_cast<HDFSWritableFile*>(file->plugin_file);
+// Writes `n` bytes through `hdfs_file->handle`.
+static void Write(HDFSWritableFile* hdfs_file, const char* buffer, size_t n,
+                  TF_Status* status) {
   auto libhdfs = hdfs_file->libhdfs;
   auto fs = hdfs_file->fs;
   auto handle = hdfs_file->handle;
@@ -413,8 +582,151 @@ void Append(const TF_WritableFile* file, const char* buffer, size_t n,
   TF_SetStatus(status, TF_OK, "");
 }
 
+// Writes out the buffer once it is half full, or when a flush or sync is
+// requested, so that appends only wait for HDFS when the buffer is full.
+static void WriterLoop(HDFSWritableFile* hdfs_file) {
+  auto libhdfs = hdfs_file->libhdfs;
+  std::string data;
+  TF_Status* status = TF_NewStatus();
+  while (true) {
+    uint64_t flush, sync;
+    bool stop;
+    {
+      absl::MutexLock l(&hdfs_file->mu);
+      while (!hdfs_file->stop &&
+             hdfs_file->buffer.size() < hdfs_file->buffer_size / 2 &&
+             hdfs_file->flush_requested == hdfs_file->flush_done &&
+             hdfs_file->sync_requested == hdfs_file->sync_done) {
+        hdfs_file->cond.Wait(&hdfs_file->mu);
+      }
+      data.swap(hdfs_file->buffer);
+      flush = hdfs_file->flush_requested;
+      sync = hdfs_file->sync_requested;
+      stop = hdfs_file->stop;
+      // Wake up appends waiting for room in the buffer.
+      hdfs_file->cond.SignalAll();
+    }
+
+    TF_SetStatus(status, TF_OK, "");
+    Write(hdfs_file, data.data(), data.size(), status);
+    data.clear();
+    if (TF_GetCode(status) == TF_OK) {
+      int r = 0;
+      absl::ReleasableMutexLock l(&hdfs_file->mu);
+      if (sync != hdfs_file->sync_done) {
+        l.Release();
+        r = libhdfs->hdfsHSync(hdfs_file->fs, hdfs_file->handle);
+      } else if (flush != hdfs_file->flush_done) {
+        l.Release();
+        r = libhdfs->hdfsHFlush(hdfs_file->fs, hdfs_file->handle);
+      }
+      if (r != 0) {
+        TF_SetStatusFromIOError(status, errno, hdfs_file->hdfs_path.c_str());
+      }
+    }
+
+    absl::MutexLock l(&hdfs_file->mu);
+    if (TF_GetCode(status) != TF_OK && hdfs_file->error_code == TF_OK) {
+      hdfs_file->error_code = TF_GetCode(status);
+      hdfs_file->error_message = TF_Message(status);
+    }
+    hdfs_file->flush_done = flush;
+    hdfs_file->sync_done = sync;
+    hdfs_file->cond.SignalAll();
+    if (stop) break;
+  }
+  TF_DeleteStatus(status);
+}
+
+HDFSWritableFile::HDFSWritableFile(std::string hdfs_path, hdfsFS fs,
+                                   LibHDFS* libhdfs, hdfsFile handle)
+    : hdfs_path(std::move(hdfs_path)),
+      fs(fs),
+      libhdfs(libhdfs),
+      handle(handle),
+      mu(),
+      position(0),
+      flush_requested(0),
+      flush_done(0),
+      sync_requested(0),
+      sync_done(0),
+      stop(false),
+      error_code(TF_OK) {
+  uint64_t value;
+  buffer_size = kWriteBufferSize;
+  if (absl::SimpleAtoi(getenv("HDFS_WRITE_BUFFER_SIZE_KB"), &value)) {
+    buffer_size = value * 1024;
+  }
+  if (buffer_size == 0) return;
+  // Appendable files do not start at 0, and `Tell` cannot ask HDFS once
+  // writes are in flight.
+  position = libhdfs->hdfsTell(fs, handle);
+  if (position == -1) {
+    buffer_size = 0;
+    return;
+  }
+  buffer.reserve(buffer_size);
+  writer = std::thread(WriterLoop, this);
+}
+
+static void SetWriterStatus(HDFSWritableFile* hdfs_file, TF_Status* status)
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(hdfs_file->mu) {
+  TF_SetStatus(status, hdfs_file->error_code,
+               hdfs_file->error_message.c_str());
+}
+
+// Writes out what is buffered and stops the writer thread.
+static void StopWriter(HDFSWritableFile* hdfs_file) {
+  if (!hdfs_file->writer.joinable()) return;
+  {
+    absl::MutexLock l(&hdfs_file->mu);
+    hdfs_file->stop = true;
+    hdfs_file->cond.SignalAll();
+  }
+  hdfs_file->writer.join();
+}
+
+void Cleanup(TF_WritableFile* file) {
+  auto hdfs_file = static_cast<HDFSWritableFile*>(file->plugin_file);
+  StopWriter(hdfs_file);
+  hdfs_file->libhdfs->hdfsCloseFile(hdfs_file->fs, hdfs_file->handle);
+  hdfs_file->fs = nullptr;
+  hdfs_file->handle = nullptr;
+  delete hdfs_file;
+}
+
+void Append(const TF_WritableFile* file, const char* buffer, size_t n,
+            TF_Status* status) {
+  auto hdfs_file = static_cast<HDFSWritableFile*>(file->plugin_file);
+  if (hdfs_file->buffer_size == 0) return Write(hdfs_file, buffer, n, status);
+
+  absl::MutexLock l(&hdfs_file->mu);
+  if (hdfs_file->stop) {
+    return TF_SetStatus(status, TF_FAILED_PRECONDITION,
+                        "Cannot append to a closed file");
+  }
+  while (hdfs_file->error_code == TF_OK &&
+         hdfs_file->buffer.size() >= hdfs_file->buffer_size) {
+    hdfs_file->cond.Wait(&hdfs_file->mu);
+  }
+  if (hdfs_file->error_code != TF_OK) {
+    return SetWriterStatus(hdfs_file, status);
+  }
+  hdfs_file->buffer.append(buffer, n);
+  hdfs_file->position += n;
+  if (hdfs_file->buffer.size() >= hdfs_file->buffer_size / 2) {
+    hdfs_file->cond.SignalAll();
+  }
+  TF_SetStatus(status, TF_OK, "");
+}
+
 int64_t Tell(const TF_WritableFile* file, TF_Status* status) {
   auto hdfs_file = static_cast<HDFSWritableFile*>(file->plugin_file);
+  if (hdfs_file->buffer_size > 0) {
+    absl::MutexLock l(&hdfs_file->mu);
+    TF_SetStatus(status, TF_OK, "");
+    return hdfs_file->position;
+  }
   int64_t position =
       hdfs_file->libhdfs->hdfsTell(hdfs_file->fs, hdfs_file->handle);
   if (position == -1)
@@ -426,6 +738,16 @@ int64_t Tell(const TF_WritableFile* file, TF_Status* status) {
 
 void Flush(const TF_WritableFile* file, TF_Status* status) {
   auto hdfs_file = static_cast<HDFSWritableFile*>(file->plugin_file);
+  if (hdfs_file->buffer_size > 0) {
+    // The buffer is written and flushed in the background, errors are
+    // reported by a later call.
+    absl::MutexLock l(&hdfs_file->mu);
+    if (!hdfs_file->stop) {
+      hdfs_file->flush_requested++;
+      hdfs_file->cond.SignalAll();
+    }
+    return SetWriterStatus(hdfs_file, status);
+  }
   if (hdfs_file->libhdfs->hdfsHFlush(hdfs_file->fs, hdfs_file->handle) != 0)
     TF_SetStatusFromIOError(status, errno, hdfs_file->hdfs_path.c_str());
   else
@@ -434,6 +756,18 @@ void Flush(const TF_WritableFile* file, TF_Status* status) {
 
 void Sync(const TF_WritableFile* file, TF_Status* status) {
   auto hdfs_file = static_cast<HDFSWritableFile*>(file->plugin_file);
+  if (hdfs_file->buffer_size > 0) {
+    // Unlike `Flush`, wait for the data to be durable.
+    absl::MutexLock l(&hdfs_file->mu);
+    if (!hdfs_file->stop) {
+      uint64_t sync = ++hdfs_file->sync_requested;
+      hdfs_file->cond.SignalAll();
+      while (hdfs_file->sync_done < sync) {
+        hdfs_file->cond.Wait(&hdfs_file->mu);
+      }
+    }
+    return SetWriterStatus(hdfs_file, status);
+  }
   if (hdfs_file->libhdfs->hdfsHSync(hdfs_file->fs, hdfs_file->handle) != 0)
     TF_SetStatusFromIOError(status, errno, hdfs_file->hdfs_path.c_str());
   else
@@ -443,10 +777,13 @@ void Sync(const TF_WritableFile* file, TF_Status* status) {
 void Close(const TF_WritableFile* file, TF_Status* status) {
   auto hdfs_file = static_cast<HDFSWritableFile*>(file->plugin_file);
   TF_SetStatus(status, TF_OK, "");
+  StopWriter(hdfs_file);
   if (hdfs_file->libhdfs->hdfsCloseFile(hdfs_file->fs, hdfs_file->handle) != 0)
     TF_SetStatusFromIOError(status, errno, hdfs_file->hdfs_path.c_str());
   hdfs_file->fs = nullptr;
   hdfs_file->handle = nullptr;
+  absl::MutexLock l(&hdfs_file->mu);
+  if (hdfs_file->error_code != TF_OK) SetWriterStatus(hdfs_file, status);
 }
 
 }  // namespace tf_writable_file
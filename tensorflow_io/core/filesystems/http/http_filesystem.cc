@@ -15,16 +15,22 @@ limitations under the License.
 
 #include <curl/curl.h>
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
 #include "tensorflow/c/logging.h"
 #include "tensorflow/c/tf_status.h"
 #include "tensorflow_io/core/filesystems/filesystem_plugins.h"
+#include "tensorflow_io/core/filesystems/ram_file_block_cache.h"
 
 namespace tensorflow {
 namespace io {
@@ -44,14 +50,122 @@ void CurlInitialize() {
   }
 }
 
+// The maximum number of idle easy and multi handles kept by the pool.
+constexpr size_t kMaxIdleHandles = 32;
+
+// Curl handles kept across requests. An easy handle keeps the connections it
+// opened alive after a request, as does a multi handle for the connections of
+// the easy handles added to it, so that subsequent requests to the same server
+// skip TCP and TLS setup. All easy handles also share their DNS and TLS session
+// caches. Connections themselves are not shared, which libcurl does not support
+// across threads.
+class CurlHandlePool {
+ public:
+  static CurlHandlePool* Get() {
+    // Never destroyed, so that handles can be released at any time.
+    static CurlHandlePool* pool = new CurlHandlePool();
+    return pool;
+  }
+
+  CURL* AcquireEasy() {
+    CURL* curl = nullptr;
+    {
+      absl::MutexLock l(&mu_);
+      if (!easy_handles_.empty()) {
+        curl = easy_handles_.back();
+        easy_handles_.pop_back();
+      }
+    }
+    if (curl == nullptr) curl = curl_easy_init();
+    if (curl != nullptr && share_ != nullptr) {
+      curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+    }
+    return curl;
+  }
+
+  void ReleaseEasy(CURL* curl) {
+    // Resets the options but keeps the connections alive.
+    curl_easy_reset(curl);
+    {
+      absl::MutexLock l(&mu_);
+      if (easy_handles_.size() < kMaxIdleHandles) {
+        easy_handles_.push_back(curl);
+        return;
+      }
+    }
+    curl_easy_cleanup(curl);
+  }
+
+  CURLM* AcquireMulti() {
+    {
+      absl::MutexLock l(&mu_);
+      if (!multi_handles_.empty()) {
+        CURLM* multi = multi_handles_.back();
+        multi_handles_.pop_back();
+        return multi;
+      }
+    }
+    return curl_multi_init();
+  }
+
+  void ReleaseMulti(CURLM* multi) {
+    {
+      absl::MutexLock l(&mu_);
+      if (multi_handles_.size() < kMaxIdleHandles) {
+        multi_handles_.push_back(multi);
+        return;
+      }
+    }
+    curl_multi_cleanup(multi);
+  }
+
+ private:
+  CurlHandlePool() {
+    CurlInitialize();
+    share_ = curl_share_init();
+    if (share_ == nullptr) return;
+    if (curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &Lock) != CURLSHE_OK ||
+        curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &Unlock) !=
+            CURLSHE_OK ||
+        curl_share_setopt(share_, CURLSHOPT_USERDATA, this) != CURLSHE_OK ||
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS) !=
+            CURLSHE_OK ||
+        curl_share_setopt(share_, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_SSL_SESSION) != CURLSHE_OK) {
+      curl_share_cleanup(share_);
+      share_ = nullptr;
+    }
+  }
+
+  static void Lock(CURL* curl, curl_lock_data data, curl_lock_access access,
+                   void* pool) {
+    static_cast<CurlHandlePool*>(pool)->share_mu_[data].Lock();
+  }
+
+  static void Unlock(CURL* curl, curl_lock_data data, void* pool) {
+    static_cast<CurlHandlePool*>(pool)->share_mu_[data].Unlock();
+  }
+
+  CURLSH* share_ = nullptr;
+  absl::Mutex share_mu_[CURL_LOCK_DATA_LAST];
+  absl::Mutex mu_;
+  std::vector<CURL*> easy_handles_ ABSL_GUARDED_BY(mu_);
+  std::vector<CURLM*> multi_handles_ ABSL_GUARDED_BY(mu_);
+};
+
 class CurlHttpRequest {
  public:
   CurlHttpRequest() {}
-  ~CurlHttpRequest() {}
+  CurlHttpRequest(const CurlHttpRequest&) = delete;
+  CurlHttpRequest& operator=(const CurlHttpRequest&) = delete;
+  ~CurlHttpRequest() {
+    if (curl_headers_) curl_slist_free_all(curl_headers_);
+    if (resolve_list_) curl_slist_free_all(resolve_list_);
+    if (curl_) CurlHandlePool::Get()->ReleaseEasy(curl_);
+  }
 
   void Initialize(TF_Status* status) {
-    CurlInitialize();
-    curl_ = curl_easy_init();
+    curl_ = CurlHandlePool::Get()->AcquireEasy();
     if (curl_ == nullptr) {
       TF_SetStatus(status, TF_INTERNAL, "Couldn't initialize a curl session.");
       return;
@@ -88,6 +202,13 @@ class CurlHttpRequest {
       return;
     }
 
+    if ((s = curl_easy_setopt(curl_, CURLOPT_TCP_KEEPALIVE, 1L)) != CURLE_OK) {
+      std::string error_message =
+          absl::StrCat("Unable to set CURLOPT_TCP_KEEPALIVE: ", s);
+      TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
+      return;
+    }
+
     // Do not use signals for timeouts - does not work in multi-threaded
     // programs.
     if ((s = curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L)) != CURLE_OK) {
@@ -157,6 +278,7 @@ class CurlHttpRequest {
       TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
       return;
     }
+    range_start_ = start;
 
     TF_SetStatus(status, TF_OK, "");
   }
@@ -203,16 +325,115 @@ class CurlHttpRequest {
     TF_SetStatus(status, TF_OK, "");
   }
 
+  // Only fetches the headers of the response, with a HEAD request.
+  void SetNoBody(TF_Status* status) {
+    CURLcode s = CURLE_OK;
+    if ((s = curl_easy_setopt(curl_, CURLOPT_NOBODY, 1L)) != CURLE_OK) {
+      std::string error_message =
+          absl::StrCat("Unable to set CURLOPT_NOBODY: ", s);
+      TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
+      return;
+    }
+    TF_SetStatus(status, TF_OK, "");
+  }
+
   size_t GetResultBufferDirectBytesTransferred() {
     return direct_response_.bytes_transferred_;
   }
 
+  uint64_t GetResponseCode() const { return response_code_; }
+
+  uint64_t GetRangeStart() const { return range_start_; }
+
   std::string GetResponseHeader(const std::string& name) {
     const auto& header = response_headers_.find(name);
     return header != response_headers_.end() ? header->second : "";
   }
 
   void Send(TF_Status* status) {
+    Prepare(status);
+    if (TF_GetCode(status) != TF_OK) return;
+    Finish(curl_easy_perform(curl_), status);
+  }
+
+  // Sends all of `requests` concurrently through a multi handle. `status` is
+  // set to the first error, with the messages of any later ones appended.
+  static void SendAll(
+      const std::vector<std::unique_ptr<CurlHttpRequest>>& requests,
+      TF_Status* status) {
+    CURLM* multi = CurlHandlePool::Get()->AcquireMulti();
+    if (multi == nullptr) {
+      TF_SetStatus(status, TF_INTERNAL,
+                   "Couldn't initialize a curl multi session.");
+      return;
+    }
+    TF_SetStatus(status, TF_OK, "");
+    std::vector<CURLcode> results(requests.size(), CURLE_OK);
+    size_t added = 0;
+    for (; added < requests.size(); ++added) {
+      requests[added]->Prepare(status);
+      if (TF_GetCode(status) != TF_OK) break;
+      CURLMcode m = curl_multi_add_handle(multi, requests[added]->curl_);
+      if (m != CURLM_OK) {
+        std::string error_message =
+            absl::StrCat("Unable to add a curl handle (", m,
+                         "): ", curl_multi_strerror(m));
+        TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
+        break;
+      }
+    }
+    if (TF_GetCode(status) == TF_OK) {
+      int running = 0;
+      CURLMcode m;
+      while ((m = curl_multi_perform(multi, &running)) == CURLM_OK &&
+             running > 0) {
+        if ((m = curl_multi_wait(multi, nullptr, 0, 1000, nullptr)) !=
+            CURLM_OK) {
+          break;
+        }
+      }
+      if (m != CURLM_OK) {
+        std::string error_message = absl::StrCat(
+            "Unable to perform (", m, "): ", curl_multi_strerror(m));
+        TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
+      }
+      CURLMsg* message;
+      int queued;
+      while ((message = curl_multi_info_read(multi, &queued)) != nullptr) {
+        if (message->msg != CURLMSG_DONE) continue;
+        for (size_t i = 0; i < requests.size(); ++i) {
+          if (requests[i]->curl_ == message->easy_handle) {
+            results[i] = message->data.result;
+          }
+        }
+      }
+    }
+    for (size_t i = 0; i < added; ++i) {
+      curl_multi_remove_handle(multi, requests[i]->curl_);
+    }
+    CurlHandlePool::Get()->ReleaseMulti(multi);
+    if (TF_GetCode(status) != TF_OK) return;
+    TF_Status* request_status = TF_NewStatus();
+    std::string error_message;
+    for (size_t i = 0; i < requests.size(); ++i) {
+      requests[i]->Finish(results[i], request_status);
+      if (TF_GetCode(request_status) == TF_OK) continue;
+      if (TF_GetCode(status) == TF_OK) {
+        TF_SetStatus(status, TF_GetCode(request_status), "");
+        error_message = TF_Message(request_status);
+      } else {
+        absl::StrAppend(&error_message, "; ", TF_Message(request_status));
+      }
+    }
+    if (TF_GetCode(status) != TF_OK) {
+      TF_SetStatus(status, TF_GetCode(status), error_message.c_str());
+    }
+    TF_DeleteStatus(request_status);
+  }
+
+ private:
+  // Sets the options common to all requests, right before sending them.
+  void Prepare(TF_Status* status) {
     CURLcode s = CURLE_OK;
 
     if (curl_headers_) {
@@ -264,8 +485,8 @@ class CurlHttpRequest {
       return;
     }
 
-    char error_buffer[CURL_ERROR_SIZE] = {0};
-    if ((s = curl_easy_setopt(curl_, CURLOPT_ERRORBUFFER, error_buffer)) !=
+    error_buffer_[0] = '\0';
+    if ((s = curl_easy_setopt(curl_, CURLOPT_ERRORBUFFER, error_buffer_)) !=
         CURLE_OK) {
       std::string error_message =
           absl::StrCat("Unable to set CURLOPT_ERRORBUFFER: ", s);
@@ -273,26 +494,42 @@ class CurlHttpRequest {
       return;
     }
 
-    if ((s = curl_easy_perform(curl_)) != CURLE_OK) {
+    TF_SetStatus(status, TF_OK, "");
+  }
+
+  // Checks the outcome `result` of the transfer and the response code.
+  void Finish(CURLcode result, TF_Status* status) {
+    // The response code is also wanted if the transfer failed, e.g. to tell
+    // that a server ignored the requested range.
+    CURLcode s;
+    if ((s = curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE,
+                               &response_code_)) != CURLE_OK) {
       std::string error_message =
-          absl::StrCat("Unable to perform (", s, "): ", error_buffer);
+          absl::StrCat("Unable to set CURLINFO_RESPONSE_CODE: ", s);
       TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
       return;
     }
 
-    double written_size = 0;
-    if ((s = curl_easy_getinfo(curl_, CURLINFO_SIZE_DOWNLOAD, &written_size)) !=
-        CURLE_OK) {
+    // A server which ignores the Range header sends the whole file. From a
+    // range at the start of the file, the beginning which fits the direct
+    // buffer is all that was asked for, and the rest is dropped.
+    if (result == CURLE_WRITE_ERROR && response_code_ == 200 &&
+        range_start_ == 0 && IsDirectResponse() &&
+        direct_response_.bytes_transferred_ == direct_response_.buffer_size_) {
+      result = CURLE_OK;
+    }
+    if (result != CURLE_OK) {
       std::string error_message =
-          absl::StrCat("Unable to set CURLINFO_SIZE_DOWNLOAD: ", s);
+          absl::StrCat("Unable to perform (", result, "): ", error_buffer_);
       TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
       return;
     }
 
-    if ((s = curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE,
-                               &response_code_)) != CURLE_OK) {
+    double written_size = 0;
+    if ((s = curl_easy_getinfo(curl_, CURLINFO_SIZE_DOWNLOAD, &written_size)) !=
+        CURLE_OK) {
       std::string error_message =
-          absl::StrCat("Unable to set CURLINFO_RESPONSE_CODE: ", s);
+          absl::StrCat("Unable to set CURLINFO_SIZE_DOWNLOAD: ", s);
       TF_SetStatus(status, TF_INTERNAL, error_message.c_str());
       return;
     }
@@ -390,7 +627,6 @@ class CurlHttpRequest {
     }
   }
 
- private:
   std::vector<char> response_buffer_;
 
   struct DirectResponseState {
@@ -402,11 +638,14 @@ class CurlHttpRequest {
   DirectResponseState direct_response_ = {};
 
   CURL* curl_ = nullptr;
+  char error_buffer_[CURL_ERROR_SIZE] = {0};
   curl_slist* curl_headers_ = nullptr;
   curl_slist* resolve_list_ = nullptr;
 
   std::unordered_map<std::string, std::string> response_headers_;
   uint64_t response_code_ = 0;
+  // First byte of the range set by SetRange.
+  uint64_t range_start_ = 0;
 
   std::string uri_;
 
@@ -543,9 +782,85 @@ class CurlHttpRequest {
   }
 };
 
+// Reads are split in ranges of at least `parallel_read_chunk_size` bytes,
+// sent concurrently by up to `parallel_read_max_requests` requests.
+typedef struct HTTPReadOptions {
+  size_t parallel_read_chunk_size;
+  size_t parallel_read_max_requests;
+} HTTPReadOptions;
+
+// Reads up to `n` bytes of `uri` at `offset`. Same as the block fetcher of
+// `RamFileBlockCache`, a short read with `TF_OK` signals the end of the file.
+int64_t ReadRange(const std::string& uri, uint64_t offset, size_t n,
+                  char* buffer, const HTTPReadOptions& options,
+                  TF_Status* status) {
+  size_t count = 1;
+  if (options.parallel_read_chunk_size > 0 &&
+      n >= 2 * options.parallel_read_chunk_size) {
+    count = std::min(options.parallel_read_max_requests,
+                     n / options.parallel_read_chunk_size);
+  }
+  count = std::max<size_t>(count, 1);
+  const size_t part_size = (n + count - 1) / count;
+
+  std::vector<std::unique_ptr<CurlHttpRequest>> requests;
+  std::vector<size_t> sizes;
+  for (size_t start = 0; start < n; start += part_size) {
+    size_t size = std::min(part_size, n - start);
+    auto request = std::make_unique<CurlHttpRequest>();
+    request->Initialize(status);
+    if (TF_GetCode(status) != TF_OK) return -1;
+    request->SetUri(uri, status);
+    if (TF_GetCode(status) != TF_OK) return -1;
+    request->SetRange(offset + start, offset + start + size - 1, status);
+    if (TF_GetCode(status) != TF_OK) return -1;
+    request->SetResultBufferDirect(buffer + start, size, status);
+    if (TF_GetCode(status) != TF_OK) return -1;
+    requests.push_back(std::move(request));
+    sizes.push_back(size);
+  }
+  if (requests.size() == 1) {
+    requests[0]->Send(status);
+  } else {
+    CurlHttpRequest::SendAll(requests, status);
+  }
+
+  // A server which ignores the Range header answers with the whole file (200
+  // instead of 206), which is only right for a range at the start of it.
+  for (const auto& request : requests) {
+    if (request->GetRangeStart() == 0 || request->GetResponseCode() != 200) {
+      continue;
+    }
+    if (requests.size() > 1) {
+      return ReadRange(uri, offset, n, buffer, HTTPReadOptions{0, 1}, status);
+    }
+    std::string error_message = absl::StrCat(
+        "Server ignored the range of a read at offset ", offset, " of ", uri);
+    TF_SetStatus(status, TF_FAILED_PRECONDITION, error_message.c_str());
+    return -1;
+  }
+  if (TF_GetCode(status) != TF_OK) return -1;
+
+  // The data ends at the first short range.
+  size_t bytes_read = 0;
+  for (size_t i = 0; i < requests.size(); ++i) {
+    size_t transferred = requests[i]->GetResultBufferDirectBytesTransferred();
+    bytes_read += transferred;
+    if (transferred < sizes[i]) break;
+  }
+  return bytes_read;
+}
+
 class HTTPRandomAccessFile {
  public:
-  HTTPRandomAccessFile(const std::string& uri) : uri_(uri) {}
+  // `read_cache` is not owned and may be null, in which case reads go straight
+  // to the server. Otherwise `file_size` bounds the reads through the cache.
+  HTTPRandomAccessFile(const std::string& uri, const HTTPReadOptions& options,
+                       RamFileBlockCache* read_cache, uint64_t file_size)
+      : uri_(uri),
+        options_(options),
+        read_cache_(read_cache),
+        file_size_(file_size) {}
   ~HTTPRandomAccessFile() {}
   int64_t Read(uint64_t offset, size_t n, char* buffer,
                TF_Status* status) const {
@@ -555,38 +870,33 @@ class HTTPRandomAccessFile {
       TF_SetStatus(status, TF_OK, "");
       return 0;
     }
-    CurlHttpRequest request;
-    request.Initialize(status);
-    if (TF_GetCode(status) != TF_OK) {
-      return 0;
-    }
-    request.SetUri(uri_, status);
-    if (TF_GetCode(status) != TF_OK) {
-      return 0;
-    }
-    request.SetRange(offset, offset + n - 1, status);
-    if (TF_GetCode(status) != TF_OK) {
-      return 0;
-    }
-    request.SetResultBufferDirect(buffer, n, status);
-    if (TF_GetCode(status) != TF_OK) {
-      return 0;
+    int64_t bytes_read = 0;
+    TF_SetStatus(status, TF_OK, "");
+    if (read_cache_ != nullptr) {
+      if (offset < file_size_) {
+        size_t size = static_cast<size_t>(
+            std::min<uint64_t>(n, file_size_ - offset));
+        bytes_read = read_cache_->Read(uri_, offset, size, buffer, status);
+      }
+    } else {
+      bytes_read = ReadRange(uri_, offset, n, buffer, options_, status);
     }
-    request.Send(status);
-    if (TF_GetCode(status) != TF_OK) {
+    if (TF_GetCode(status) != TF_OK && TF_GetCode(status) != TF_OUT_OF_RANGE) {
       return 0;
     }
-    size_t bytes_to_read = request.GetResultBufferDirectBytesTransferred();
-    if (bytes_to_read < n) {
+    if (static_cast<size_t>(bytes_read) < n) {
       TF_SetStatus(status, TF_OUT_OF_RANGE, "EOF reached");
-      return bytes_to_read;
+      return bytes_read;
     }
     TF_SetStatus(status, TF_OK, "");
-    return bytes_to_read;
+    return bytes_read;
   }
 
  private:
   std::string uri_;
+  HTTPReadOptions options_;
+  RamFileBlockCache* read_cache_;
+  uint64_t file_size_;
 };
 
 // SECTION 1. Implementation for `TF_RandomAccessFile`
@@ -651,16 +961,91 @@ uint64_t Length(const TF_ReadOnlyMemoryRegion* region) { return 0; }
 // ----------------------------------------------------------------------------
 namespace tf_http_filesystem {
 
+constexpr size_t kParallelReadChunkSize = 8 * 1024 * 1024;
+constexpr size_t kParallelReadMaxRequests = 8;
+constexpr size_t kReadCacheBlockSize = 4 * 1024 * 1024;
+
+typedef struct HTTPFileSystem {
+  HTTPReadOptions read_options;
+  // Blocks of files read through random access files, shared by all of them.
+  // Disabled unless HTTP_READ_CACHE_MAX_SIZE_MB is set.
+  std::unique_ptr<RamFileBlockCache> read_cache;
+} HTTPFileSystem;
+
 static void Init(TF_Filesystem* filesystem, TF_Status* status) {
+  auto http_file = new HTTPFileSystem();
+  uint64_t value;
+  http_file->read_options.parallel_read_chunk_size = kParallelReadChunkSize;
+  if (absl::SimpleAtoi(getenv("HTTP_PARALLEL_READ_CHUNK_SIZE_MB"), &value)) {
+    http_file->read_options.parallel_read_chunk_size = value * 1024 * 1024;
+  }
+  http_file->read_options.parallel_read_max_requests = kParallelReadMaxRequests;
+  if (absl::SimpleAtoi(getenv("HTTP_PARALLEL_READ_MAX_REQUESTS"), &value)) {
+    http_file->read_options.parallel_read_max_requests = value;
+  }
+
+  size_t block_size = kReadCacheBlockSize;
+  size_t max_bytes = 0;
+  uint64_t max_staleness = 0;
+  if (absl::SimpleAtoi(getenv("HTTP_READ_CACHE_BLOCK_SIZE_MB"), &value)) {
+    block_size = value * 1024 * 1024;
+  }
+  if (absl::SimpleAtoi(getenv("HTTP_READ_CACHE_MAX_SIZE_MB"), &value)) {
+    max_bytes = value * 1024 * 1024;
+  }
+  if (absl::SimpleAtoi(getenv("HTTP_READ_CACHE_MAX_STALENESS"), &value)) {
+    max_staleness = value;
+  }
+  if (block_size > 0 && max_bytes > 0) {
+    HTTPReadOptions read_options = http_file->read_options;
+    http_file->read_cache = std::make_unique<RamFileBlockCache>(
+        block_size, max_bytes, max_staleness,
+        [read_options](const std::string& filename, size_t offset, size_t n,
+                       char* buffer, TF_Status* status) {
+          return ReadRange(filename, offset, n, buffer, read_options, status);
+        });
+  }
+  filesystem->plugin_filesystem = http_file;
   TF_SetStatus(status, TF_OK, "");
 }
 
-static void Cleanup(TF_Filesystem* filesystem) {}
+static void Cleanup(TF_Filesystem* filesystem) {
+  auto http_file = static_cast<HTTPFileSystem*>(filesystem->plugin_filesystem);
+  delete http_file;
+}
 
 static void NewRandomAccessFile(const TF_Filesystem* filesystem,
                                 const char* path, TF_RandomAccessFile* file,
                                 TF_Status* status) {
-  file->plugin_file = new HTTPRandomAccessFile(path);
+  auto http_file = static_cast<HTTPFileSystem*>(filesystem->plugin_filesystem);
+  RamFileBlockCache* read_cache = http_file->read_cache.get();
+  uint64_t file_size = 0;
+  if (read_cache != nullptr) {
+    // The cache needs the size of the file, and a signature to drop the
+    // blocks of a previous version of it. Without them (e.g. the server does
+    // not answer HEAD requests), the file is read without the cache.
+    CurlHttpRequest request;
+    request.Initialize(status);
+    if (TF_GetCode(status) == TF_OK) request.SetUri(path, status);
+    if (TF_GetCode(status) == TF_OK) request.SetNoBody(status);
+    if (TF_GetCode(status) == TF_OK) request.Send(status);
+    if (TF_GetCode(status) == TF_OK &&
+        absl::SimpleAtoi(request.GetResponseHeader("Content-Length"),
+                         &file_size)) {
+      int64_t signature = static_cast<int64_t>(std::hash<std::string>()(
+          absl::StrCat(request.GetResponseHeader("ETag"), "@",
+                       request.GetResponseHeader("Last-Modified"), "@",
+                       file_size)));
+      read_cache->ValidateAndUpdateFileSignature(path, signature);
+    } else {
+      TF_Log(TF_WARNING, "Reading %s without the cache: %s", path,
+             TF_GetCode(status) == TF_OK ? "no Content-Length"
+                                         : TF_Message(status));
+      read_cache = nullptr;
+    }
+  }
+  file->plugin_file = new HTTPRandomAccessFile(path, http_file->read_options,
+                                               read_cache, file_size);
 
   TF_SetStatus(status, TF_OK, "");
 }
@@ -727,11 +1112,12 @@ static void Stat(const TF_Filesystem* filesystem, const char* path,
   if (TF_GetCode(status) != TF_OK) {
     return;
   }
-  request.SetResultBuffer(status);
+  request.SetUri(path, status);
   if (TF_GetCode(status) != TF_OK) {
     return;
   }
-  request.SetUri(path, status);
+  // Only the headers are needed, not the whole file.
+  request.SetNoBody(status);
   if (TF_GetCode(status) != TF_OK) {
     return;
   }
@@ -755,10 +1141,13 @@ static void Stat(const TF_Filesystem* filesystem, const char* path,
     return;
   }
 
-  std::string last_modified_string = request.GetResponseHeader("Last-Modified");
+  // The modification time is 0 if the server does not report it.
+  time_t last_modified = curl_getdate(
+      request.GetResponseHeader("Last-Modified").c_str(), nullptr);
 
   stats->length = length;
-  stats->mtime_nsec = 0;
+  stats->mtime_nsec =
+      last_modified > 0 ? static_cast<int64_t>(last_modified) * 1000000000 : 0;
   stats->is_directory = false;
   TF_SetStatus(status, TF_OK, "");
 }
@@ -0,0 +1,330 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_io/core/filesystems/ram_file_block_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+namespace tensorflow {
+namespace io {
+
+RamFileBlockCache::RamFileBlockCache(size_t block_size, size_t max_bytes,
+                                     uint64_t max_staleness,
+                                     BlockFetcher block_fetcher,
+                                     ThreadPool* prefetch_pool)
+    : RamFileBlockCache(
+          block_size, max_bytes, max_staleness, std::move(block_fetcher),
+          prefetch_pool == nullptr
+              ? Scheduler()
+              : [prefetch_pool](std::function<void()> fn) {
+                  prefetch_pool->Schedule(std::move(fn));
+                }) {}
+
+RamFileBlockCache::RamFileBlockCache(size_t block_size, size_t max_bytes,
+                                     uint64_t max_staleness,
+                                     BlockFetcher block_fetcher,
+                                     Scheduler prefetch_scheduler)
+    : block_size_(block_size),
+      max_bytes_(max_bytes),
+      max_staleness_(max_staleness),
+      block_fetcher_(std::move(block_fetcher)),
+      prefetch_scheduler_(std::move(prefetch_scheduler)) {}
+
+uint64_t RamFileBlockCache::NowSeconds() const {
+  // Offset by one so that a timestamp of 0 always means "evicted".
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+             .count() +
+         1;
+}
+
+bool RamFileBlockCache::BlockNotStale(const std::shared_ptr<Block>& block) {
+  absl::MutexLock l(&block->mu);
+  if (block->state != FetchState::FINISHED) {
+    return true;  // No need to check for staleness.
+  }
+  if (max_staleness_ == 0) return true;  // Not enforcing staleness.
+  return NowSeconds() - block->timestamp <= max_staleness_;
+}
+
+std::shared_ptr<RamFileBlockCache::Block> RamFileBlockCache::Lookup(
+    const Key& key) {
+  absl::MutexLock lock(&mu_);
+  auto entry = block_map_.find(key);
+  if (entry != block_map_.end()) {
+    if (BlockNotStale(entry->second)) {
+      return entry->second;
+    }
+    // Remove the stale block and continue.
+    RemoveFile_Locked(key.first);
+  }
+
+  auto new_entry = std::make_shared<Block>();
+  lru_list_.push_front(key);
+  new_entry->lru_iterator = lru_list_.begin();
+  new_entry->timestamp = NowSeconds();
+  block_map_.emplace(std::make_pair(key, new_entry));
+  return new_entry;
+}
+
+void RamFileBlockCache::Trim() {
+  while (!lru_list_.empty() && cache_size_ > max_bytes_) {
+    RemoveBlock(block_map_.find(lru_list_.back()));
+  }
+}
+
+void RamFileBlockCache::UpdateLRU(const Key& key,
+                                  const std::shared_ptr<Block>& block,
+                                  TF_Status* status) {
+  absl::MutexLock lock(&mu_);
+  if (block->timestamp == 0) {
+    // The block was evicted from another thread. Allow it to remain evicted.
+    return TF_SetStatus(status, TF_OK, "");
+  }
+  if (block->lru_iterator != lru_list_.begin()) {
+    lru_list_.erase(block->lru_iterator);
+    lru_list_.push_front(key);
+    block->lru_iterator = lru_list_.begin();
+  }
+
+  // If there is a block later in the same file in the cache, and our current
+  // block is not block size, the cache contents are inconsistent.
+  if (block->data.size() < block_size_) {
+    Key fmax = std::make_pair(key.first, std::numeric_limits<size_t>::max());
+    auto fcmp = block_map_.upper_bound(fmax);
+    if (fcmp != block_map_.begin() && key < (--fcmp)->first) {
+      return TF_SetStatus(status, TF_INTERNAL,
+                          "Block cache contents are inconsistent.");
+    }
+  }
+
+  Trim();
+
+  return TF_SetStatus(status, TF_OK, "");
+}
+
+void RamFileBlockCache::MaybeFetch(const Key& key,
+                                   const std::shared_ptr<Block>& block,
+                                   TF_Status* status) {
+  bool downloaded_block = false;
+  {
+    absl::MutexLock l(&block->mu);
+    TF_SetStatus(status, TF_OK, "");
+    bool done = false;
+    while (!done) {
+      switch (block->state) {
+        case FetchState::ERROR:
+        case FetchState::CREATED: {
+          block->state = FetchState::FETCHING;
+          block->mu.Unlock();  // Release the lock while making the API call.
+          block->data.clear();
+          block->data.resize(block_size_, 0);
+          int64_t bytes_transferred = block_fetcher_(
+              key.first, key.second, block_size_, block->data.data(), status);
+          block->mu.Lock();
+          if (TF_GetCode(status) == TF_OK) {
+            block->data.resize(bytes_transferred, 0);
+            // Shrink the data capacity to the actual size used.
+            std::vector<char>(block->data).swap(block->data);
+            downloaded_block = true;
+            block->state = FetchState::FINISHED;
+          } else {
+            block->state = FetchState::ERROR;
+          }
+          block->cond_var.SignalAll();
+          done = true;
+          break;
+        }
+        case FetchState::FETCHING:
+          block->cond_var.WaitWithTimeout(&block->mu, absl::Minutes(1));
+          if (block->state == FetchState::FINISHED) {
+            done = true;
+          }
+          // Re-loop in case of errors.
+          break;
+        case FetchState::FINISHED:
+          done = true;
+          break;
+      }
+    }
+  }
+  // mu_ must not be acquired while holding block->mu.
+  if (downloaded_block) {
+    absl::MutexLock l(&mu_);
+    // Do not update state if the block is already to be evicted.
+    if (block->timestamp != 0) {
+      block->charged_bytes = block->data.capacity();
+      cache_size_ += block->charged_bytes;
+      block->timestamp = NowSeconds();
+    }
+  }
+}
+
+int64_t RamFileBlockCache::Read(const std::string& filename, size_t offset,
+                                size_t n, char* buffer, TF_Status* status) {
+  if (n == 0) {
+    TF_SetStatus(status, TF_OK, "");
+    return 0;
+  }
+  if (!IsCacheEnabled() || (n > max_bytes_)) {
+    // The cache is effectively disabled, so we pass the read through to the
+    // fetcher without breaking it up into blocks.
+    return block_fetcher_(filename, offset, n, buffer, status);
+  }
+  // Calculate the block-aligned start and end of the read.
+  size_t start = block_size_ * (offset / block_size_);
+  size_t finish = block_size_ * ((offset + n) / block_size_);
+  if (finish < offset + n) {
+    finish += block_size_;
+  }
+  size_t total_bytes_transferred = 0;
+  for (size_t pos = start; pos < finish; pos += block_size_) {
+    Key key = std::make_pair(filename, pos);
+    std::shared_ptr<Block> block = Lookup(key);
+    MaybeFetch(key, block, status);
+    if (TF_GetCode(status) != TF_OK) return -1;
+    UpdateLRU(key, block, status);
+    if (TF_GetCode(status) != TF_OK) return -1;
+    // Copy the relevant portion of the block into the result buffer.
+    const auto& data = block->data;
+    if (offset >= pos + data.size()) {
+      std::stringstream os;
+      os << "EOF at offset " << offset << " in file " << filename
+         << " at position " << pos << " with data size " << data.size();
+      TF_SetStatus(status, TF_OUT_OF_RANGE, os.str().c_str());
+      return total_bytes_transferred;
+    }
+    auto begin = data.begin();
+    if (offset > pos) {
+      // The block begins before the slice we're reading.
+      begin += offset - pos;
+    }
+    auto end = data.end();
+    if (pos + data.size() > offset + n) {
+      // The block extends past the end of the slice we're reading.
+      end -= (pos + data.size()) - (offset + n);
+    }
+    if (begin < end) {
+      size_t bytes_to_copy = end - begin;
+      memcpy(&buffer[total_bytes_transferred], &*begin, bytes_to_copy);
+      total_bytes_transferred += bytes_to_copy;
+    }
+    if (data.size() < block_size_) {
+      // The block was a partial block and thus signals EOF at its upper bound.
+      break;
+    }
+  }
+  TF_SetStatus(status, TF_OK, "");
+  return total_bytes_transferred;
+}
+
+void RamFileBlockCache::Prefetch(const std::string& filename, size_t offset,
+                                 size_t n) {
+  if (!IsCacheEnabled() || !prefetch_scheduler_ || n == 0) return;
+  // Never prefetch more than half of the cache, otherwise read-ahead would
+  // evict the blocks that are being read right now.
+  n = std::min(n, max_bytes_ / 2);
+  size_t start = block_size_ * (offset / block_size_);
+  size_t finish = offset + n;
+
+  std::vector<std::pair<Key, std::shared_ptr<Block>>> missing;
+  {
+    absl::MutexLock lock(&mu_);
+    for (size_t pos = start; pos < finish; pos += block_size_) {
+      Key key = std::make_pair(filename, pos);
+      if (block_map_.find(key) != block_map_.end()) continue;
+      auto block = std::make_shared<Block>();
+      lru_list_.push_front(key);
+      block->lru_iterator = lru_list_.begin();
+      block->timestamp = NowSeconds();
+      block_map_.emplace(key, block);
+      missing.emplace_back(std::move(key), std::move(block));
+    }
+  }
+  for (auto& entry : missing) {
+    prefetch_scheduler_([this, entry]() {
+      TF_Status* status = TF_NewStatus();
+      MaybeFetch(entry.first, entry.second, status);
+      if (TF_GetCode(status) == TF_OK) {
+        UpdateLRU(entry.first, entry.second, status);
+      }
+      TF_DeleteStatus(status);
+    });
+  }
+}
+
+bool RamFileBlockCache::ValidateAndUpdateFileSignature(
+    const std::string& filename, int64_t file_signature) {
+  absl::MutexLock lock(&mu_);
+  auto it = file_signature_map_.find(filename);
+  if (it != file_signature_map_.end()) {
+    if (it->second == file_signature) {
+      return true;
+    }
+    // Remove the file from cache if the signatures don't match.
+    RemoveFile_Locked(filename);
+    it->second = file_signature;
+    return false;
+  }
+  file_signature_map_[filename] = file_signature;
+  return true;
+}
+
+size_t RamFileBlockCache::CacheSize() const {
+  absl::MutexLock lock(&mu_);
+  return cache_size_;
+}
+
+void RamFileBlockCache::Flush() {
+  absl::MutexLock lock(&mu_);
+  for (auto& entry : block_map_) {
+    entry.second->timestamp = 0;
+  }
+  block_map_.clear();
+  lru_list_.clear();
+  cache_size_ = 0;
+}
+
+void RamFileBlockCache::RemoveFile(const std::string& filename) {
+  absl::MutexLock lock(&mu_);
+  RemoveFile_Locked(filename);
+  file_signature_map_.erase(filename);
+}
+
+void RamFileBlockCache::RemoveFile_Locked(const std::string& filename) {
+  Key begin = std::make_pair(filename, 0);
+  auto it = block_map_.lower_bound(begin);
+  while (it != block_map_.end() && it->first.first == filename) {
+    auto next = std::next(it);
+    RemoveBlock(it);
+    it = next;
+  }
+}
+
+void RamFileBlockCache::RemoveBlock(BlockMap::iterator entry) {
+  // This signals that the block is removed, and should not be inadvertently
+  // reinserted into the cache in UpdateLRU.
+  entry->second->timestamp = 0;
+  lru_list_.erase(entry->second->lru_iterator);
+  cache_size_ -= entry->second->charged_bytes;
+  block_map_.erase(entry);
+}
+
+}  // namespace io
+}  // namespace tensorflow
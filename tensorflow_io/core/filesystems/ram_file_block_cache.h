@@ -0,0 +1,204 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_IO_CORE_FILESYSTEMS_RAM_FILE_BLOCK_CACHE_H
+#define TENSORFLOW_IO_CORE_FILESYSTEMS_RAM_FILE_BLOCK_CACHE_H
+
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/c/tf_status.h"
+#include "tensorflow_io/core/filesystems/thread_pool.h"
+
+namespace tensorflow {
+namespace io {
+
+/// \brief An LRU block cache of file contents, keyed by {filename, offset}.
+///
+/// This is the plugin-side counterpart of the `RamFileBlockCache` in
+/// `tensorflow_io_gcs_filesystem`. It is meant to be owned by a filesystem and
+/// shared by all of its read-only random access files. Unlike the GCS cache,
+/// stale blocks are dropped lazily on lookup instead of by a pruning thread,
+/// and blocks can be fetched ahead of time with `Prefetch`.
+class RamFileBlockCache {
+ public:
+  /// The callback executed when a block is not found in the cache, and needs
+  /// to be fetched from the backing filesystem. It returns total bytes read
+  /// (-1 in case of errors). The `status` should be `TF_OK` as long as the
+  /// read from the remote filesystem succeeded (similar to the semantics of
+  /// the read(2) system call), a short read signals the end of the file.
+  typedef std::function<int64_t(const std::string& filename, size_t offset,
+                                size_t buffer_size, char* buffer,
+                                TF_Status* status)>
+      BlockFetcher;
+
+  /// Runs a closure asynchronously.
+  typedef std::function<void(std::function<void()>)> Scheduler;
+
+  /// `prefetch_pool` runs the fetches requested through `Prefetch`; it is not
+  /// owned and may be null, in which case `Prefetch` is a no-op.
+  RamFileBlockCache(size_t block_size, size_t max_bytes, uint64_t max_staleness,
+                    BlockFetcher block_fetcher,
+                    ThreadPool* prefetch_pool = nullptr);
+
+  /// Same as above, but the fetches requested through `Prefetch` are run by
+  /// `prefetch_scheduler`, e.g. on an executor the filesystem already owns.
+  /// Closures which are dropped instead of run leave their blocks to be
+  /// fetched by `Read`.
+  RamFileBlockCache(size_t block_size, size_t max_bytes, uint64_t max_staleness,
+                    BlockFetcher block_fetcher, Scheduler prefetch_scheduler);
+
+  /// Read `n` bytes from `filename` starting at `offset` into `buffer`. It
+  /// returns total bytes read (-1 in case of errors). This method will set
+  /// `status` to:
+  ///
+  /// 1) The error from the remote filesystem, if the read from the remote
+  ///    filesystem failed.
+  /// 2) `TF_INTERNAL` if the read returned a partial block, and the cache
+  ///    contained a block at a higher offset (indicating that the partial
+  ///    block should have been a full block).
+  /// 3) `TF_OUT_OF_RANGE` if the file contents do not extend past `offset`.
+  /// 4) `TF_OK` otherwise.
+  ///
+  /// Caller is responsible for allocating memory for `buffer`.
+  int64_t Read(const std::string& filename, size_t offset, size_t n,
+               char* buffer, TF_Status* status) ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Asynchronously fetch the blocks covering `[offset, offset + n)` of
+  /// `filename` that are not cached yet. The caller must not ask for blocks
+  /// past the end of the file, since a cached block at a higher offset than a
+  /// partial block is treated as an inconsistency by `Read`.
+  void Prefetch(const std::string& filename, size_t offset, size_t n)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Validate the given file signature with the existing file signature in
+  /// the cache. Returns true if the signature doesn't change or the file
+  /// doesn't exist before. If the signature changes, update the existing
+  /// signature with the new one and remove the file from cache.
+  bool ValidateAndUpdateFileSignature(const std::string& filename,
+                                      int64_t file_signature)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Remove all cached blocks for `filename`.
+  void RemoveFile(const std::string& filename) ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Remove all cached data.
+  void Flush() ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Accessors for cache parameters.
+  size_t block_size() const { return block_size_; }
+  size_t max_bytes() const { return max_bytes_; }
+  uint64_t max_staleness() const { return max_staleness_; }
+
+  /// The current size (in bytes) of the cache.
+  size_t CacheSize() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Returns true if the cache is enabled. If false, the BlockFetcher callback
+  /// is always executed during Read.
+  bool IsCacheEnabled() const { return block_size_ > 0 && max_bytes_ > 0; }
+
+ private:
+  typedef std::pair<std::string, size_t> Key;
+
+  /// \brief The state of a block.
+  ///
+  /// A block begins in the CREATED stage. The first thread will attempt to
+  /// read the block from the filesystem, transitioning the state of the block
+  /// to FETCHING. After completing, if the read was successful the state
+  /// should be FINISHED. Otherwise the state should be ERROR. A subsequent
+  /// read can re-fetch the block if the state is ERROR.
+  enum class FetchState {
+    CREATED,
+    FETCHING,
+    FINISHED,
+    ERROR,
+  };
+
+  /// \brief A block of a file.
+  ///
+  /// The iterator, timestamp and charged_bytes fields should only be accessed
+  /// while holding mu_. The state variable should only be accessed while
+  /// holding the block's mu lock. The data vector should only be accessed after
+  /// state == FINISHED, and it should never be modified.
+  ///
+  /// In order to prevent deadlocks, never grab mu_ AFTER grabbing any block's
+  /// mu lock.
+  struct Block {
+    std::vector<char> data;
+    std::list<Key>::iterator lru_iterator;
+    /// Seconds (on a monotonic clock) at which the block was cached, 0 once
+    /// the block has been evicted.
+    uint64_t timestamp;
+    /// The number of bytes this block contributes to cache_size_.
+    size_t charged_bytes = 0;
+    absl::Mutex mu;
+    FetchState state ABSL_GUARDED_BY(mu) = FetchState::CREATED;
+    absl::CondVar cond_var;
+  };
+
+  typedef std::map<Key, std::shared_ptr<Block>> BlockMap;
+
+  uint64_t NowSeconds() const;
+
+  bool BlockNotStale(const std::shared_ptr<Block>& block)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  /// Look up a Key in the block cache, inserting an empty block if missing.
+  std::shared_ptr<Block> Lookup(const Key& key) ABSL_LOCKS_EXCLUDED(mu_);
+
+  void MaybeFetch(const Key& key, const std::shared_ptr<Block>& block,
+                  TF_Status* status) ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Trim the block cache to make room for another entry.
+  void Trim() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  /// Update the LRU iterator for the block at `key`.
+  void UpdateLRU(const Key& key, const std::shared_ptr<Block>& block,
+                 TF_Status* status) ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Remove all blocks of a file, with mu_ already held.
+  void RemoveFile_Locked(const std::string& filename)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  /// Remove the block `entry` from the block map and LRU list, and update the
+  /// cache size accordingly.
+  void RemoveBlock(BlockMap::iterator entry) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const size_t block_size_;
+  const size_t max_bytes_;
+  const uint64_t max_staleness_;
+  const BlockFetcher block_fetcher_;
+  const Scheduler prefetch_scheduler_;
+
+  mutable absl::Mutex mu_;
+  BlockMap block_map_ ABSL_GUARDED_BY(mu_);
+  /// The front of the list identifies the most recently accessed block.
+  std::list<Key> lru_list_ ABSL_GUARDED_BY(mu_);
+  /// The combined number of bytes in all of the cached blocks.
+  size_t cache_size_ ABSL_GUARDED_BY(mu_) = 0;
+  std::map<std::string, int64_t> file_signature_map_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_IO_CORE_FILESYSTEMS_RAM_FILE_BLOCK_CACHE_H
@@ -29,10 +29,16 @@ limitations under the License.
 #include <aws/s3/model/HeadBucketRequest.h>
 #include <aws/s3/model/HeadObjectRequest.h>
 #include <aws/s3/model/ListObjectsV2Request.h>
+#include <aws/s3/model/PutObjectRequest.h>
 #include <aws/s3/model/UploadPartCopyRequest.h>
+#include <aws/s3/model/UploadPartRequest.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <functional>
+#include <set>
+
 #include "absl/strings/ascii.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
@@ -49,7 +55,7 @@ namespace s3 {
 constexpr char kS3FileSystemAllocationTag[] = "S3FileSystemAllocation";
 constexpr char kS3ClientAllocationTag[] = "S3ClientAllocation";
 constexpr int64_t kS3TimeoutMsec = 300000;  // 5 min
-constexpr int kS3GetChildrenMaxKeys = 100;
+constexpr int kS3GetChildrenMaxKeys = 1000;
 
 constexpr char kExecutorTag[] = "TransferManagerExecutorAllocation";
 constexpr int kExecutorPoolSize = 25;
@@ -59,8 +65,23 @@ constexpr uint64_t kS3MultiPartDownloadChunkSize = 50 * 1024 * 1024;  // 50 MB
 constexpr size_t kDownloadRetries = 3;
 constexpr size_t kUploadRetries = 3;
 
+// S3 rejects multipart uploads with non-final parts smaller than 5 MB, or with
+// more than 10000 parts.
+constexpr uint64_t kS3MultiPartUploadMinPartSize = 5 * 1024 * 1024;  // 5 MB
+constexpr int kS3MultiPartUploadMaxParts = 10000;
+constexpr size_t kS3StreamingUploadMaxPendingParts = 4;
+
 constexpr size_t kS3ReadAppendableFileBufferSize = 1024 * 1024;  // 1 MB
 
+constexpr uint64_t kS3ReadCacheBlockSizeMB = 4;
+// Disabled unless S3_READ_CACHE_MAX_SIZE_MB is set.
+constexpr uint64_t kS3ReadCacheMaxSizeMB = 0;
+constexpr uint64_t kS3ReadCacheMaxStaleness = 0;
+constexpr uint64_t kS3ReadAheadMaxMB = 32;
+
+constexpr uint64_t kS3StatCacheMaxAge = 5;
+constexpr size_t kS3StatCacheMaxEntries = 16384;
+
 static inline void TF_SetStatusFromAWSError(
     const Aws::Client::AWSError<Aws::S3::S3Errors>& error, TF_Status* status) {
   auto http_code = error.GetResponseCode();
@@ -126,6 +147,29 @@ void ParseS3Path(const Aws::String& fname, bool object_empty_ok,
   }
 }
 
+// The key of an object or directory in the stat cache, "<bucket>/<object>"
+// without the trailing slash of a directory.
+static std::string StatCacheKey(const Aws::String& bucket,
+                                const Aws::String& object) {
+  std::string key = absl::StrCat(bucket.c_str(), "/", object.c_str());
+  if (key.back() == '/') key.pop_back();
+  return key;
+}
+
+// Drops the cached stats of an object which has been modified, and of its
+// parent directories, since whether they exist may depend on it.
+static void InvalidateStats(ExpiringLRUCache<TF_FileStatistics>* stat_cache,
+                            const Aws::String& bucket,
+                            const Aws::String& object) {
+  if (stat_cache == nullptr) return;
+  std::string key = StatCacheKey(bucket, object);
+  size_t bucket_end = bucket.size();
+  while (key.size() > bucket_end) {
+    stat_cache->Delete(key);
+    key.resize(key.rfind('/'));
+  }
+}
+
 static Aws::Client::ClientConfiguration& GetDefaultClientConfig() {
   ABSL_CONST_INIT static absl::Mutex cfg_lock(absl::kConstInit);
   static bool init(false);
@@ -185,9 +229,23 @@ static void GetS3Client(tf_s3_filesystem::S3File* s3_file) {
     int temp_value;
     if (absl::SimpleAtoi(getenv("S3_DISABLE_MULTI_PART_DOWNLOAD"), &temp_value))
       s3_file->use_multi_part_download = (temp_value != 1);
+    if (absl::SimpleAtoi(getenv("S3_STREAMING_UPLOAD"), &temp_value))
+      s3_file->use_streaming_upload = (temp_value == 1);
+    if (!absl::SimpleAtoi(getenv("S3_STREAMING_UPLOAD_MAX_PENDING_PARTS"),
+                          &s3_file->streaming_upload_max_pending_parts))
+      s3_file->streaming_upload_max_pending_parts =
+          kS3StreamingUploadMaxPendingParts;
 
     const char* endpoint = getenv("S3_ENDPOINT");
     if (endpoint) s3_file->s3_client->OverrideEndpoint(endpoint);
+
+    uint64_t max_age, max_entries;
+    if (!absl::SimpleAtoi(getenv("S3_STAT_CACHE_MAX_AGE"), &max_age))
+      max_age = kS3StatCacheMaxAge;
+    if (!absl::SimpleAtoi(getenv("S3_STAT_CACHE_MAX_ENTRIES"), &max_entries))
+      max_entries = kS3StatCacheMaxEntries;
+    s3_file->stat_cache.reset(
+        new ExpiringLRUCache<TF_FileStatistics>(max_age, max_entries));
   }
 }
 
@@ -242,6 +300,36 @@ typedef struct S3File {
   std::shared_ptr<Aws::S3::S3Client> s3_client;
   std::shared_ptr<Aws::Transfer::TransferManager> transfer_manager;
   bool use_multi_part_download;
+
+  // The block cache of the filesystem, where blocks are keyed by `path`, or
+  // `nullptr` if the object is read directly. The cache is only used when
+  // the size and signature of the object are known from opening it.
+  RamFileBlockCache* read_cache;
+  std::string path;
+  uint64_t file_size;
+  uint64_t read_ahead_max;
+
+  // Sequential access detection for read-ahead. The window doubles on every
+  // read which starts where the previous one ended, up to `read_ahead_max`,
+  // and collapses on a random access.
+  absl::Mutex mu;
+  uint64_t next_offset ABSL_GUARDED_BY(mu);
+  uint64_t read_ahead ABSL_GUARDED_BY(mu);
+
+  S3File(Aws::String bucket, Aws::String object,
+         std::shared_ptr<Aws::S3::S3Client> s3_client,
+         std::shared_ptr<Aws::Transfer::TransferManager> transfer_manager,
+         bool use_multi_part_download)
+      : bucket(bucket),
+        object(object),
+        s3_client(s3_client),
+        transfer_manager(transfer_manager),
+        use_multi_part_download(use_multi_part_download),
+        read_cache(nullptr),
+        file_size(0),
+        read_ahead_max(0),
+        next_offset(0),
+        read_ahead(0) {}
 } S3File;
 
 // AWS Streams destroy the buffer (buf) passed, so creating a new
@@ -324,15 +412,68 @@ static int64_t ReadS3TransferManager(S3File* s3_file, uint64_t offset, size_t n,
   return read;
 }
 
+static int64_t ReadS3Object(S3File* s3_file, uint64_t offset, size_t n,
+                            char* buffer, TF_Status* status) {
+  if (s3_file->use_multi_part_download)
+    return ReadS3TransferManager(s3_file, offset, n, buffer, status);
+  else
+    return ReadS3Client(s3_file, offset, n, buffer, status);
+}
+
+static void MaybeReadAhead(S3File* s3_file, uint64_t offset, size_t read) {
+  size_t block_size = s3_file->read_cache->block_size();
+  uint64_t window;
+  {
+    absl::MutexLock l(&s3_file->mu);
+    if (offset == s3_file->next_offset) {
+      s3_file->read_ahead =
+          std::min<uint64_t>(std::max<uint64_t>(s3_file->read_ahead * 2,
+                                                block_size),
+                             s3_file->read_ahead_max);
+    } else {
+      s3_file->read_ahead = 0;
+    }
+    s3_file->next_offset = offset + read;
+    window = s3_file->read_ahead;
+  }
+  uint64_t start = offset + read;
+  if (window == 0 || start >= s3_file->file_size) return;
+  s3_file->read_cache->Prefetch(
+      s3_file->path, start, std::min(window, s3_file->file_size - start));
+}
+
+static int64_t ReadS3Cache(S3File* s3_file, uint64_t offset, size_t n,
+                           char* buffer, TF_Status* status) {
+  if (offset >= s3_file->file_size) {
+    TF_SetStatus(status, TF_OUT_OF_RANGE, "Read past the end of file");
+    return 0;
+  }
+  // The cache must not be asked for blocks past the end of the object.
+  size_t length = std::min<uint64_t>(n, s3_file->file_size - offset);
+  auto read_cache = s3_file->read_cache;
+  if (length > read_cache->max_bytes())
+    return ReadS3Object(s3_file, offset, n, buffer, status);
+
+  // The blocks of a read spanning several of them are fetched concurrently.
+  if (length > read_cache->block_size())
+    read_cache->Prefetch(s3_file->path, offset, length);
+  int64_t read =
+      read_cache->Read(s3_file->path, offset, length, buffer, status);
+  if (TF_GetCode(status) != TF_OK) return read;
+  if (read > 0) MaybeReadAhead(s3_file, offset, read);
+  if (static_cast<size_t>(read) < n)
+    TF_SetStatus(status, TF_OUT_OF_RANGE, "Read less bytes than requested");
+  return read;
+}
+
 int64_t Read(const TF_RandomAccessFile* file, uint64_t offset, size_t n,
              char* buffer, TF_Status* status) {
   auto s3_file = static_cast<S3File*>(file->plugin_file);
   TF_VLog(1, "ReadFilefromS3 s3://%s/%s from %u for n: %u\n",
           s3_file->bucket.c_str(), s3_file->object.c_str(), offset, n);
-  if (s3_file->use_multi_part_download)
-    return ReadS3TransferManager(s3_file, offset, n, buffer, status);
-  else
-    return ReadS3Client(s3_file, offset, n, buffer, status);
+  if (s3_file->read_cache != nullptr)
+    return ReadS3Cache(s3_file, offset, n, buffer, status);
+  return ReadS3Object(s3_file, offset, n, buffer, status);
 }
 
 }  // namespace tf_random_access_file
@@ -340,6 +481,58 @@ int64_t Read(const TF_RandomAccessFile* file, uint64_t offset, size_t n,
 // SECTION 2. Implementation for `TF_WritableFile`
 // ----------------------------------------------------------------------------
 namespace tf_writable_file {
+// A multipart upload which sends every part as soon as it is filled, instead
+// of uploading a local temporary file on `Sync`. Parts are uploaded
+// concurrently on the executor of the filesystem; `Append` blocks while
+// `max_pending_parts` of them are in flight, which bounds the memory of the
+// file to `(max_pending_parts + 1) * part_size`. The object only becomes
+// visible on `Close`, and is never created if the file is discarded without
+// being closed. Objects smaller than one part are sent with a single
+// `PutObject`.
+typedef struct StreamingUpload {
+  Aws::String bucket;
+  Aws::String object;
+  std::shared_ptr<Aws::S3::S3Client> s3_client;
+  Aws::Utils::Threading::PooledThreadExecutor* executor;
+  uint64_t part_size;
+  size_t max_pending_parts;
+
+  // The part being filled, and the number of bytes appended so far.
+  std::string part;
+  uint64_t position;
+  // Empty until the first part is sent.
+  Aws::String upload_id;
+  int next_part_number;
+  bool closed;
+
+  absl::Mutex mu;
+  absl::CondVar cv;
+  size_t pending_parts ABSL_GUARDED_BY(mu);
+  // ETags of the uploaded parts by part number.
+  Aws::Map<int, Aws::String> etags ABSL_GUARDED_BY(mu);
+  // Buffers of uploaded parts, reused for the next ones.
+  std::vector<std::string> free_parts ABSL_GUARDED_BY(mu);
+  // The first error of a part upload, reported by the next call.
+  TF_Code error_code ABSL_GUARDED_BY(mu);
+  std::string error_message ABSL_GUARDED_BY(mu);
+
+  StreamingUpload(Aws::String bucket, Aws::String object,
+                  std::shared_ptr<Aws::S3::S3Client> s3_client,
+                  Aws::Utils::Threading::PooledThreadExecutor* executor,
+                  uint64_t part_size, size_t max_pending_parts)
+      : bucket(bucket),
+        object(object),
+        s3_client(s3_client),
+        executor(executor),
+        part_size(std::max(part_size, kS3MultiPartUploadMinPartSize)),
+        max_pending_parts(std::max<size_t>(max_pending_parts, 1)),
+        position(0),
+        next_part_number(1),
+        closed(false),
+        pending_parts(0),
+        error_code(TF_OK) {}
+} StreamingUpload;
+
 typedef struct S3File {
   Aws::String bucket;
   Aws::String object;
@@ -347,6 +540,10 @@ typedef struct S3File {
   std::shared_ptr<Aws::Transfer::TransferManager> transfer_manager;
   bool sync_needed;
   std::shared_ptr<Aws::Utils::TempFile> outfile;
+  // Set instead of `outfile` in streaming mode.
+  std::unique_ptr<StreamingUpload> streaming;
+  // The stat cache of the filesystem, invalidated on upload.
+  ExpiringLRUCache<TF_FileStatistics>* stat_cache = nullptr;
   S3File(Aws::String bucket, Aws::String object,
          std::shared_ptr<Aws::S3::S3Client> s3_client,
          std::shared_ptr<Aws::Transfer::TransferManager> transfer_manager)
@@ -367,16 +564,233 @@ typedef struct S3File {
             std::ios_base::binary | std::ios_base::trunc | std::ios_base::in |
                 std::ios_base::out)) {
   }
+  S3File(std::unique_ptr<StreamingUpload> streaming)
+      : bucket(streaming->bucket),
+        object(streaming->object),
+        s3_client(streaming->s3_client),
+        sync_needed(false),
+        streaming(std::move(streaming)) {}
 } S3File;
 
+static void SetStreamingStatus(StreamingUpload* upload, TF_Status* status)
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(upload->mu) {
+  TF_SetStatus(status, upload->error_code, upload->error_message.c_str());
+}
+
+static void UploadPart(StreamingUpload* upload, int part_number,
+                       std::shared_ptr<std::string> data) {
+  Aws::S3::Model::UploadPartOutcome outcome;
+  size_t retries = 0;
+  do {
+    if (retries > 0)
+      TF_VLog(1,
+              "Retrying upload of part %d of s3://%s/%s after failure. "
+              "Current retry count: %u\n",
+              part_number, upload->bucket.c_str(), upload->object.c_str(),
+              retries);
+    // A retry needs a new stream, since the previous one has been consumed.
+    auto stream_buf =
+        Aws::MakeShared<Aws::Utils::Stream::PreallocatedStreamBuf>(
+            "S3StreamBuf", reinterpret_cast<unsigned char*>(&(*data)[0]),
+            data->size());
+    Aws::S3::Model::UploadPartRequest request;
+    request.WithBucket(upload->bucket)
+        .WithKey(upload->object)
+        .WithUploadId(upload->upload_id)
+        .WithPartNumber(part_number)
+        .WithContentLength(data->size());
+    request.SetBody(
+        Aws::MakeShared<tf_random_access_file::TFS3UnderlyingStream>(
+            "S3WriteStream", stream_buf.get()));
+    outcome = upload->s3_client->UploadPart(request);
+  } while (!outcome.IsSuccess() && retries++ < kUploadRetries);
+
+  absl::MutexLock l(&upload->mu);
+  if (outcome.IsSuccess()) {
+    upload->etags[part_number] = outcome.GetResult().GetETag();
+  } else if (upload->error_code == TF_OK) {
+    TF_Status* status = TF_NewStatus();
+    TF_SetStatusFromAWSError(outcome.GetError(), status);
+    upload->error_code = TF_GetCode(status);
+    upload->error_message = TF_Message(status);
+    TF_DeleteStatus(status);
+  }
+  data->clear();
+  upload->free_parts.push_back(std::move(*data));
+  upload->pending_parts--;
+  upload->cv.SignalAll();
+}
+
+// Hands the filled part to the executor, after starting the multipart upload
+// if this is the first part.
+static void SendPart(StreamingUpload* upload, TF_Status* status) {
+  if (upload->upload_id.empty()) {
+    Aws::S3::Model::CreateMultipartUploadRequest request;
+    request.WithBucket(upload->bucket)
+        .WithKey(upload->object)
+        .WithContentType("application/octet-stream");
+    auto outcome = upload->s3_client->CreateMultipartUpload(request);
+    if (!outcome.IsSuccess())
+      return TF_SetStatusFromAWSError(outcome.GetError(), status);
+    upload->upload_id = outcome.GetResult().GetUploadId();
+  }
+  if (upload->next_part_number > kS3MultiPartUploadMaxParts)
+    return TF_SetStatus(
+        status, TF_UNIMPLEMENTED,
+        absl::StrCat("Streaming upload of s3://", upload->bucket.c_str(), "/",
+                     upload->object.c_str(), " needs more than ",
+                     kS3MultiPartUploadMaxParts, " parts of size ",
+                     upload->part_size,
+                     ". You can control this part size using the environment "
+                     "variable S3_MULTI_PART_UPLOAD_CHUNK_SIZE to increase it.")
+            .c_str());
+
+  std::string next;
+  {
+    absl::MutexLock l(&upload->mu);
+    while (upload->pending_parts >= upload->max_pending_parts)
+      upload->cv.Wait(&upload->mu);
+    if (upload->error_code != TF_OK) return SetStreamingStatus(upload, status);
+    upload->pending_parts++;
+    if (!upload->free_parts.empty()) {
+      next = std::move(upload->free_parts.back());
+      upload->free_parts.pop_back();
+    }
+  }
+  auto data = std::make_shared<std::string>(std::move(upload->part));
+  upload->part = std::move(next);
+  int part_number = upload->next_part_number++;
+  upload->executor->Submit([upload, part_number, data]() {
+    UploadPart(upload, part_number, data);
+  });
+  TF_SetStatus(status, TF_OK, "");
+}
+
+static void WaitForParts(StreamingUpload* upload) {
+  absl::MutexLock l(&upload->mu);
+  while (upload->pending_parts > 0) upload->cv.Wait(&upload->mu);
+}
+
+static void AbortStreamingUpload(StreamingUpload* upload) {
+  WaitForParts(upload);
+  if (upload->upload_id.empty()) return;
+  Aws::S3::Model::AbortMultipartUploadRequest request;
+  request.WithBucket(upload->bucket)
+      .WithKey(upload->object)
+      .WithUploadId(upload->upload_id);
+  auto outcome = upload->s3_client->AbortMultipartUpload(request);
+  if (!outcome.IsSuccess())
+    TF_Log(TF_WARNING, "Could not abort the upload of s3://%s/%s: %s\n",
+           upload->bucket.c_str(), upload->object.c_str(),
+           outcome.GetError().GetMessage().c_str());
+  upload->upload_id.clear();
+}
+
+static void StreamingAppend(StreamingUpload* upload, const char* buffer,
+                            size_t n, TF_Status* status) {
+  if (upload->closed)
+    return TF_SetStatus(status, TF_FAILED_PRECONDITION,
+                        "The streaming upload is already closed.");
+  {
+    absl::MutexLock l(&upload->mu);
+    if (upload->error_code != TF_OK) return SetStreamingStatus(upload, status);
+  }
+  upload->position += n;
+  while (n > 0) {
+    if (upload->part.capacity() < upload->part_size)
+      upload->part.reserve(upload->part_size);
+    size_t copy =
+        std::min<uint64_t>(n, upload->part_size - upload->part.size());
+    upload->part.append(buffer, copy);
+    buffer += copy;
+    n -= copy;
+    if (upload->part.size() == upload->part_size) {
+      SendPart(upload, status);
+      if (TF_GetCode(status) != TF_OK) return;
+    }
+  }
+  TF_SetStatus(status, TF_OK, "");
+}
+
+static void StreamingClose(StreamingUpload* upload, TF_Status* status) {
+  if (upload->closed) return TF_SetStatus(status, TF_OK, "");
+  upload->closed = true;
+  TF_VLog(1, "WriteFileToS3: s3://%s/%s\n", upload->bucket.c_str(),
+          upload->object.c_str());
+
+  if (upload->upload_id.empty()) {
+    size_t retries = 0;
+    Aws::S3::Model::PutObjectOutcome outcome;
+    do {
+      auto stream_buf =
+          Aws::MakeShared<Aws::Utils::Stream::PreallocatedStreamBuf>(
+              "S3StreamBuf",
+              reinterpret_cast<unsigned char*>(&upload->part[0]),
+              upload->part.size());
+      Aws::S3::Model::PutObjectRequest request;
+      request.WithBucket(upload->bucket)
+          .WithKey(upload->object)
+          .WithContentType("application/octet-stream")
+          .WithContentLength(upload->part.size());
+      request.SetBody(
+          Aws::MakeShared<tf_random_access_file::TFS3UnderlyingStream>(
+              "S3WriteStream", stream_buf.get()));
+      outcome = upload->s3_client->PutObject(request);
+    } while (!outcome.IsSuccess() && retries++ < kUploadRetries);
+    std::string().swap(upload->part);
+    if (!outcome.IsSuccess())
+      return TF_SetStatusFromAWSError(outcome.GetError(), status);
+    return TF_SetStatus(status, TF_OK, "");
+  }
+
+  if (!upload->part.empty()) {
+    SendPart(upload, status);
+    if (TF_GetCode(status) != TF_OK) return AbortStreamingUpload(upload);
+  }
+  WaitForParts(upload);
+  Aws::S3::Model::CompletedMultipartUpload completed_multipart_upload;
+  {
+    absl::MutexLock l(&upload->mu);
+    upload->free_parts.clear();
+    if (upload->error_code != TF_OK) {
+      SetStreamingStatus(upload, status);
+    } else {
+      for (const auto& etag : upload->etags) {
+        Aws::S3::Model::CompletedPart completed_part;
+        completed_part.SetPartNumber(etag.first);
+        completed_part.SetETag(etag.second);
+        completed_multipart_upload.AddParts(completed_part);
+      }
+    }
+  }
+  if (TF_GetCode(status) != TF_OK) return AbortStreamingUpload(upload);
+
+  Aws::S3::Model::CompleteMultipartUploadRequest request;
+  request.WithBucket(upload->bucket)
+      .WithKey(upload->object)
+      .WithUploadId(upload->upload_id)
+      .WithMultipartUpload(completed_multipart_upload);
+  auto outcome = upload->s3_client->CompleteMultipartUpload(request);
+  if (!outcome.IsSuccess()) {
+    TF_SetStatusFromAWSError(outcome.GetError(), status);
+    return AbortStreamingUpload(upload);
+  }
+  upload->upload_id.clear();
+  TF_SetStatus(status, TF_OK, "");
+}
+
 void Cleanup(TF_WritableFile* file) {
   auto s3_file = static_cast<S3File*>(file->plugin_file);
+  // A streaming upload which was not closed is discarded.
+  if (s3_file->streaming) AbortStreamingUpload(s3_file->streaming.get());
   delete s3_file;
 }
 
 void Append(const TF_WritableFile* file, const char* buffer, size_t n,
             TF_Status* status) {
   auto s3_file = static_cast<S3File*>(file->plugin_file);
+  if (s3_file->streaming)
+    return StreamingAppend(s3_file->streaming.get(), buffer, n, status);
   if (!s3_file->outfile) {
     TF_SetStatus(status, TF_FAILED_PRECONDITION,
                  "The internal temporary file is not writable.");
@@ -393,6 +807,10 @@ void Append(const TF_WritableFile* file, const char* buffer, size_t n,
 
 int64_t Tell(const TF_WritableFile* file, TF_Status* status) {
   auto s3_file = static_cast<S3File*>(file->plugin_file);
+  if (s3_file->streaming) {
+    TF_SetStatus(status, TF_OK, "");
+    return static_cast<int64_t>(s3_file->streaming->position);
+  }
   auto position = static_cast<int64_t>(s3_file->outfile->tellp());
   if (position == -1)
     TF_SetStatus(status, TF_INTERNAL,
@@ -404,6 +822,14 @@ int64_t Tell(const TF_WritableFile* file, TF_Status* status) {
 
 void Sync(const TF_WritableFile* file, TF_Status* status) {
   auto s3_file = static_cast<S3File*>(file->plugin_file);
+  if (s3_file->streaming) {
+    // Parts only become visible on `Close`, so this only waits for the parts
+    // in flight and reports their errors.
+    auto upload = s3_file->streaming.get();
+    WaitForParts(upload);
+    absl::MutexLock l(&upload->mu);
+    return SetStreamingStatus(upload, status);
+  }
   if (!s3_file->outfile) {
     TF_SetStatus(status, TF_FAILED_PRECONDITION,
                  "The internal temporary file is not writable.");
@@ -436,6 +862,7 @@ void Sync(const TF_WritableFile* file, TF_Status* status) {
   }
   if (handle->GetStatus() != Aws::Transfer::TransferStatus::COMPLETED)
     return TF_SetStatusFromAWSError(handle->GetLastError(), status);
+  InvalidateStats(s3_file->stat_cache, s3_file->bucket, s3_file->object);
   s3_file->outfile->clear();
   s3_file->outfile->seekp(position);
   s3_file->sync_needed = false;
@@ -448,6 +875,11 @@ void Flush(const TF_WritableFile* file, TF_Status* status) {
 
 void Close(const TF_WritableFile* file, TF_Status* status) {
   auto s3_file = static_cast<S3File*>(file->plugin_file);
+  if (s3_file->streaming) {
+    StreamingClose(s3_file->streaming.get(), status);
+    InvalidateStats(s3_file->stat_cache, s3_file->bucket, s3_file->object);
+    return;
+  }
   if (s3_file->outfile) {
     Sync(file, status);
     if (TF_GetCode(status) != TF_OK) return;
@@ -487,11 +919,15 @@ uint64_t Length(const TF_ReadOnlyMemoryRegion* region) {
 // ----------------------------------------------------------------------------
 namespace tf_s3_filesystem {
 S3File::S3File()
-    : s3_client(nullptr),
+    : read_cache(nullptr),
+      read_ahead_max(0),
+      s3_client(nullptr),
       executor(nullptr),
       transfer_managers(),
       multi_part_chunk_sizes(),
       use_multi_part_download(true),
+      use_streaming_upload(false),
+      streaming_upload_max_pending_parts(kS3StreamingUploadMaxPendingParts),
       initialization_lock() {}
 void Init(TF_Filesystem* filesystem, TF_Status* status) {
   filesystem->plugin_filesystem = new S3File();
@@ -503,6 +939,56 @@ void Cleanup(TF_Filesystem* filesystem) {
   delete s3_file;
 }
 
+static void GetReadCache(S3File* s3_file) {
+  // These functions should be called before holding `initialization_lock`.
+  GetS3Client(s3_file);
+  GetExecutor(s3_file);
+
+  absl::MutexLock l(&s3_file->initialization_lock);
+
+  if (s3_file->read_cache.get() == nullptr) {
+    uint64_t block_size, max_bytes, max_staleness, read_ahead_max;
+    if (!absl::SimpleAtoi(getenv("S3_READ_CACHE_BLOCK_SIZE_MB"), &block_size))
+      block_size = kS3ReadCacheBlockSizeMB;
+    if (!absl::SimpleAtoi(getenv("S3_READ_CACHE_MAX_SIZE_MB"), &max_bytes))
+      max_bytes = kS3ReadCacheMaxSizeMB;
+    if (!absl::SimpleAtoi(getenv("S3_READ_CACHE_MAX_STALENESS"),
+                          &max_staleness))
+      max_staleness = kS3ReadCacheMaxStaleness;
+    if (!absl::SimpleAtoi(getenv("S3_READ_AHEAD_MAX_MB"), &read_ahead_max))
+      read_ahead_max = kS3ReadAheadMaxMB;
+    s3_file->read_ahead_max = read_ahead_max << 20;
+
+    // Blocks are always fetched with a single ranged GET on the calling
+    // thread: a fetch may run on `executor`, and waiting there for a
+    // `TransferManager` download scheduled on the same executor could starve
+    // it.
+    auto s3_client = s3_file->s3_client;
+    auto executor = s3_file->executor.get();
+    s3_file->read_cache.reset(new RamFileBlockCache(
+        block_size << 20, max_bytes << 20, max_staleness,
+        [s3_client](const std::string& filename, size_t offset, size_t n,
+                    char* buffer, TF_Status* status) -> int64_t {
+          Aws::String bucket, object;
+          ParseS3Path(filename, false, &bucket, &object, status);
+          if (TF_GetCode(status) != TF_OK) return -1;
+          tf_random_access_file::S3File object_file(bucket, object, s3_client,
+                                                    nullptr, false);
+          int64_t read = tf_random_access_file::ReadS3Client(
+              &object_file, offset, n, buffer, status);
+          // A short read only marks the end of the object for the cache.
+          if (TF_GetCode(status) == TF_OUT_OF_RANGE) {
+            TF_SetStatus(status, TF_OK, "");
+            return read > 0 ? read : 0;
+          }
+          return read;
+        },
+        [executor](std::function<void()> fn) {
+          executor->Submit(std::move(fn));
+        }));
+  }
+}
+
 void NewRandomAccessFile(const TF_Filesystem* filesystem, const char* path,
                          TF_RandomAccessFile* file, TF_Status* status) {
   Aws::String bucket, object;
@@ -512,11 +998,55 @@ void NewRandomAccessFile(const TF_Filesystem* filesystem, const char* path,
   auto s3_file = static_cast<S3File*>(filesystem->plugin_filesystem);
   GetS3Client(s3_file);
   GetTransferManager(Aws::Transfer::TransferDirection::DOWNLOAD, s3_file);
-  file->plugin_file = new tf_random_access_file::S3File(
-      {bucket, object, s3_file->s3_client,
-       s3_file->transfer_managers[Aws::Transfer::TransferDirection::DOWNLOAD],
-       s3_file->use_multi_part_download});
+  GetReadCache(s3_file);
+  auto s3_random_access_file = new tf_random_access_file::S3File(
+      bucket, object, s3_file->s3_client,
+      s3_file->transfer_managers[Aws::Transfer::TransferDirection::DOWNLOAD],
+      s3_file->use_multi_part_download);
+  file->plugin_file = s3_random_access_file;
   TF_SetStatus(status, TF_OK, "");
+  if (!s3_file->read_cache->IsCacheEnabled()) return;
+
+  // The cache needs the size of the object, and a signature to drop the
+  // blocks of a previous version of it. If the object can not be inspected,
+  // it is read directly and errors are reported on read.
+  Aws::S3::Model::HeadObjectRequest head_object_request;
+  head_object_request.WithBucket(bucket).WithKey(object);
+  head_object_request.SetResponseStreamFactory(
+      []() { return Aws::New<Aws::StringStream>(kS3FileSystemAllocationTag); });
+  auto head_object_outcome =
+      s3_file->s3_client->HeadObject(head_object_request);
+  if (!head_object_outcome.IsSuccess()) return;
+  const auto& result = head_object_outcome.GetResult();
+  int64_t signature = static_cast<int64_t>(std::hash<std::string>()(
+      absl::StrCat(result.GetETag().c_str(), "@",
+                   result.GetLastModified().Millis(), "@",
+                   result.GetContentLength())));
+  s3_random_access_file->path = path;
+  s3_random_access_file->file_size = result.GetContentLength();
+  s3_random_access_file->read_ahead_max = s3_file->read_ahead_max;
+  s3_file->read_cache->ValidateAndUpdateFileSignature(path, signature);
+  s3_random_access_file->read_cache = s3_file->read_cache.get();
+}
+
+static tf_writable_file::S3File* NewS3WritableFile(S3File* s3_file,
+                                                   const Aws::String& bucket,
+                                                   const Aws::String& object) {
+  tf_writable_file::S3File* writable_file;
+  if (s3_file->use_streaming_upload)
+    writable_file = new tf_writable_file::S3File(
+        std::unique_ptr<tf_writable_file::StreamingUpload>(
+            new tf_writable_file::StreamingUpload(
+                bucket, object, s3_file->s3_client, s3_file->executor.get(),
+                s3_file->multi_part_chunk_sizes
+                    [Aws::Transfer::TransferDirection::UPLOAD],
+                s3_file->streaming_upload_max_pending_parts)));
+  else
+    writable_file = new tf_writable_file::S3File(
+        bucket, object, s3_file->s3_client,
+        s3_file->transfer_managers[Aws::Transfer::TransferDirection::UPLOAD]);
+  writable_file->stat_cache = s3_file->stat_cache.get();
+  return writable_file;
 }
 
 void NewWritableFile(const TF_Filesystem* filesystem, const char* path,
@@ -528,9 +1058,7 @@ void NewWritableFile(const TF_Filesystem* filesystem, const char* path,
   auto s3_file = static_cast<S3File*>(filesystem->plugin_filesystem);
   GetS3Client(s3_file);
   GetTransferManager(Aws::Transfer::TransferDirection::UPLOAD, s3_file);
-  file->plugin_file = new tf_writable_file::S3File(
-      bucket, object, s3_file->s3_client,
-      s3_file->transfer_managers[Aws::Transfer::TransferDirection::UPLOAD]);
+  file->plugin_file = NewS3WritableFile(s3_file, bucket, object);
   TF_SetStatus(status, TF_OK, "");
 }
 
@@ -554,9 +1082,7 @@ void NewAppendableFile(const TF_Filesystem* filesystem, const char* path,
           tf_writable_file::Cleanup(file);
         }
       });
-  writer->plugin_file = new tf_writable_file::S3File(
-      bucket, object, s3_file->s3_client,
-      s3_file->transfer_managers[Aws::Transfer::TransferDirection::UPLOAD]);
+  writer->plugin_file = NewS3WritableFile(s3_file, bucket, object);
   TF_SetStatus(status, TF_OK, "");
 
   // Wraping inside a `std::unique_ptr` to prevent memory-leaking.
@@ -621,6 +1147,12 @@ void Stat(const TF_Filesystem* filesystem, const char* path,
     return TF_SetStatus(status, TF_OK, "");
   }
 
+  // A path with a trailing slash can only be a directory.
+  std::string key = StatCacheKey(bucket, object);
+  if (s3_file->stat_cache->Lookup(key, stats) &&
+      (object.back() != '/' || stats->is_directory))
+    return TF_SetStatus(status, TF_OK, "");
+
   bool found = false;
   Aws::S3::Model::HeadObjectRequest head_object_request;
   head_object_request.WithBucket(bucket).WithKey(object);
@@ -665,6 +1197,7 @@ void Stat(const TF_Filesystem* filesystem, const char* path,
     return TF_SetStatus(
         status, TF_NOT_FOUND,
         absl::StrCat("Object ", path, " does not exist").c_str());
+  s3_file->stat_cache->Insert(key, *stats);
   TF_SetStatus(status, TF_OK, "");
 }
 
@@ -961,6 +1494,7 @@ void CopyFile(const TF_Filesystem* filesystem, const char* src, const char* dst,
   else
     MultiPartCopy(copy_src, bucket_dst, object_dst, num_parts, file_size,
                   s3_file, status);
+  InvalidateStats(s3_file->stat_cache.get(), bucket_dst, object_dst);
 }
 
 void DeleteFile(const TF_Filesystem* filesystem, const char* path,
@@ -976,6 +1510,7 @@ void DeleteFile(const TF_Filesystem* filesystem, const char* path,
   delete_object_request.WithBucket(bucket).WithKey(object);
   auto delete_object_outcome =
       s3_file->s3_client->DeleteObject(delete_object_request);
+  InvalidateStats(s3_file->stat_cache.get(), bucket, object);
   if (!delete_object_outcome.IsSuccess())
     TF_SetStatusFromAWSError(delete_object_outcome.GetError(), status);
   else
@@ -1019,6 +1554,7 @@ void CreateDir(const TF_Filesystem* filesystem, const char* path,
     NewWritableFile(filesystem, dir_path.c_str(), file.get(), status);
     if (TF_GetCode(status) != TF_OK) return;
     tf_writable_file::Close(file.get(), status);
+    InvalidateStats(s3_file->stat_cache.get(), bucket, object);
     if (TF_GetCode(status) != TF_OK) return;
   }
   TF_SetStatus(status, TF_OK, "");
@@ -1058,6 +1594,7 @@ void DeleteDir(const TF_Filesystem* filesystem, const char* path,
       Aws::String dir_path = path;
       if (dir_path.back() != '/') dir_path.push_back('/');
       DeleteFile(filesystem, dir_path.c_str(), status);
+      InvalidateStats(s3_file->stat_cache.get(), bucket, object);
     }
   } else {
     TF_SetStatusFromAWSError(list_objects_outcome.GetError(), status);
@@ -1116,6 +1653,7 @@ void RenameFile(const TF_Filesystem* filesystem, const char* src,
       delete_object_request.WithBucket(bucket_src).WithKey(key_src);
       auto delete_object_outcome =
           s3_file->s3_client->DeleteObject(delete_object_request);
+      InvalidateStats(s3_file->stat_cache.get(), bucket_src, key_src);
       if (!delete_object_outcome.IsSuccess())
         return TF_SetStatusFromAWSError(delete_object_outcome.GetError(),
                                         status);
@@ -1145,8 +1683,13 @@ int GetChildren(const TF_Filesystem* filesystem, const char* path,
   list_objects_request.SetResponseStreamFactory(
       []() { return Aws::New<Aws::StringStream>(kS3FileSystemAllocationTag); });
 
+  // Listings return the size and mtime of every object, so they fill the stat
+  // cache. Objects are only cached once the listing completed, since a prefix
+  // which is also an object is a directory.
   Aws::S3::Model::ListObjectsV2Result list_objects_result;
   std::vector<Aws::String> result;
+  std::vector<std::pair<std::string, TF_FileStatistics>> listed_stats;
+  std::set<std::string> listed_dirs;
   do {
     auto list_objects_outcome =
         s3_file->s3_client->ListObjectsV2(list_objects_request);
@@ -1162,6 +1705,7 @@ int GetChildren(const TF_Filesystem* filesystem, const char* path,
       Aws::String entry = s.substr(prefix.length());
       if (entry.length() > 0) {
         result.push_back(entry);
+        listed_dirs.insert(StatCacheKey(bucket, s));
       }
     }
     for (const auto& object : list_objects_result.GetContents()) {
@@ -1169,12 +1713,29 @@ int GetChildren(const TF_Filesystem* filesystem, const char* path,
       Aws::String entry = s.substr(prefix.length());
       if (entry.length() > 0) {
         result.push_back(entry);
+        TF_FileStatistics stats;
+        stats.length = object.GetSize();
+        stats.is_directory = 0;
+        stats.mtime_nsec = object.GetLastModified().Millis() * 1e6;
+        listed_stats.emplace_back(StatCacheKey(bucket, s), stats);
       }
     }
     list_objects_request.SetContinuationToken(
         list_objects_result.GetNextContinuationToken());
   } while (list_objects_result.GetIsTruncated());
 
+  for (const auto& entry : listed_stats) {
+    if (listed_dirs.count(entry.first) == 0)
+      s3_file->stat_cache->Insert(entry.first, entry.second);
+  }
+  for (const auto& dir : listed_dirs) {
+    TF_FileStatistics stats;
+    stats.length = 0;
+    stats.is_directory = 1;
+    stats.mtime_nsec = 0;
+    s3_file->stat_cache->Insert(dir, stats);
+  }
+
   int num_entries = result.size();
   *entries = static_cast<char**>(
       plugin_memory_allocate(num_entries * sizeof((*entries)[0])));
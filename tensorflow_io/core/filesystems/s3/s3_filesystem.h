@@ -25,6 +25,8 @@ limitations under the License.
 #include "absl/synchronization/mutex.h"
 #include "tensorflow/c/experimental/filesystem/filesystem_interface.h"
 #include "tensorflow/c/tf_status.h"
+#include "tensorflow_io/core/filesystems/expiring_lru_cache.h"
+#include "tensorflow_io/core/filesystems/ram_file_block_cache.h"
 
 namespace tensorflow {
 namespace io {
@@ -57,7 +59,15 @@ uint64_t Length(const TF_ReadOnlyMemoryRegion* region);
 
 namespace tf_s3_filesystem {
 typedef struct S3File {
+  // Blocks of objects read through random access files, shared by all of
+  // them. Declared first so that it outlives `executor`, which runs the
+  // read-ahead fetches.
+  std::unique_ptr<RamFileBlockCache> read_cache;
+  uint64_t read_ahead_max;
   std::shared_ptr<Aws::S3::S3Client> s3_client;
+  // Stats of objects and directories, filled by `Stat` and in bulk by
+  // `GetChildren`. Created with `s3_client`.
+  std::unique_ptr<ExpiringLRUCache<TF_FileStatistics>> stat_cache;
   std::shared_ptr<Aws::Utils::Threading::PooledThreadExecutor> executor;
   // We need 2 `TransferManager`, for multipart upload/download.
   Aws::UnorderedMap<Aws::Transfer::TransferDirection,
@@ -67,6 +77,10 @@ typedef struct S3File {
   Aws::UnorderedMap<Aws::Transfer::TransferDirection, uint64_t>
       multi_part_chunk_sizes;
   bool use_multi_part_download;
+  // Whether writable files stream multipart uploads instead of uploading a
+  // temporary file on sync.
+  bool use_streaming_upload;
+  size_t streaming_upload_max_pending_parts;
   absl::Mutex initialization_lock;
   S3File();
 } S3File;
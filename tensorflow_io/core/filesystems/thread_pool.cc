@@ -0,0 +1,119 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_io/core/filesystems/thread_pool.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace tensorflow {
+namespace io {
+
+ThreadPool::ThreadPool(const std::string& name, int num_threads)
+    : name_(name) {
+  num_threads = std::max(num_threads, 1);
+  threads_.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    absl::MutexLock l(&mu_);
+    stopping_ = true;
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Schedule(std::function<void()> fn) {
+  absl::MutexLock l(&mu_);
+  queue_.push_back(std::move(fn));
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> fn;
+    {
+      absl::MutexLock l(&mu_);
+      auto ready = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return stopping_ || !queue_.empty();
+      };
+      mu_.Await(absl::Condition(&ready));
+      if (queue_.empty()) return;
+      fn = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    fn();
+  }
+}
+
+void ThreadPool::ParallelFor(size_t n, size_t max_parallelism,
+                             const std::function<void(size_t)>& fn) {
+  if (n == 0) return;
+  if (max_parallelism == 0) max_parallelism = threads_.size();
+  size_t helpers = std::min(n, max_parallelism) - 1;
+  if (helpers == 0) {
+    for (size_t i = 0; i < n; i++) fn(i);
+    return;
+  }
+
+  // Helpers which have not started by the time the caller finished all of the
+  // work must not touch `fn`, so they only join while `done` is false. This
+  // keeps nested calls from worker threads deadlock free.
+  struct State {
+    absl::Mutex mu;
+    size_t next ABSL_GUARDED_BY(mu) = 0;
+    size_t running ABSL_GUARDED_BY(mu) = 0;
+    bool done ABSL_GUARDED_BY(mu) = false;
+  };
+  auto state = std::make_shared<State>();
+  auto run = [state, n, &fn]() {
+    while (true) {
+      size_t i;
+      {
+        absl::MutexLock l(&state->mu);
+        if (state->next >= n) return;
+        i = state->next++;
+      }
+      fn(i);
+    }
+  };
+  for (size_t i = 0; i < helpers; i++) {
+    Schedule([state, run]() {
+      {
+        absl::MutexLock l(&state->mu);
+        if (state->done) return;
+        state->running++;
+      }
+      run();
+      absl::MutexLock l(&state->mu);
+      state->running--;
+    });
+  }
+  run();
+  absl::MutexLock l(&state->mu);
+  state->done = true;
+  auto finished = [state]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(state->mu) {
+    return state->running == 0;
+  };
+  state->mu.Await(absl::Condition(&finished));
+}
+
+}  // namespace io
+}  // namespace tensorflow
@@ -0,0 +1,74 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_IO_CORE_FILESYSTEMS_THREAD_POOL_H
+#define TENSORFLOW_IO_CORE_FILESYSTEMS_THREAD_POOL_H
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace tensorflow {
+namespace io {
+
+/// \brief A fixed-size pool of worker threads shared by the operations of a
+/// filesystem plugin.
+///
+/// Filesystem plugins only see the TensorFlow C API, so they cannot use
+/// `tensorflow::thread::ThreadPool`. Closures are run in FIFO order. The
+/// destructor runs every closure that was already scheduled and then joins the
+/// workers.
+class ThreadPool {
+ public:
+  ThreadPool(const std::string& name, int num_threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /// Schedule `fn` to run on one of the worker threads.
+  void Schedule(std::function<void()> fn) ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Run `fn(i)` for every `i` in `[0, n)` and block until all of them
+  /// returned. At most `max_parallelism` closures (the number of workers if
+  /// 0) are in flight at once, and the calling thread runs one share of the
+  /// work itself, so it is safe to call from a worker of the same pool.
+  void ParallelFor(size_t n, size_t max_parallelism,
+                   const std::function<void(size_t)>& fn);
+
+  int NumThreads() const { return static_cast<int>(threads_.size()); }
+
+  const std::string& name() const { return name_; }
+
+ private:
+  void WorkerLoop() ABSL_LOCKS_EXCLUDED(mu_);
+
+  const std::string name_;
+  std::vector<std::thread> threads_;
+
+  absl::Mutex mu_;
+  std::deque<std::function<void()>> queue_ ABSL_GUARDED_BY(mu_);
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+};
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_IO_CORE_FILESYSTEMS_THREAD_POOL_H
@@ -13,8 +13,17 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#if defined(__linux__)
+#include <dlfcn.h>
+#include <link.h>
+#endif
+
+#include <map>
+
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow_io/core/filesystems/filesystem_stats.h"
 
 namespace tensorflow {
 namespace io {
@@ -61,6 +70,161 @@ REGISTER_KERNEL_BUILDER(
     Name("IO>FileSystemSetConfiguration").Device(DEVICE_CPU),
     FileSystemSetConfigurationOp);
 
+class FileSystemPrefetchOp : public OpKernel {
+ public:
+  explicit FileSystemPrefetchOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    env_ = context->env();
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor* path_tensor;
+    OP_REQUIRES_OK(context, context->input("path", &path_tensor));
+    const Tensor* offset_tensor;
+    OP_REQUIRES_OK(context, context->input("offset", &offset_tensor));
+    const Tensor* length_tensor;
+    OP_REQUIRES_OK(context, context->input("length", &length_tensor));
+    OP_REQUIRES(context,
+                TensorShapeUtils::IsVector(path_tensor->shape()) &&
+                    path_tensor->shape() == offset_tensor->shape() &&
+                    path_tensor->shape() == length_tensor->shape(),
+                errors::InvalidArgument(
+                    "path, offset and length must be vectors of the same "
+                    "length, got shapes ",
+                    path_tensor->shape().DebugString(), ", ",
+                    offset_tensor->shape().DebugString(), " and ",
+                    length_tensor->shape().DebugString()));
+
+    // One "<offset>:<length>:<path>" value per file, grouped by scheme.
+    std::map<string, std::vector<string>> values;
+    for (int64 i = 0; i < path_tensor->NumElements(); i++) {
+      const string path = path_tensor->flat<tstring>()(i);
+      StringPiece scheme, host, remaining;
+      ParseURI(path, &scheme, &host, &remaining);
+      values[string(scheme)].push_back(
+          strings::StrCat(offset_tensor->flat<int64>()(i), ":",
+                          length_tensor->flat<int64>()(i), ":", path));
+    }
+    for (const auto& entry : values) {
+      OP_REQUIRES_OK(context,
+                     env_->SetOption(entry.first, "prefetch", entry.second));
+    }
+  }
+
+ private:
+  Env* env_;
+};
+REGISTER_KERNEL_BUILDER(Name("IO>FileSystemPrefetch").Device(DEVICE_CPU),
+                        FileSystemPrefetchOp);
+
+mutex snapshot_mu(LINKER_INITIALIZED);
+FileSystemStatsSnapshotFn snapshot_fn TF_GUARDED_BY(snapshot_mu) = nullptr;
+
+#if defined(__linux__)
+int CollectLibraryName(struct dl_phdr_info* info, size_t size, void* data) {
+  static_cast<std::vector<string>*>(data)->push_back(info->dlpi_name);
+  return 0;
+}
+#endif
+
+// The filesystem plugins usually live in their own shared object, loaded
+// with RTLD_LOCAL, so the snapshot function is searched in every loaded
+// object. Returns nullptr if the plugins are not loaded.
+FileSystemStatsSnapshotFn LookupFileSystemStatsSnapshot() {
+#if !defined(__linux__)
+  return nullptr;
+#else
+  mutex_lock l(snapshot_mu);
+  if (snapshot_fn != nullptr) return snapshot_fn;
+
+  std::vector<string> names;
+  dl_iterate_phdr(CollectLibraryName, &names);
+  for (const string& name : names) {
+    void* handle =
+        dlopen(name.empty() ? nullptr : name.c_str(), RTLD_LAZY | RTLD_NOLOAD);
+    if (handle == nullptr) continue;
+    void* symbol = dlsym(handle, kFileSystemStatsSnapshotSymbol);
+    dlclose(handle);
+    if (symbol != nullptr) {
+      snapshot_fn = reinterpret_cast<FileSystemStatsSnapshotFn>(symbol);
+      break;
+    }
+  }
+  return snapshot_fn;
+#endif
+}
+
+class FileSystemStatsOp : public OpKernel {
+ public:
+  explicit FileSystemStatsOp(OpKernelConstruction* context)
+      : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor* scheme_tensor;
+    OP_REQUIRES_OK(context, context->input("scheme", &scheme_tensor));
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(scheme_tensor->shape()),
+                errors::InvalidArgument("scheme must be scalar, got shape ",
+                                        scheme_tensor->shape().DebugString()));
+    const string scheme = scheme_tensor->scalar<tstring>()();
+
+    FileSystemStatsSnapshotFn snapshot = LookupFileSystemStatsSnapshot();
+    OP_REQUIRES(context, snapshot != nullptr,
+                errors::Unavailable("filesystem plugins are not loaded"));
+
+    // The number of operations is only known after the first call, and the
+    // filesystem may be registered again before the second one, so the
+    // snapshot is only used once both calls agree.
+    std::vector<const char*> names;
+    std::vector<int64_t> values;
+    int num_ops = snapshot(scheme.c_str(), nullptr, nullptr, 0);
+    for (int attempt = 0; num_ops >= 0; ++attempt) {
+      OP_REQUIRES(context, attempt < kMaxSnapshotAttempts,
+                  errors::Unavailable("statistics for scheme ", scheme,
+                                      " changed while being read"));
+      names.resize(num_ops);
+      values.resize(num_ops * kFileSystemStatsNumFields);
+      int copied =
+          snapshot(scheme.c_str(), names.data(), values.data(), num_ops);
+      if (copied == num_ops) break;
+      num_ops = copied;
+    }
+    OP_REQUIRES(context, num_ops >= 0,
+                errors::NotFound("no statistics for scheme ", scheme));
+
+    Tensor* name_tensor;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape({num_ops}), &name_tensor));
+    Tensor* field_tensors[kFileSystemStatsFirstBucket];
+    for (int i = 0; i < kFileSystemStatsFirstBucket; ++i) {
+      OP_REQUIRES_OK(context,
+                     context->allocate_output(1 + i, TensorShape({num_ops}),
+                                              &field_tensors[i]));
+    }
+    Tensor* histogram_tensor;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       1 + kFileSystemStatsFirstBucket,
+                       TensorShape({num_ops, kFileSystemStatsNumBuckets}),
+                       &histogram_tensor));
+    auto histogram = histogram_tensor->matrix<int64>();
+    for (int op = 0; op < num_ops; ++op) {
+      const int64_t* row = &values[op * kFileSystemStatsNumFields];
+      name_tensor->flat<tstring>()(op) = names[op];
+      for (int i = 0; i < kFileSystemStatsFirstBucket; ++i) {
+        field_tensors[i]->flat<int64>()(op) = row[i];
+      }
+      for (int b = 0; b < kFileSystemStatsNumBuckets; ++b) {
+        histogram(op, b) = row[kFileSystemStatsFirstBucket + b];
+      }
+    }
+  }
+
+ private:
+  static constexpr int kMaxSnapshotAttempts = 3;
+};
+REGISTER_KERNEL_BUILDER(Name("IO>FileSystemStats").Device(DEVICE_CPU),
+                        FileSystemStatsOp);
+
 }  // namespace
 }  // namespace io
 }  // namespace tensorflow
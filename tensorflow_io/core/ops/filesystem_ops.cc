@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/framework/common_shape_fns.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow_io/core/filesystems/filesystem_stats.h"
 
 namespace tensorflow {
 namespace io {
@@ -28,6 +29,34 @@ REGISTER_OP("IO>FileSystemSetConfiguration")
     .SetIsStateful()
     .SetShapeFn(shape_inference::ScalarShape);
 
+REGISTER_OP("IO>FileSystemPrefetch")
+    .Input("path: string")
+    .Input("offset: int64")
+    .Input("length: int64")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::NoOutputs);
+
+REGISTER_OP("IO>FileSystemStats")
+    .Input("scheme: string")
+    .Output("name: string")
+    .Output("calls: int64")
+    .Output("errors: int64")
+    .Output("bytes: int64")
+    .Output("latency: int64")
+    .Output("histogram: int64")
+    .SetIsStateful()
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      shape_inference::ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      for (int i = 0; i <= kFileSystemStatsFirstBucket; i++) {
+        c->set_output(i, c->MakeShape({c->UnknownDim()}));
+      }
+      c->set_output(kFileSystemStatsFirstBucket + 1,
+                    c->MakeShape({c->UnknownDim(),
+                                  c->MakeDim(kFileSystemStatsNumBuckets)}));
+      return Status::OK();
+    });
+
 }  // namespace
 }  // namespace io
 }  // namespace tensorflow
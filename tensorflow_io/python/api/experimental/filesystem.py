@@ -15,5 +15,7 @@
 """tensorflow_io.experimental.filesystem"""
 
 from tensorflow_io.python.experimental.filesystem_ops import (  # pylint: disable=unused-import
+    prefetch,
     set_configuration,
+    stats,
 )
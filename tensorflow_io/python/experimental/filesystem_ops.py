@@ -14,6 +14,8 @@
 # ==============================================================================
 """filesystem"""
 
+import tensorflow as tf
+
 from tensorflow_io.python.ops import core_ops
 
 
@@ -34,3 +36,58 @@ def set_configuration(scheme, key, value, name=None):
     return core_ops.io_file_system_set_configuration(
         scheme, key=key, value=value, name=name
     )
+
+
+def prefetch(paths, offsets=None, lengths=None, name=None):
+    """
+    Hint the file system that files will be read soon.
+
+    The files are fetched into the cache of the file system in the
+    background, so that later reads do not have to wait for them. Only
+    supported by file systems which implement the "prefetch" configuration
+    option (currently `chfs://`).
+
+    Args:
+      paths: A 1-D string tensor of file paths.
+      offsets: A 1-D int64 tensor of the start of the byte range to prefetch
+        for each path. Defaults to 0.
+      lengths: A 1-D int64 tensor of the length of the byte range to prefetch
+        for each path, -1 meaning the rest of the file. Defaults to -1.
+      name: A name for the operation (optional).
+
+    Returns:
+      None.
+    """
+
+    paths = tf.convert_to_tensor(paths, tf.string)
+    if offsets is None:
+        offsets = tf.zeros_like(paths, tf.int64)
+    if lengths is None:
+        lengths = tf.fill(tf.shape(paths), tf.constant(-1, tf.int64))
+    return core_ops.io_file_system_prefetch(
+        paths, offset=offsets, length=lengths, name=name
+    )
+
+
+def stats(scheme, name=None):
+    """
+    Get the I/O statistics of the file system.
+
+    Every operation the file system issues to its storage backend is counted
+    with its errors, transferred bytes and total latency. Latencies are also
+    collected in a histogram whose bucket `b` counts the calls which took
+    between 2^b and 2^(b+1) microseconds.
+
+    Args:
+      scheme: File system scheme.
+      name: A name for the operation (optional).
+
+    Returns:
+      A dict with the operation names (`name`), and the per-operation `calls`,
+      `errors`, `bytes`, `latency` (in microseconds) and `histogram`.
+    """
+
+    values = core_ops.io_file_system_stats(scheme, name=name)
+    return dict(
+        zip(["name", "calls", "errors", "bytes", "latency", "histogram"], values)
+    )
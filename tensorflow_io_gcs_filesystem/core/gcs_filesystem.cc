@@ -16,6 +16,8 @@ limitations under the License.
 #include <stdlib.h>
 #include <string.h>
 
+#include <future>
+
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/types/variant.h"
@@ -48,6 +50,14 @@ constexpr size_t kDefaultMaxCacheSize = 0;
 // will be evicted on the next read.
 constexpr char kMaxStaleness[] = "GCS_READ_CACHE_MAX_STALENESS";
 constexpr uint64_t kDefaultMaxStaleness = 0;
+// The environment variable that overrides the number of threads fetching the
+// blocks of a read concurrently, and the blocks read ahead.
+constexpr char kFetchThreads[] = "GCS_READ_CACHE_FETCH_THREADS";
+constexpr size_t kDefaultFetchThreads = 8;
+// The environment variable that overrides the number of blocks fetched ahead
+// of sequential reads.
+constexpr char kReadAheadBlocks[] = "GCS_READ_AHEAD_BLOCKS";
+constexpr size_t kDefaultReadAheadBlocks = 2;
 
 constexpr char kStatCacheMaxAge[] = "GCS_STAT_CACHE_MAX_AGE";
 constexpr uint64_t kStatCacheDefaultMaxAge = 5;
@@ -65,6 +75,18 @@ constexpr char kAppendMode[] = "GCS_APPEND_MODE";
 // objects.
 constexpr char kComposeAppend[] = "compose";
 
+// If GCS_STREAMING_UPLOAD=1, new files are not staged in a local temporary
+// file but streamed into a resumable upload session, buffering one chunk in
+// memory while the previous one is being sent. The object only appears once
+// the file is closed; Flush() and Sync() report upload errors but do not make
+// the data visible. Appendable files are not affected.
+constexpr char kStreamingUpload[] = "GCS_STREAMING_UPLOAD";
+// The environment variable that overrides the size of the chunks of streaming
+// uploads. Specified in MB.
+constexpr char kStreamingUploadChunkSize[] =
+    "GCS_STREAMING_UPLOAD_CHUNK_SIZE_MB";
+constexpr size_t kDefaultStreamingUploadChunkSize = 16 * 1024 * 1024;
+
 // We can cast `google::cloud::StatusCode` to `TF_Code` because they have the
 // same integer values. See
 // https://github.com/googleapis/google-cloud-cpp/blob/6c09cbfa0160bc046e5509b4dd2ab4b872648b4a/google/cloud/status.h#L32-L52
@@ -200,6 +222,28 @@ int64_t Read(const TF_RandomAccessFile* file, uint64_t offset, size_t n,
 // SECTION 2. Implementation for `TF_WritableFile`
 // ----------------------------------------------------------------------------
 namespace tf_writable_file {
+typedef struct StreamingUpload {
+  gcs::ObjectWriteStream stream;
+  const size_t chunk_size;
+  // The bytes appended since the last chunk was handed to `pending`.
+  std::string chunk;
+  // The number of bytes appended so far.
+  int64_t position;
+  // The first error of the upload, which fails all subsequent operations.
+  google::cloud::Status status;
+  bool closed;
+  // Writes the previous chunk to `stream`. Only one chunk is in flight at a
+  // time, so `stream` is never used concurrently.
+  std::future<google::cloud::Status> pending;
+  StreamingUpload(gcs::ObjectWriteStream&& stream, size_t chunk_size)
+      : stream(std::move(stream)),
+        chunk_size(chunk_size),
+        position(0),
+        closed(false) {
+    chunk.reserve(chunk_size);
+  }
+} StreamingUpload;
+
 typedef struct GCSWritableFile {
   const std::string bucket;
   const std::string object;
@@ -209,8 +253,79 @@ typedef struct GCSWritableFile {
   // `offset` tells us how many bytes of this file are already uploaded to
   // server. If `offset == -1`, we always upload the entire temporary file.
   int64_t offset;
+  // Set in streaming mode, where `outfile` is never opened.
+  std::unique_ptr<StreamingUpload> streaming;
 } GCSWritableFile;
 
+// Waits for the chunk in flight, and sets `status` to the first error of the
+// upload.
+static void WaitForChunk(StreamingUpload* upload, TF_Status* status) {
+  if (upload->pending.valid()) {
+    auto chunk_status = upload->pending.get();
+    if (upload->status.ok()) upload->status = std::move(chunk_status);
+  }
+  TF_SetStatusFromGCSStatus(upload->status, status);
+}
+
+// Hands the buffered chunk to a background write, once the previous one is
+// done.
+static void SendChunk(StreamingUpload* upload, TF_Status* status) {
+  WaitForChunk(upload, status);
+  if (TF_GetCode(status) != TF_OK) return;
+  std::string chunk;
+  chunk.reserve(upload->chunk_size);
+  chunk.swap(upload->chunk);
+  upload->pending = std::async(
+      std::launch::async,
+      [upload](std::string chunk) -> google::cloud::Status {
+        upload->stream.write(chunk.data(), chunk.size());
+        if (upload->stream) return google::cloud::Status();
+        if (!upload->stream.last_status().ok()) {
+          return upload->stream.last_status();
+        }
+        return google::cloud::Status(google::cloud::StatusCode::kUnknown,
+                                     "Could not write to the upload session.");
+      },
+      std::move(chunk));
+}
+
+static void StreamingAppend(StreamingUpload* upload, const char* buffer,
+                            size_t n, TF_Status* status) {
+  if (upload->closed) {
+    TF_SetStatus(status, TF_FAILED_PRECONDITION,
+                 "The upload of this file is already finished.");
+    return;
+  }
+  TF_SetStatusFromGCSStatus(upload->status, status);
+  while (n > 0 && TF_GetCode(status) == TF_OK) {
+    size_t size = (std::min)(n, upload->chunk_size - upload->chunk.size());
+    upload->chunk.append(buffer, size);
+    upload->position += size;
+    buffer += size;
+    n -= size;
+    if (upload->chunk.size() == upload->chunk_size) SendChunk(upload, status);
+  }
+}
+
+static void StreamingClose(const std::string& bucket, const std::string& object,
+                           StreamingUpload* upload, TF_Status* status) {
+  if (upload->closed) return TF_SetStatus(status, TF_OK, "");
+  upload->closed = true;
+  SendChunk(upload, status);
+  WaitForChunk(upload, status);
+  if (TF_GetCode(status) != TF_OK) {
+    // Leave the session unfinished, so that no partial object is created.
+    std::move(upload->stream).Suspend();
+    return;
+  }
+  upload->stream.Close();
+  auto metadata = upload->stream.metadata();
+  if (!metadata) return TF_SetStatusFromGCSStatus(metadata.status(), status);
+  TF_VLog(3, "Streaming upload finished: gs://%s/%s size %u", bucket.c_str(),
+          object.c_str(), metadata->size());
+  TF_SetStatus(status, TF_OK, "");
+}
+
 static void SyncImpl(const std::string& bucket, const std::string& object,
                      int64_t* offset, TempFile* outfile,
                      gcs::Client* gcs_client, TF_Status* status) {
@@ -274,12 +389,22 @@ static void SyncImpl(const std::string& bucket, const std::string& object,
 
 void Cleanup(TF_WritableFile* file) {
   auto gcs_file = static_cast<GCSWritableFile*>(file->plugin_file);
+  auto upload = gcs_file->streaming.get();
+  if (upload != nullptr && !upload->closed) {
+    // Destroying an open stream would finalize the upload with whatever was
+    // written so far.
+    if (upload->pending.valid()) upload->pending.wait();
+    std::move(upload->stream).Suspend();
+  }
   delete gcs_file;
 }
 
 void Append(const TF_WritableFile* file, const char* buffer, size_t n,
             TF_Status* status) {
   auto gcs_file = static_cast<GCSWritableFile*>(file->plugin_file);
+  if (gcs_file->streaming) {
+    return StreamingAppend(gcs_file->streaming.get(), buffer, n, status);
+  }
   if (!gcs_file->outfile.is_open()) {
     TF_SetStatus(status, TF_FAILED_PRECONDITION,
                  "The internal temporary file is not writable.");
@@ -298,6 +423,10 @@ void Append(const TF_WritableFile* file, const char* buffer, size_t n,
 
 int64_t Tell(const TF_WritableFile* file, TF_Status* status) {
   auto gcs_file = static_cast<GCSWritableFile*>(file->plugin_file);
+  if (gcs_file->streaming) {
+    TF_SetStatus(status, TF_OK, "");
+    return gcs_file->streaming->position;
+  }
   int64_t position = int64_t(gcs_file->outfile.tellp());
   if (position == -1)
     TF_SetStatus(status, TF_INTERNAL,
@@ -311,6 +440,10 @@ int64_t Tell(const TF_WritableFile* file, TF_Status* status) {
 
 void Flush(const TF_WritableFile* file, TF_Status* status) {
   auto gcs_file = static_cast<GCSWritableFile*>(file->plugin_file);
+  if (gcs_file->streaming) {
+    // Chunks are sent as they fill up, the rest is sent when closing.
+    return WaitForChunk(gcs_file->streaming.get(), status);
+  }
   if (gcs_file->sync_need) {
     TF_VLog(3, "Flush started: gs://%s/%s", gcs_file->bucket.c_str(),
             gcs_file->object.c_str());
@@ -341,6 +474,10 @@ void Close(const TF_WritableFile* file, TF_Status* status) {
   auto gcs_file = static_cast<GCSWritableFile*>(file->plugin_file);
   TF_VLog(3, "Close: gs://%s/%s", gcs_file->bucket.c_str(),
           gcs_file->object.c_str());
+  if (gcs_file->streaming) {
+    return StreamingClose(gcs_file->bucket, gcs_file->object,
+                          gcs_file->streaming.get(), status);
+  }
   if (gcs_file->sync_need) {
     Flush(file, status);
   }
@@ -386,12 +523,16 @@ typedef struct GcsFileSystemStat {
 typedef struct GCSFileSystemImplementation {
   google::cloud::storage::Client gcs_client;  // owned
   bool compose;
+  bool streaming_upload;
+  size_t streaming_upload_chunk_size;
+  // Read by the fetch threads of `file_block_cache`, which only stop when it
+  // is destroyed, so it must be declared before.
+  std::unique_ptr<ExpiringLRUCache<GcsFileSystemStat>> stat_cache;
   absl::Mutex block_cache_lock;
   std::shared_ptr<RamFileBlockCache> file_block_cache
       ABSL_GUARDED_BY(block_cache_lock);
   uint64_t block_size;  // Reads smaller than block_size will trigger a read
                         // of block_size.
-  std::unique_ptr<ExpiringLRUCache<GcsFileSystemStat>> stat_cache;
   GCSFileSystemImplementation(google::cloud::storage::Client&& gcs_client);
   // This constructor is used for testing purpose only.
   GCSFileSystemImplementation(google::cloud::storage::Client&& gcs_client,
@@ -490,9 +631,18 @@ GCSFileSystemImplementation::GCSFileSystemImplementation(
   compose = (append_mode != nullptr) && (!strcmp(kComposeAppend, append_mode));
 
   uint64_t value;
+  streaming_upload = absl::SimpleAtoi(std::getenv(kStreamingUpload), &value) &&
+                     value == 1;
+  streaming_upload_chunk_size = kDefaultStreamingUploadChunkSize;
+  if (absl::SimpleAtoi(std::getenv(kStreamingUploadChunkSize), &value) &&
+      value > 0) {
+    streaming_upload_chunk_size = static_cast<size_t>(value * 1024 * 1024);
+  }
   block_size = kDefaultBlockSize;
   size_t max_bytes = kDefaultMaxCacheSize;
   uint64_t max_staleness = kDefaultMaxStaleness;
+  size_t fetch_threads = kDefaultFetchThreads;
+  size_t read_ahead_blocks = kDefaultReadAheadBlocks;
 
   // Apply the overrides for the block size (MB), max bytes (MB), and max
   // staleness (seconds) if provided.
@@ -505,8 +655,16 @@ GCSFileSystemImplementation::GCSFileSystemImplementation(
   if (absl::SimpleAtoi(std::getenv(kMaxStaleness), &value)) {
     max_staleness = value;
   }
+  if (absl::SimpleAtoi(std::getenv(kFetchThreads), &value)) {
+    fetch_threads = static_cast<size_t>(value);
+  }
+  if (absl::SimpleAtoi(std::getenv(kReadAheadBlocks), &value)) {
+    read_ahead_blocks = static_cast<size_t>(value);
+  }
   TF_VLog(1, "GCS cache max size = %u ; block size = %u ; max staleness = %u",
           max_bytes, block_size, max_staleness);
+  TF_VLog(1, "GCS cache fetch threads = %u ; read ahead blocks = %u",
+          fetch_threads, read_ahead_blocks);
 
   file_block_cache = std::make_unique<RamFileBlockCache>(
       block_size, max_bytes, max_staleness,
@@ -514,7 +672,8 @@ GCSFileSystemImplementation::GCSFileSystemImplementation(
              char* buffer, TF_Status* status) {
         return LoadBufferFromGCS(filename, offset, buffer_size, buffer, this,
                                  status);
-      });
+      },
+      TF_NowSeconds, fetch_threads, read_ahead_blocks);
 
   uint64_t stat_cache_max_age = kStatCacheDefaultMaxAge;
   size_t stat_cache_max_entries = kStatCacheDefaultMaxEntries;
@@ -534,6 +693,8 @@ GCSFileSystemImplementation::GCSFileSystemImplementation(
     uint64_t stat_cache_max_age, size_t stat_cache_max_entries)
     : gcs_client(gcs_client),
       compose(compose),
+      streaming_upload(false),
+      streaming_upload_chunk_size(kDefaultStreamingUploadChunkSize),
       block_cache_lock(),
       block_size(block_size) {
   file_block_cache = std::make_unique<RamFileBlockCache>(
@@ -617,7 +778,8 @@ void NewRandomAccessFile(const TF_Filesystem* filesystem, const char* path,
             "File signature has been changed. Refreshing the cache. Path: %s",
             path.c_str());
       }
-      read = gcs_file->file_block_cache->Read(path, offset, n, buffer, status);
+      read = gcs_file->file_block_cache->Read(path, offset, n, buffer, status,
+                                              stat.base.length);
     } else {
       read = LoadBufferFromGCS(path, offset, n, buffer, gcs_file, status);
     }
@@ -644,6 +806,22 @@ void NewWritableFile(const TF_Filesystem* filesystem, const char* path,
   if (TF_GetCode(status) != TF_OK) {
     return;
   }
+  if (gcs_file->streaming_upload) {
+    auto stream = gcs_file->gcs_client.WriteObject(
+        bucket, object, gcs::NewResumableUploadSession());
+    if (!stream) {
+      TF_SetStatusFromGCSStatus(stream.last_status(), status);
+      return;
+    }
+    file->plugin_file = new tf_writable_file::GCSWritableFile(
+        {std::move(bucket), std::move(object), &gcs_file->gcs_client,
+         TempFile("", std::ios::binary), false, 0,
+         std::make_unique<tf_writable_file::StreamingUpload>(
+             std::move(stream), gcs_file->streaming_upload_chunk_size)});
+    TF_VLog(3, "GcsWritableFile: %s (streaming)", path);
+    TF_SetStatus(status, TF_OK, "");
+    return;
+  }
   std::string temp_file_name = GCSGetTempFileName("");
   file->plugin_file = new tf_writable_file::GCSWritableFile(
       {std::move(bucket), std::move(object), &gcs_file->gcs_client,
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow_io_gcs_filesystem/core/ram_file_block_cache.h"
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
 #include <sstream>
@@ -43,6 +44,11 @@ std::shared_ptr<RamFileBlockCache::Block> RamFileBlockCache::Lookup(
   auto entry = block_map_.find(key);
   if (entry != block_map_.end()) {
     if (BlockNotStale(entry->second)) {
+      if (entry->second->prefetched) {
+        // The read ahead paid off, the block is an ordinary one from now on.
+        entry->second->prefetched = false;
+        prefetched_bytes_ -= block_size_;
+      }
       return entry->second;
     } else {
       // Remove the stale block and continue.
@@ -115,7 +121,8 @@ void RamFileBlockCache::MaybeFetch(const Key& key,
       if (block->timestamp != 0) {
         // Use capacity() instead of size() to account for all  memory
         // used by the cache.
-        cache_size_ += block->data.capacity();
+        block->charged_bytes = block->data.capacity();
+        cache_size_ += block->charged_bytes;
         // Put to beginning of LRA list.
         lra_list_.erase(block->lra_iterator);
         lra_list_.push_front(key);
@@ -169,8 +176,85 @@ void RamFileBlockCache::MaybeFetch(const Key& key,
       "Control flow should never reach the end of RamFileBlockCache::Fetch.");
 }
 
+void RamFileBlockCache::FetchAsync(const Key& key,
+                                   const std::shared_ptr<Block>& block) {
+  auto fetch = [this, key, block]() {
+    {
+      absl::MutexLock l(&block->mu);
+      if (block->state == FetchState::FETCHING ||
+          block->state == FetchState::FINISHED) {
+        return;
+      }
+    }
+    TF_Status* status = TF_NewStatus();
+    MaybeFetch(key, block, status);
+    if (TF_GetCode(status) == TF_OK) UpdateLRU(key, block, status);
+    TF_DeleteStatus(status);
+  };
+  absl::MutexLock l(&fetch_mu_);
+  fetch_queue_.push_back(std::move(fetch));
+  fetch_cond_var_.Signal();
+}
+
+void RamFileBlockCache::MaybeReadAhead(const std::string& filename,
+                                       size_t offset, size_t n,
+                                       uint64_t file_size) {
+  std::vector<std::pair<Key, std::shared_ptr<Block>>> blocks;
+  {
+    absl::MutexLock lock(&mu_);
+    auto it = next_read_offset_map_.find(filename);
+    bool sequential = it == next_read_offset_map_.end()
+                          ? offset == 0
+                          : it->second == offset;
+    next_read_offset_map_[filename] = offset + n;
+    if (!sequential) return;
+
+    // Start after the block holding the end of the read, which was just
+    // fetched.
+    size_t start = block_size_ * ((offset + n + block_size_ - 1) / block_size_);
+    for (size_t i = 0; i < read_ahead_blocks_; ++i) {
+      size_t pos = start + i * block_size_;
+      if (pos >= file_size) break;
+      Key key = std::make_pair(filename, pos);
+      if (block_map_.find(key) != block_map_.end()) continue;
+      // Admission control: blocks fetched ahead of time may take a quarter
+      // of the cache at most. As eviction goes by recency, this leaves the
+      // blocks in the other three quarters untouched by speculative fetches.
+      if (prefetched_bytes_ + block_size_ > max_bytes_ / 4) break;
+      auto block = std::make_shared<Block>();
+      lru_list_.push_front(key);
+      lra_list_.push_front(key);
+      block->lru_iterator = lru_list_.begin();
+      block->lra_iterator = lra_list_.begin();
+      block->timestamp = timer_seconds_();
+      block->prefetched = true;
+      prefetched_bytes_ += block_size_;
+      block_map_.emplace(key, block);
+      blocks.emplace_back(key, block);
+    }
+  }
+  for (const auto& block : blocks) FetchAsync(block.first, block.second);
+}
+
+void RamFileBlockCache::FetchLoop() {
+  while (true) {
+    std::function<void()> fetch;
+    {
+      absl::MutexLock l(&fetch_mu_);
+      while (!stop_fetch_threads_ && fetch_queue_.empty()) {
+        fetch_cond_var_.Wait(&fetch_mu_);
+      }
+      if (stop_fetch_threads_) return;
+      fetch = std::move(fetch_queue_.front());
+      fetch_queue_.pop_front();
+    }
+    fetch();
+  }
+}
+
 int64_t RamFileBlockCache::Read(const std::string& filename, size_t offset,
-                                size_t n, char* buffer, TF_Status* status) {
+                                size_t n, char* buffer, TF_Status* status,
+                                int64_t file_size) {
   if (n == 0) {
     TF_SetStatus(status, TF_OK, "");
     return 0;
@@ -186,6 +270,16 @@ int64_t RamFileBlockCache::Read(const std::string& filename, size_t offset,
   if (finish < offset + n) {
     finish += block_size_;
   }
+  const bool fetch_ahead = file_size >= 0 && !fetch_threads_.empty();
+  if (fetch_ahead) {
+    // Fetch the blocks after the first one in the background, while this
+    // thread takes care of the first one.
+    size_t end = std::min(finish, static_cast<size_t>(file_size));
+    for (size_t pos = start + block_size_; pos < end; pos += block_size_) {
+      Key key = std::make_pair(filename, pos);
+      FetchAsync(key, Lookup(key));
+    }
+  }
   size_t total_bytes_transferred = 0;
   // Now iterate through the blocks, reading them one at a time.
   for (size_t pos = start; pos < finish; pos += block_size_) {
@@ -233,6 +327,9 @@ int64_t RamFileBlockCache::Read(const std::string& filename, size_t offset,
       break;
     }
   }
+  if (fetch_ahead && read_ahead_blocks_ > 0) {
+    MaybeReadAhead(filename, offset, total_bytes_transferred, file_size);
+  }
   TF_SetStatus(status, TF_OK, "");
   return total_bytes_transferred;
 }
@@ -279,10 +376,15 @@ void RamFileBlockCache::Prune() {
 
 void RamFileBlockCache::Flush() {
   absl::MutexLock lock(&mu_);
+  // Blocks still being fetched in the background must not be accounted for
+  // once they are done.
+  for (auto& entry : block_map_) entry.second->timestamp = 0;
   block_map_.clear();
   lru_list_.clear();
   lra_list_.clear();
   cache_size_ = 0;
+  prefetched_bytes_ = 0;
+  next_read_offset_map_.clear();
 }
 
 void RamFileBlockCache::RemoveFile(const std::string& filename) {
@@ -291,6 +393,7 @@ void RamFileBlockCache::RemoveFile(const std::string& filename) {
 }
 
 void RamFileBlockCache::RemoveFile_Locked(const std::string& filename) {
+  next_read_offset_map_.erase(filename);
   Key begin = std::make_pair(filename, 0);
   auto it = block_map_.lower_bound(begin);
   while (it != block_map_.end() && it->first.first == filename) {
@@ -304,10 +407,22 @@ void RamFileBlockCache::RemoveBlock(BlockMap::iterator entry) {
   // This signals that the block is removed, and should not be inadvertently
   // reinserted into the cache in UpdateLRU.
   entry->second->timestamp = 0;
+  if (entry->second->prefetched) {
+    entry->second->prefetched = false;
+    prefetched_bytes_ -= block_size_;
+  }
   lru_list_.erase(entry->second->lru_iterator);
   lra_list_.erase(entry->second->lra_iterator);
-  cache_size_ -= entry->second->data.capacity();
+  // The data of a block still being fetched is not accounted for yet, and
+  // must not be accessed without its lock.
+  cache_size_ -= entry->second->charged_bytes;
+  // We need to make a copy of the filename here, since `entry` is deleted.
+  const std::string filename = entry->first.first;
   block_map_.erase(entry);
+  auto next = block_map_.lower_bound(std::make_pair(filename, 0));
+  if (next == block_map_.end() || next->first.first != filename) {
+    next_read_offset_map_.erase(filename);
+  }
 }
 
 }  // namespace tf_gcs_filesystem
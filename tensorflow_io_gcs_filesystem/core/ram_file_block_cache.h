@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_C_EXPERIMENTAL_FILESYSTEM_PLUGINS_GCS_RAM_FILE_BLOCK_CACHE_H_
 #define TENSORFLOW_C_EXPERIMENTAL_FILESYSTEM_PLUGINS_GCS_RAM_FILE_BLOCK_CACHE_H_
 
+#include <deque>
 #include <functional>
 #include <iostream>
 #include <list>
@@ -41,6 +42,13 @@ namespace tf_gcs_filesystem {
 ///
 /// This class should be shared by read-only random access files on a remote
 /// filesystem (e.g. GCS).
+///
+/// With `fetch_threads` > 0, the missing blocks of a read spanning several of
+/// them are fetched concurrently, and `read_ahead_blocks` blocks following a
+/// sequential read are fetched in the background. Blocks fetched ahead of
+/// time are admitted only while they take at most a quarter of `max_bytes`,
+/// so that they can never push blocks which are actually read out of the
+/// most recently used part of the cache.
 class RamFileBlockCache {
  public:
   /// The callback executed when a block is not found in the cache, and needs to
@@ -56,12 +64,14 @@ class RamFileBlockCache {
 
   RamFileBlockCache(size_t block_size, size_t max_bytes, uint64_t max_staleness,
                     BlockFetcher block_fetcher,
-                    std::function<uint64_t()> timer_seconds = TF_NowSeconds)
+                    std::function<uint64_t()> timer_seconds = TF_NowSeconds,
+                    size_t fetch_threads = 0, size_t read_ahead_blocks = 0)
       : block_size_(block_size),
         max_bytes_(max_bytes),
         max_staleness_(max_staleness),
         block_fetcher_(block_fetcher),
         timer_seconds_(timer_seconds),
+        read_ahead_blocks_(read_ahead_blocks),
         pruning_thread_(nullptr,
                         [](TF_Thread* thread) { TF_JoinThread(thread); }) {
     if (max_staleness_ > 0) {
@@ -70,6 +80,15 @@ class RamFileBlockCache {
       pruning_thread_.reset(
           TF_StartThread(&thread_options, "TF_prune_FBC", PruneThread, this));
     }
+    if (IsCacheEnabled()) {
+      for (size_t i = 0; i < fetch_threads; ++i) {
+        TF_ThreadOptions thread_options;
+        TF_DefaultThreadOptions(&thread_options);
+        fetch_threads_.emplace_back(
+            TF_StartThread(&thread_options, "TF_fetch_FBC", FetchThread, this),
+            [](TF_Thread* thread) { TF_JoinThread(thread); });
+      }
+    }
     TF_VLog(1, "GCS file block cache is %s.\n",
             (IsCacheEnabled() ? "enabled" : "disabled"));
   }
@@ -81,6 +100,14 @@ class RamFileBlockCache {
       // notification and returns.
       pruning_thread_.reset();
     }
+    {
+      absl::MutexLock l(&fetch_mu_);
+      stop_fetch_threads_ = true;
+      fetch_cond_var_.SignalAll();
+    }
+    // Blocks until the fetch threads are done with their current block.
+    // Queued fetches are dropped.
+    fetch_threads_.clear();
   }
 
   /// Read `n` bytes from `filename` starting at `offset` into `buffer`. It
@@ -103,8 +130,12 @@ class RamFileBlockCache {
   ///
   /// Caller is responsible for allocating memory for `buffer`.
   /// `buffer` will be left unchanged in case of errors.
+  ///
+  /// Blocks are only fetched concurrently or ahead of time when `file_size`
+  /// is known (i.e. not negative): a block fetched past the end of the file
+  /// would make the contents of the cache look inconsistent.
   int64_t Read(const std::string& filename, size_t offset, size_t n,
-               char* buffer, TF_Status* status);
+               char* buffer, TF_Status* status, int64_t file_size = -1);
 
   // Validate the given file signature with the existing file signature in the
   // cache. Returns true if the signature doesn't change or the file doesn't
@@ -139,6 +170,12 @@ class RamFileBlockCache {
     ram_file_block_cache->Prune();
   }
 
+  // Same as `PruneThread`, for the threads running `FetchLoop`.
+  static void FetchThread(void* param) {
+    auto ram_file_block_cache = static_cast<RamFileBlockCache*>(param);
+    ram_file_block_cache->FetchLoop();
+  }
+
  private:
   /// The size of the blocks stored in the LRU cache, as well as the size of the
   /// reads from the underlying filesystem.
@@ -151,6 +188,8 @@ class RamFileBlockCache {
   const BlockFetcher block_fetcher_;
   /// The callback to read timestamps.
   const std::function<uint64_t()> timer_seconds_;
+  /// The number of blocks fetched ahead of a sequential read.
+  const size_t read_ahead_blocks_;
 
   /// \brief The key type for the file block cache.
   ///
@@ -178,10 +217,11 @@ class RamFileBlockCache {
   /// was cached, a coordination lock, and state & condition variables.
   ///
   /// Thread safety:
-  /// The iterator and timestamp fields should only be accessed while holding
-  /// the block-cache-wide mu_ instance variable. The state variable should only
-  /// be accessed while holding the Block's mu lock. The data vector should only
-  /// be accessed after state == FINISHED, and it should never be modified.
+  /// The iterator, timestamp, prefetched and charged_bytes fields should only
+  /// be accessed while holding the block-cache-wide mu_ instance variable. The state
+  /// variable should only be accessed while holding the Block's mu lock. The
+  /// data vector should only be accessed after state == FINISHED, and it
+  /// should never be modified.
   ///
   /// In order to prevent deadlocks, never grab the block-cache-wide mu_ lock
   /// AFTER grabbing any block's mu lock. It is safe to grab mu without locking
@@ -195,6 +235,10 @@ class RamFileBlockCache {
     std::list<Key>::iterator lra_iterator;
     /// The timestamp (seconds since epoch) at which the block was cached.
     uint64_t timestamp;
+    /// Whether the block was fetched ahead of time and not read yet.
+    bool prefetched = false;
+    /// The number of bytes this block contributes to cache_size_.
+    size_t charged_bytes = 0;
     /// Mutex to guard state variable
     absl::Mutex mu;
     /// The state of the block.
@@ -220,6 +264,20 @@ class RamFileBlockCache {
   void MaybeFetch(const Key& key, const std::shared_ptr<Block>& block,
                   TF_Status* status) ABSL_LOCKS_EXCLUDED(mu_);
 
+  /// Fetch `block` on one of the fetch threads, unless it is already fetched
+  /// or being fetched.
+  void FetchAsync(const Key& key, const std::shared_ptr<Block>& block)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Fetch the blocks following a read of `n` bytes at `offset`, if it
+  /// continues the previous read of `filename`.
+  void MaybeReadAhead(const std::string& filename, size_t offset, size_t n,
+                      uint64_t file_size) ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Run the closures queued for the fetch threads until the cache is
+  /// destroyed.
+  void FetchLoop() ABSL_LOCKS_EXCLUDED(fetch_mu_);
+
   /// Trim the block cache to make room for another entry.
   void Trim() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
@@ -241,6 +299,16 @@ class RamFileBlockCache {
   /// Notification for stopping the cache pruning thread.
   absl::Notification stop_pruning_thread_;
 
+  /// The threads fetching blocks in the background.
+  std::vector<std::unique_ptr<TF_Thread, std::function<void(TF_Thread*)>>>
+      fetch_threads_;
+
+  /// Guards the queue of the fetch threads.
+  absl::Mutex fetch_mu_;
+  absl::CondVar fetch_cond_var_;
+  std::deque<std::function<void()>> fetch_queue_ ABSL_GUARDED_BY(fetch_mu_);
+  bool stop_fetch_threads_ ABSL_GUARDED_BY(fetch_mu_) = false;
+
   /// Guards access to the block map, LRU list, and cached byte count.
   mutable absl::Mutex mu_;
 
@@ -263,6 +331,13 @@ class RamFileBlockCache {
 
   // A filename->file_signature map.
   std::map<std::string, int64_t> file_signature_map_ ABSL_GUARDED_BY(mu_);
+
+  /// The bytes reserved by blocks fetched ahead of time and not read yet.
+  size_t prefetched_bytes_ ABSL_GUARDED_BY(mu_) = 0;
+
+  // A filename->offset map, of the end of the last read of each file. Files
+  // are dropped from it along with their last cached block.
+  std::map<std::string, size_t> next_read_offset_map_ ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace tf_gcs_filesystem
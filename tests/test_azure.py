@@ -179,6 +179,77 @@ class AZFSTestBase:
         # Check that file was removed.
         self.assertFalse(tf.io.gfile.exists(file_name))
 
+    def _test_streaming_write(self, name, chunks, flush_after=None):
+        """Write chunks with streaming uploads enabled and read them back."""
+        file_name = self._path_to(name)
+        if tf.io.gfile.exists(file_name):
+            tf.io.gfile.remove(file_name)
+        # Streaming uploads are configured when a writable file is opened.
+        os.environ["TF_AZURE_STREAMING_UPLOAD"] = "1"
+        os.environ["TF_AZURE_STREAMING_UPLOAD_BLOCK_SIZE_MB"] = "1"
+        try:
+            with tf.io.gfile.GFile(file_name, "wb") as w:
+                for i, chunk in enumerate(chunks):
+                    w.write(chunk)
+                    if i == flush_after:
+                        w.flush()
+        finally:
+            del os.environ["TF_AZURE_STREAMING_UPLOAD"]
+            del os.environ["TF_AZURE_STREAMING_UPLOAD_BLOCK_SIZE_MB"]
+        with tf.io.gfile.GFile(file_name, "rb") as r:
+            self.assertEqual(r.read(), b"".join(chunks))
+        tf.io.gfile.remove(file_name)
+
+    def test_streaming_write_blocks(self):
+        """Test streaming upload of several blocks."""
+        chunk = bytes(range(256)) * 4096
+        self._test_streaming_write("streamingblocks", [chunk] * 3 + [b"tail"])
+
+    def test_streaming_write_small(self):
+        """Test streaming upload smaller than one block."""
+        self._test_streaming_write("streamingsmall", [b"Hello, world!"])
+
+    def test_streaming_write_flush(self):
+        """Test streaming upload with a flush before the final block."""
+        chunk = bytes(range(256)) * 3000
+        self._test_streaming_write(
+            "streamingflush", [chunk, b"Hello", chunk, b"world!"], flush_after=1
+        )
+
+    def test_read_cache(self):
+        """Test reads through the optional block cache."""
+        file_name = self._path_to("readcache")
+        content = bytes(range(251)) * (3 * 1024 * 1024 // 251 + 1)
+        with tf.io.gfile.GFile(file_name, "wb") as w:
+            w.write(content)
+
+        # The cache is configured when the filesystem is loaded.
+        env = os.environ.copy()
+        env["TF_AZURE_READ_CACHE_MAX_SIZE_MB"] = "16"
+        env["TF_AZURE_READ_CACHE_BLOCK_SIZE_MB"] = "1"
+        code = """
+import sys
+import tensorflow as tf
+import tensorflow_io as tfio
+name, size = sys.argv[1], int(sys.argv[2])
+content = (bytes(range(251)) * (size // 251 + 1))[:size]
+for _ in range(2):
+    with tf.io.gfile.GFile(name, "rb") as f:
+        # Spans several cache blocks.
+        f.seek(1000)
+        assert f.read(2 * 1024 * 1024 + 1000) == content[1000 : 2 * 1024 * 1024 + 2000]
+        # Stops at the end of the blob.
+        f.seek(size - 1000)
+        assert f.read(5000) == content[-1000:]
+        assert f.read(100) == b""
+"""
+        subprocess.run(
+            [sys.executable, "-c", code, file_name, str(len(content))],
+            env=env,
+            check=True,
+        )
+        tf.io.gfile.remove(file_name)
+
     def _test_read_file_offset_and_dataset(self):
         """Test read file with dataset"""
         # Note: disabled for now. Will enable once
@@ -54,6 +54,96 @@ class CHFSTest(tf.test.TestCase):
         tf.io.gfile.remove(file_name)
         self.assertTrue(not tf.io.gfile.exists(file_name))
 
+    def test_read_cached_blocks(self):
+        """Test reads which span several cache blocks"""
+        file_name = self._path_to("test_read_cached_blocks")
+        if tf.io.gfile.exists(file_name):
+            tf.io.gfile.remove(file_name)
+
+        data = bytes(range(256)) * (3 * 4096 + 17)
+        with tf.io.gfile.GFile(file_name, "wb") as write_file:
+            write_file.write(data)
+
+        with tf.io.gfile.GFile(file_name, "rb") as read_file:
+            chunks = []
+            while True:
+                chunk = read_file.read(100000)
+                if not chunk:
+                    break
+                chunks.append(chunk)
+            self.assertEqual(b"".join(chunks), data)
+
+            read_file.seek(len(data) - 10)
+            self.assertEqual(read_file.read(), data[-10:])
+
+        tf.io.gfile.remove(file_name)
+        self.assertTrue(not tf.io.gfile.exists(file_name))
+
+    def test_buffered_appends(self):
+        """Test many small appends followed by flush and append mode"""
+        file_name = self._path_to("test_buffered_appends")
+        if tf.io.gfile.exists(file_name):
+            tf.io.gfile.remove(file_name)
+
+        records = [str(i).encode() * 7 for i in range(10000)]
+        with tf.io.gfile.GFile(file_name, "wb") as write_file:
+            for record in records[:5000]:
+                write_file.write(record)
+            write_file.flush()
+            self.assertEqual(
+                tf.io.gfile.stat(file_name).length, len(b"".join(records[:5000]))
+            )
+        with tf.io.gfile.GFile(file_name, "ab") as write_file:
+            for record in records[5000:]:
+                write_file.write(record)
+
+        with tf.io.gfile.GFile(file_name, "rb") as read_file:
+            self.assertEqual(read_file.read(), b"".join(records))
+
+        tf.io.gfile.remove(file_name)
+
+    def test_reopen_after_overwrite(self):
+        """Test that reopened files see overwritten contents"""
+        file_name = self._path_to("reopen")
+        for content in ["first epoch", "second, longer epoch", "third"]:
+            with tf.io.gfile.GFile(file_name, "w") as write_file:
+                write_file.write(content)
+            for _ in range(2):
+                with tf.io.gfile.GFile(file_name, "r") as read_file:
+                    self.assertEqual(read_file.read(), content)
+        tf.io.gfile.remove(file_name)
+
+    def test_stats(self):
+        """Test I/O statistics"""
+        file_name = self._path_to("stats")
+        with tf.io.gfile.GFile(file_name, "w") as write_file:
+            write_file.write("Hello, world!")
+        with tf.io.gfile.GFile(file_name, "r") as read_file:
+            self.assertEqual(read_file.read(), "Hello, world!")
+        stats = tfio.experimental.filesystem.stats("chfs")
+        names = [name.decode() for name in stats["name"].numpy()]
+        for op in ["pread", "pwrite"]:
+            i = names.index(op)
+            self.assertGreater(stats["calls"][i], 0)
+            self.assertGreaterEqual(stats["bytes"][i], len("Hello, world!"))
+            self.assertEqual(sum(stats["histogram"][i]), stats["calls"][i])
+        tf.io.gfile.remove(file_name)
+
+    def test_prefetch(self):
+        """Test prefetch hints"""
+        file_names = [self._path_to("prefetch_{}".format(i)) for i in range(3)]
+        for file_name in file_names:
+            with tf.io.gfile.GFile(file_name, "w") as write_file:
+                write_file.write(file_name)
+        tfio.experimental.filesystem.prefetch(file_names)
+        tfio.experimental.filesystem.prefetch(
+            file_names[:1], offsets=[2], lengths=[3]
+        )
+        for file_name in file_names:
+            with tf.io.gfile.GFile(file_name, "r") as read_file:
+                self.assertEqual(read_file.read(), file_name)
+            tf.io.gfile.remove(file_name)
+
     def test_listdir(self):
         dir_name = self._path_to("listdir")
         if tf.io.gfile.exists(dir_name):
@@ -89,6 +179,28 @@ class CHFSTest(tf.test.TestCase):
         print("got:\t", results)
         self.assertTrue(entries == results)
 
+    def test_glob(self):
+        """Test glob"""
+        dir_name = self._path_to("glob")
+        for shard in ["a1", "a2", "b1"]:
+            tf.io.gfile.makedirs(os.path.join(dir_name, shard))
+            for i in range(3):
+                file_name = os.path.join(dir_name, shard, f"part-{i}")
+                with tf.io.gfile.GFile(file_name, "w") as write_file:
+                    write_file.write("")
+
+        results = tf.io.gfile.glob(os.path.join(dir_name, "a*", "part-[01]"))
+        expected = [
+            os.path.join(dir_name, shard, f"part-{i}")
+            for shard in ["a1", "a2"]
+            for i in range(2)
+        ]
+        self.assertEqual(sorted(results), expected)
+        self.assertEqual(
+            len(tf.io.gfile.glob(os.path.join(dir_name, "*", "part-2"))), 3
+        )
+        self.assertEqual(tf.io.gfile.glob(os.path.join(dir_name, "c*")), [])
+
     def test_is_directory(self):
         """Test is directory."""
         # Setup and check preconditions.
@@ -133,6 +245,34 @@ class CHFSTest(tf.test.TestCase):
             data = read_file.read()
             self.assertTrue(data, "Hello,\nworld!")
 
+    def test_rename(self):
+        """Test rename"""
+        file_src = self._path_to("rename_src.txt")
+        file_dest = self._path_to("rename_dest.txt")
+        with tf.io.gfile.GFile(file_src, "w") as write_file:
+            write_file.write("Hello,\nworld!")
+        tf.io.gfile.rename(file_src, file_dest, overwrite=True)
+        self.assertFalse(tf.io.gfile.exists(file_src))
+
+        with tf.io.gfile.GFile(file_dest, "r") as read_file:
+            self.assertEqual(read_file.read(), "Hello,\nworld!")
+        tf.io.gfile.remove(file_dest)
+
+    def test_rmtree(self):
+        """Test makedirs and rmtree"""
+        dir_name = self._path_to("rmtree")
+        inner_name = os.path.join(dir_name, "a", "b", "c")
+        tf.io.gfile.makedirs(inner_name)
+        self.assertTrue(tf.io.gfile.isdir(inner_name))
+        for name in [dir_name, inner_name]:
+            for i in range(10):
+                with tf.io.gfile.GFile(os.path.join(name, f"{i}.txt"), "w") as f:
+                    f.write("")
+
+        tf.io.gfile.rmtree(dir_name)
+        self.assertFalse(tf.io.gfile.exists(dir_name))
+        self.assertFalse(tf.io.gfile.exists(os.path.join(dir_name, "0.txt")))
+
     def test_remove(self):
         """Test remove."""
         file_name = self._path_to("file_to_be_removed")
@@ -143,5 +283,53 @@ class CHFSTest(tf.test.TestCase):
         tf.io.gfile.remove(file_name)
         self.assertFalse(tf.io.gfile.exists(file_name))
 
+    def test_cache_wrapper(self):
+        """Test reads and writes through the cache.chfs wrapper"""
+        file_name = self._path_to("test_cache_wrapper")
+        cache_name = "cache." + file_name
+        data = os.urandom(9 * 1024 * 1024 + 123)
+        with tf.io.gfile.GFile(file_name, "wb") as write_file:
+            write_file.write(data)
+
+        with tf.io.gfile.GFile(cache_name, "rb") as read_file:
+            self.assertEqual(read_file.read(), data)
+        with tf.io.gfile.GFile(cache_name, "rb") as read_file:
+            read_file.seek(5 * 1024 * 1024)
+            self.assertEqual(read_file.read(1000), data[5 * 1024 * 1024 :][:1000])
+        self.assertEqual(tf.io.gfile.stat(cache_name).length, len(data))
+        self.assertEqual(tf.io.gfile.glob(cache_name + "*"), [cache_name])
+
+        # Writes through the wrapper drop what it cached about the file.
+        with tf.io.gfile.GFile(cache_name, "w") as write_file:
+            write_file.write("Hello,\nworld!")
+        with tf.io.gfile.GFile(cache_name, "r") as read_file:
+            self.assertEqual(read_file.read(), "Hello,\nworld!")
+        self.assertEqual(tf.io.gfile.stat(cache_name).length, 13)
+
+        tf.io.gfile.remove(cache_name)
+        self.assertFalse(tf.io.gfile.exists(cache_name))
+        self.assertFalse(tf.io.gfile.exists(file_name))
+
+    def test_cache_wrapper_stats(self):
+        """Test that cache.chfs shares the chfs filesystem and its statistics"""
+        data = os.urandom(1024 * 1024 + 123)
+        file_names = []
+        for n, scheme in enumerate(["cache.", "", "cache."]):
+            file_name = self._path_to(f"test_cache_wrapper_stats_{n}")
+            file_names.append(file_name)
+            with tf.io.gfile.GFile(file_name, "wb") as write_file:
+                write_file.write(data)
+
+            stats = tfio.experimental.filesystem.stats("chfs")
+            i = [name.decode() for name in stats["name"].numpy()].index("pread")
+            nbytes = stats["bytes"][i]
+            # Each file is only read once, so the reads reach libchfs.
+            with tf.io.gfile.GFile(scheme + file_name, "rb") as read_file:
+                self.assertEqual(read_file.read(), data)
+            stats = tfio.experimental.filesystem.stats("chfs")
+            self.assertGreaterEqual(stats["bytes"][i], nbytes + len(data))
+        for file_name in file_names:
+            tf.io.gfile.remove(file_name)
+
 if __name__ == "__main__":
     tf.test.main()
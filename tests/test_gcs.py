@@ -15,6 +15,7 @@
 """Tests for GCS file system"""
 
 import os
+import subprocess
 import sys
 import time
 import requests
@@ -58,3 +59,109 @@ def test_read_file():
 
     content = tf.io.read_file(f"gs://{bucket_name}/{key_name}")
     assert content == body
+
+
+def run_streaming_upload(code, *args):
+    """Run `code` in a process with streaming uploads of 1 MB chunks"""
+
+    # Streaming uploads are configured when the filesystem is loaded.
+    env = os.environ.copy()
+    env["CLOUD_STORAGE_TESTBENCH_ENDPOINT"] = "http://localhost:9099"
+    env["GCS_STREAMING_UPLOAD"] = "1"
+    env["GCS_STREAMING_UPLOAD_CHUNK_SIZE_MB"] = "1"
+    code = (
+        """
+import sys
+import pytest
+import requests
+import tensorflow as tf
+import tensorflow_io_gcs_filesystem
+"""
+        + code
+    )
+    subprocess.run([sys.executable, "-c", code, *args], env=env, check=True)
+
+
+@pytest.mark.skipif(
+    sys.platform in ("win32", "darwin"),
+    reason="TODO GCS emulator not setup properly on macOS/Windows yet",
+)
+@pytest.mark.parametrize(
+    "size", [pytest.param(7, id="small"), pytest.param(3500000, id="chunked")]
+)
+def test_write_file_streaming(size):
+    """Test case for writing GCS with streaming uploads"""
+
+    from google.cloud import storage
+
+    client = storage.Client(
+        project="[PROJECT]",
+        _http=requests.Session(),
+        client_options={"api_endpoint": "http://localhost:9099"},
+    )
+
+    key_name = "TEST"
+    bucket_name = f"gs{int(time.time())}s{size}"
+    bucket = client.create_bucket(bucket_name)
+
+    # Writes smaller than a chunk are sent on close, larger ones in chunks.
+    run_streaming_upload(
+        """
+path, size = sys.argv[1], int(sys.argv[2])
+with tf.io.gfile.GFile(path, "wb") as f:
+    for i in range(0, size, 100000):
+        f.write(bytes([i // 100000]) * min(100000, size - i))
+        assert f.tell() == min(i + 100000, size)
+""",
+        f"gs://{bucket_name}/{key_name}",
+        str(size),
+    )
+
+    body = b"".join(
+        bytes([i // 100000]) * min(100000, size - i) for i in range(0, size, 100000)
+    )
+    assert bucket.blob(key_name).download_as_bytes() == body
+
+
+@pytest.mark.skipif(
+    sys.platform in ("win32", "darwin"),
+    reason="TODO GCS emulator not setup properly on macOS/Windows yet",
+)
+def test_write_file_streaming_failed_chunk():
+    """Test case for closing a streaming upload after a chunk failed"""
+
+    from google.cloud import storage
+
+    client = storage.Client(
+        project="[PROJECT]",
+        _http=requests.Session(),
+        client_options={"api_endpoint": "http://localhost:9099"},
+    )
+
+    key_name = "TEST"
+    bucket_name = f"gs{int(time.time())}f"
+    client.create_bucket(bucket_name)
+
+    # Chunks sent after the bucket is deleted are rejected, which fails the
+    # upload on close. Closing again does not retry it.
+    run_streaming_upload(
+        """
+from google.cloud import storage
+client = storage.Client(
+    project="[PROJECT]",
+    _http=requests.Session(),
+    client_options={"api_endpoint": "http://localhost:9099"},
+)
+bucket_name, key_name = sys.argv[1], sys.argv[2]
+f = tf.io.gfile.GFile(f"gs://{bucket_name}/{key_name}", "wb")
+f.write(b"1" * 1500000)
+client.get_bucket(bucket_name).delete()
+with pytest.raises(tf.errors.OpError):
+    f.close()
+f.close()
+""",
+        bucket_name,
+        key_name,
+    )
+
+    assert not client.lookup_bucket(bucket_name)
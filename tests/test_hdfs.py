@@ -14,6 +14,7 @@
 # ==============================================================================
 """Tests for HDFS file system"""
 
+import concurrent.futures
 import os
 import sys
 import socket
@@ -91,3 +92,118 @@ def test_append_existing_file():
     print(f"CONTENT: {content}")
     assert content == body1 + body2
     f.close()
+
+
+@pytest.mark.skipif(
+    sys.platform in ("win32", "darwin"),
+    reason="TODO HDFS not setup properly on macOS/Windows yet",
+)
+def test_buffered_write():
+    """Test case for buffered appends, tell, flush and close"""
+
+    address = socket.gethostbyname(socket.gethostname())
+    print(f"ADDRESS: {address}")
+
+    filepath = f"hdfs://{address}:9000/buffered.txt"
+    records = [str(i).encode() * 7 for i in range(20000)]
+    with tf.io.gfile.GFile(filepath, "wb") as f:
+        assert f.tell() == 0
+        for record in records[:10000]:
+            f.write(record)
+        body = b"".join(records[:10000])
+        assert f.tell() == len(body)
+        f.flush()
+        assert tf.io.read_file(filepath) == body
+
+        for record in records[10000:]:
+            f.write(record)
+        body = b"".join(records)
+        assert f.tell() == len(body)
+        # Records buffered after the first flush must become visible too.
+        f.flush()
+        assert tf.io.read_file(filepath) == body
+
+    assert tf.io.read_file(filepath) == body
+    assert tf.io.gfile.stat(filepath).length == len(body)
+
+
+@pytest.mark.skipif(
+    sys.platform in ("win32", "darwin"),
+    reason="TODO HDFS not setup properly on macOS/Windows yet",
+)
+def test_append_tell():
+    """Test case for the position of an appendable HDFS file"""
+
+    address = socket.gethostbyname(socket.gethostname())
+    print(f"ADDRESS: {address}")
+
+    body = b"1234567" * 1000
+    filepath = f"hdfs://{address}:9000/append_tell.txt"
+    if tf.io.gfile.exists(filepath):
+        tf.io.gfile.remove(filepath)
+    with tf.io.gfile.GFile(filepath, "a") as f:
+        # The position of a new file comes from HDFS too.
+        assert f.tell() == 0
+        f.write(body)
+        assert f.tell() == len(body)
+    assert tf.io.read_file(filepath) == body
+
+
+@pytest.mark.skipif(
+    sys.platform in ("win32", "darwin", "linux"),
+    reason="TODO HDFS not setup properly on macOS/Windows yet. For linux, appending "
+    "to an existing file fails as in test_append_existing_file.",
+)
+def test_append_existing_file_tell():
+    """Test case for the position of an appendable existing HDFS file"""
+
+    address = socket.gethostbyname(socket.gethostname())
+    print(f"ADDRESS: {address}")
+    body1 = b"1234567"
+    body2 = b"7654321"
+
+    filepath = f"hdfs://{address}:9000/append_existing_tell.txt"
+    tf.io.write_file(filepath, body1)
+    with tf.io.gfile.GFile(filepath, "a") as f:
+        # Appends start at the end of the existing file.
+        assert f.tell() == len(body1)
+        f.write(body2)
+        assert f.tell() == len(body1) + len(body2)
+    assert tf.io.read_file(filepath) == body1 + body2
+
+
+@pytest.mark.skipif(
+    sys.platform in ("win32", "darwin"),
+    reason="TODO HDFS not setup properly on macOS/Windows yet",
+)
+def test_read_concurrent():
+    """Test case for concurrent, sequential and random reads of HDFS files"""
+
+    address = socket.gethostbyname(socket.gethostname())
+    print(f"ADDRESS: {address}")
+
+    filepath = f"hdfs://{address}:9000/read_concurrent.bin"
+    body = os.urandom(5 * 1024 * 1024 + 123)
+    tf.io.write_file(filepath, body)
+
+    def read(index):
+        with tf.io.gfile.GFile(filepath, "rb") as f:
+            if index % 2 == 0:
+                # Small sequential reads, served from read-ahead blocks.
+                chunks = []
+                while True:
+                    chunk = f.read(4096 + index)
+                    if not chunk:
+                        break
+                    chunks.append(chunk)
+                assert b"".join(chunks) == body
+            else:
+                # Small random reads.
+                for i in range(200):
+                    offset = (i * 7919 * index) % len(body)
+                    f.seek(offset)
+                    assert f.read(100) == body[offset : offset + 100]
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=8) as executor:
+        list(executor.map(read, range(8)))
+    assert tf.io.read_file(filepath) == body
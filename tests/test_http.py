@@ -14,7 +14,11 @@
 # ==============================================================================
 """Tests for HTTP file system"""
 
+import http.server
+import multiprocessing
 import os
+import re
+import subprocess
 import sys
 import pytest
 
@@ -46,6 +50,74 @@ def remote_filename():
     return "https://www.apache.org/licenses/LICENSE-2.0.txt"
 
 
+# Large enough for reads of the whole file to be split into several
+# concurrent range requests.
+LOCAL_SERVER_CONTENT = (bytes(range(251)) * (20 * 1024 * 1024 // 251 + 1))[
+    : 20 * 1024 * 1024 + 123
+]
+
+
+class LocalHandler(http.server.BaseHTTPRequestHandler):
+    """Serves LOCAL_SERVER_CONTENT, ignoring the Range header under /norange"""
+
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, *args):  # pylint: disable=arguments-differ
+        pass
+
+    def send_content(self, body):
+        content = LOCAL_SERVER_CONTENT
+        match = re.match(r"bytes=(\d+)-(\d+)", self.headers.get("Range", ""))
+        if match and not self.path.startswith("/norange"):
+            start, end = int(match[1]), int(match[2])
+            if start >= len(content):
+                self.send_response(416)
+                self.send_header("Content-Length", "0")
+                self.end_headers()
+                return
+            content = content[start : end + 1]
+            self.send_response(206)
+        else:
+            self.send_response(200)
+        self.send_header("Content-Length", str(len(content)))
+        self.send_header("Last-Modified", "Sun, 06 Nov 1994 08:49:37 GMT")
+        self.end_headers()
+        if body:
+            self.wfile.write(content)
+
+    def do_GET(self):  # pylint: disable=invalid-name
+        self.send_content(True)
+
+    def do_HEAD(self):  # pylint: disable=invalid-name
+        self.send_content(False)
+
+
+class LocalServer(http.server.ThreadingHTTPServer):
+    daemon_threads = True
+
+    def handle_error(self, request, client_address):
+        # Clients abort the full responses to reads of part of the file.
+        pass
+
+
+def serve_local(port_queue):
+    server = LocalServer(("127.0.0.1", 0), LocalHandler)
+    port_queue.put(server.server_address[1])
+    server.serve_forever()
+
+
+@pytest.fixture(scope="module")
+def local_server():
+    # In its own process, so that it does not wait for the GIL while a test
+    # is blocked reading from it.
+    port_queue = multiprocessing.Queue()
+    process = multiprocessing.Process(target=serve_local, args=(port_queue,))
+    process.start()
+    yield "http://127.0.0.1:{}".format(port_queue.get(timeout=30))
+    process.terminate()
+    process.join()
+
+
 @pytest.mark.skipif(sys.platform == "darwin", reason="macOS fails now")
 def test_read_remote_file(local_content, remote_filename):
     """Test case for reading the entire content of the http file"""
@@ -106,5 +178,67 @@ def test_gfile_tell(local_content, remote_filename):
     assert remote_gfile.tell() == 100
 
 
+@pytest.mark.skipif(
+    sys.platform in ("darwin", "win32"), reason="macOS/Windows fails now"
+)
+def test_read_split(local_server):
+    """Test case for reads split into concurrent range requests"""
+
+    with tf.io.gfile.GFile(local_server + "/data", "rb") as f:
+        assert f.size() == len(LOCAL_SERVER_CONTENT)
+        assert f.read() == LOCAL_SERVER_CONTENT
+        f.seek(12345)
+        assert f.read(100) == LOCAL_SERVER_CONTENT[12345:12445]
+
+
+@pytest.mark.skipif(
+    sys.platform in ("darwin", "win32"), reason="macOS/Windows fails now"
+)
+def test_read_cache(local_server):
+    """Test case for reads through the optional block cache"""
+
+    # The cache is configured when the filesystem is loaded.
+    env = os.environ.copy()
+    env["HTTP_READ_CACHE_MAX_SIZE_MB"] = "64"
+    code = """
+import sys
+import tensorflow as tf
+import tensorflow_io as tfio
+url, size = sys.argv[1], int(sys.argv[2])
+content = (bytes(range(251)) * (size // 251 + 1))[:size]
+for _ in range(2):
+    with tf.io.gfile.GFile(url, "rb") as f:
+        assert f.read() == content
+        f.seek(size - 1000)
+        assert f.read() == content[-1000:]
+"""
+    subprocess.run(
+        [
+            sys.executable,
+            "-c",
+            code,
+            local_server + "/data",
+            str(len(LOCAL_SERVER_CONTENT)),
+        ],
+        env=env,
+        check=True,
+    )
+
+
+@pytest.mark.skipif(
+    sys.platform in ("darwin", "win32"), reason="macOS/Windows fails now"
+)
+def test_read_range_ignored(local_server):
+    """Test case for a server which ignores the Range header"""
+
+    with tf.io.gfile.GFile(local_server + "/norange", "rb") as f:
+        # Reads from the start are served from the full response.
+        assert f.read(100) == LOCAL_SERVER_CONTENT[:100]
+    with tf.io.gfile.GFile(local_server + "/norange", "rb") as f:
+        with pytest.raises(tf.errors.FailedPreconditionError):
+            f.seek(1000)
+            f.read(100)
+
+
 if __name__ == "__main__":
     tf.test.main()
@@ -15,6 +15,7 @@
 """Tests for S3 file system"""
 
 import os
+import subprocess
 import sys
 import time
 import tempfile
@@ -55,3 +56,160 @@ def test_read_file():
 
     content = tf.io.read_file(f"s3://{bucket_name}/{key_name}")
     assert content == body
+
+
+@pytest.mark.skipif(
+    sys.platform in ("win32", "darwin"),
+    reason="TODO Localstack not setup properly on macOS/Windows yet",
+)
+def test_stat_after_listing():
+    """Test case for stats served from listings of S3"""
+    import boto3
+
+    os.environ["AWS_REGION"] = "us-east-1"
+    os.environ["AWS_ACCESS_KEY_ID"] = "ACCESS_KEY"
+    os.environ["AWS_SECRET_ACCESS_KEY"] = "SECRET_KEY"
+
+    client = boto3.client(
+        "s3", region_name="us-east-1", endpoint_url="http://localhost:4566"
+    )
+
+    bucket_name = f"s3e{time.time()}e"
+    client.create_bucket(Bucket=bucket_name)
+    for i in range(5):
+        client.put_object(Bucket=bucket_name, Key=f"dir/file{i}", Body=b"x" * i)
+    client.put_object(Bucket=bucket_name, Key="dir/sub/file", Body=b"x")
+
+    os.environ["S3_ENDPOINT"] = "http://localhost:4566"
+
+    root = f"s3://{bucket_name}/dir"
+    assert sorted(tf.io.gfile.listdir(root)) == sorted(
+        [f"file{i}" for i in range(5)] + ["sub"]
+    )
+    for i in range(5):
+        assert tf.io.gfile.stat(f"{root}/file{i}").length == i
+    assert tf.io.gfile.isdir(f"{root}/sub")
+
+    # Stats must not be served from the cache once the object changed.
+    with tf.io.gfile.GFile(f"{root}/file1", "w") as f:
+        f.write("y" * 10)
+    assert tf.io.gfile.stat(f"{root}/file1").length == 10
+    tf.io.gfile.remove(f"{root}/file2")
+    assert not tf.io.gfile.exists(f"{root}/file2")
+
+    # Directories created and deleted through the filesystem too.
+    tf.io.gfile.mkdir(f"{root}/new")
+    assert tf.io.gfile.isdir(f"{root}/new")
+    tf.io.gfile.rmtree(f"{root}/new")
+    assert not tf.io.gfile.exists(f"{root}/new")
+
+
+def run_s3(code, env, *args):
+    """Run `code` in a process with the S3 settings in `env`"""
+
+    # S3 settings are read when the filesystem creates its client.
+    env = dict(os.environ, **env)
+    env["AWS_REGION"] = "us-east-1"
+    env["AWS_ACCESS_KEY_ID"] = "ACCESS_KEY"
+    env["AWS_SECRET_ACCESS_KEY"] = "SECRET_KEY"
+    env["S3_ENDPOINT"] = "http://localhost:4566"
+    code = (
+        """
+import sys
+import tensorflow as tf
+import tensorflow_io as tfio
+"""
+        + code
+    )
+    subprocess.run([sys.executable, "-c", code, *args], env=env, check=True)
+
+
+@pytest.mark.skipif(
+    sys.platform in ("win32", "darwin"),
+    reason="TODO Localstack not setup properly on macOS/Windows yet",
+)
+@pytest.mark.parametrize(
+    ("size", "parts"),
+    [
+        pytest.param(7, None, id="put"),
+        pytest.param(12 * 1024 * 1024 + 7, 3, id="multipart"),
+    ],
+)
+def test_write_file_streaming(size, parts):
+    """Test case for writing S3 with streaming uploads"""
+    import boto3
+
+    client = boto3.client(
+        "s3", region_name="us-east-1", endpoint_url="http://localhost:4566"
+    )
+
+    key_name = "TEST"
+    bucket_name = f"s3e{time.time()}e"
+    client.create_bucket(Bucket=bucket_name)
+
+    # Objects smaller than a part are uploaded with a single PutObject.
+    run_s3(
+        """
+path, size = sys.argv[1], int(sys.argv[2])
+with tf.io.gfile.GFile(path, "wb") as f:
+    for i in range(0, size, 1000000):
+        f.write(bytes([i // 1000000]) * min(1000000, size - i))
+""",
+        {
+            "S3_STREAMING_UPLOAD": "1",
+            "S3_MULTI_PART_UPLOAD_CHUNK_SIZE": str(5 * 1024 * 1024),
+        },
+        f"s3://{bucket_name}/{key_name}",
+        str(size),
+    )
+
+    body = b"".join(
+        bytes([i // 1000000]) * min(1000000, size - i) for i in range(0, size, 1000000)
+    )
+    response = client.get_object(Bucket=bucket_name, Key=key_name)
+    assert response["Body"].read() == body
+    # Multipart uploads have an ETag ending in the number of parts.
+    etag = response["ETag"].strip('"')
+    if parts is None:
+        assert "-" not in etag
+    else:
+        assert etag.endswith(f"-{parts}")
+
+
+@pytest.mark.skipif(
+    sys.platform in ("win32", "darwin"),
+    reason="TODO Localstack not setup properly on macOS/Windows yet",
+)
+def test_read_cache():
+    """Test case for reads of S3 through the optional block cache"""
+    import boto3
+
+    client = boto3.client(
+        "s3", region_name="us-east-1", endpoint_url="http://localhost:4566"
+    )
+
+    key_name = "TEST"
+    bucket_name = f"s3e{time.time()}e"
+    client.create_bucket(Bucket=bucket_name)
+    body = bytes(range(251)) * (3 * 1024 * 1024 // 251 + 1)
+    client.put_object(Bucket=bucket_name, Key=key_name, Body=body)
+
+    run_s3(
+        """
+path, size = sys.argv[1], int(sys.argv[2])
+content = (bytes(range(251)) * (size // 251 + 1))[:size]
+for _ in range(2):
+    with tf.io.gfile.GFile(path, "rb") as f:
+        assert f.read() == content
+        # Spans several cache blocks.
+        f.seek(1000)
+        assert f.read(2 * 1024 * 1024) == content[1000 : 2 * 1024 * 1024 + 1000]
+        # Stops at the end of the object.
+        f.seek(size - 1000)
+        assert f.read(5000) == content[-1000:]
+        assert f.read(100) == b""
+""",
+        {"S3_READ_CACHE_MAX_SIZE_MB": "16", "S3_READ_CACHE_BLOCK_SIZE_MB": "1"},
+        f"s3://{bucket_name}/{key_name}",
+        str(len(body)),
+    )